@@ -22,12 +22,7 @@ components = {
         mass = 0.0,
         gravity = false,
         body_type = rigidbody.static,
-        shape = {
-            type = shape.box,
-            x = 100000000,
-            y = 0.1,
-            z = 100000000
-        }
+        shape = shape.mesh
     },
     model = {
         path = "res/model/city/city.fbx"
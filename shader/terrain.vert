@@ -9,13 +9,41 @@ uniform struct Matrices {
     mat4 projection;
 } u_matrices;
 
+uniform struct Textures {
+    sampler2D diffuse;
+    sampler2D specular;
+    sampler2D normal;
+    sampler2D height;
+} u_textures;
+
+// Maps height texture samples to heights.
+uniform struct HeightMap {
+    float scale;
+    float offset;
+} u_height_map;
+
+// Where this chunk's grid sits on the height texture.
+uniform struct Patch {
+    vec2 origin;
+    float spacing;
+    float skirt_depth;
+} u_patch;
+
 out VertexData {
     vec2 uvs;
     vec3 pos;
 } o;
 
 void main() {
-    o.uvs = in_uvs;
-    o.pos = in_pos;
-    gl_Position = u_matrices.projection * u_matrices.view * u_matrices.model * vec4(in_pos, 1.0);
+    // The grid is flat, with its skirt flagged by a y of -1. Grids hanging off
+    // the edge of the map repeat its last row or column.
+    ivec2 size = textureSize(u_textures.height, 0);
+    ivec2 texel = min(ivec2(u_patch.origin + in_pos.xz * u_patch.spacing), size - 1);
+    float height = texelFetch(u_textures.height, texel, 0).r * u_height_map.scale + u_height_map.offset;
+    vec2 grid = vec2(texel) - vec2(size) / 2.0;
+    vec3 pos = vec3(grid.x, height + in_pos.y * u_patch.skirt_depth, grid.y);
+
+    o.uvs = vec2(texel) / 2.0;
+    o.pos = pos;
+    gl_Position = u_matrices.projection * u_matrices.view * u_matrices.model * vec4(pos, 1.0);
 }
@@ -1,5 +1,6 @@
 #include "afk/Afk.hpp"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -10,8 +11,12 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "afk/asset/AssetFactory.hpp"
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/component/AnimationFrame.hpp"
 #include "afk/component/GameObject.hpp"
+#include "afk/component/Hierarchy.hpp"
 #include "afk/component/ScriptsComponent.hpp"
+#include "afk/component/WorldTransform.hpp"
 #include "afk/debug/Assert.hpp"
 #include "afk/io/Log.hpp"
 #include "afk/io/ModelSource.hpp"
@@ -20,8 +25,10 @@
 #include "afk/physics/shape/Box.hpp"
 #include "afk/physics/shape/Sphere.hpp"
 #include "afk/renderer/ModelRenderSystem.hpp"
+#include "afk/terrain/Terrain.hpp"
 #include "afk/script/Bindings.hpp"
 #include "afk/script/LuaInclude.hpp"
+#include "afk/thread/JobSystem.hpp"
 
 using namespace std::string_literals;
 
@@ -37,6 +44,8 @@ using Movement = Afk::Camera::Movement;
 auto Engine::initialize() -> void {
   afk_assert(!this->is_initialized, "Engine already initialized");
 
+  // Started first, so the job system's main thread is this one.
+  Afk::JobSystem::get();
   this->renderer.initialize();
   this->event_manager.initialize(this->renderer.window);
 
@@ -46,23 +55,53 @@ auto Engine::initialize() -> void {
   Afk::add_engine_bindings(this->lua);
 
   this->terrain_manager.initialize();
-  const int terrain_width  = 1024;
-  const int terrain_length = 1024;
-  this->terrain_manager.generate_terrain(terrain_width, terrain_length, 0.05f, 7.5f);
-  this->renderer.load_model(this->terrain_manager.get_model());
+  const int terrain_width       = 1024;
+  const int terrain_length      = 1024;
+  const float terrain_roughness = 0.05f;
+  const float terrain_scaling   = 7.5f;
+  this->terrain_manager.generate_terrain(terrain_width, terrain_length, terrain_roughness,
+                                         terrain_scaling);
+  // The terrain's grid is displaced by the height map, so it goes first.
+  this->renderer.load_height_map(Afk::TerrainManager::HEIGHT_MAP_PATH,
+                                 this->terrain_manager.height_map);
+  auto terrain_model      = this->terrain_manager.get_model();
+  const auto terrain_path = terrain_model.file_path;
+  this->renderer.load_model(std::move(terrain_model));
+  // Generated terrain has nothing on disk to be reloaded from.
+  this->renderer.pin_model(Afk::Asset::AssetRegistry::get().intern(terrain_path));
 
   auto terrain_entity           = registry.create();
   auto terrain_transform        = Transform{terrain_entity};
   terrain_transform.translation = glm::vec3{0.0f, -10.0f, 0.0f};
     registry.assign<Afk::ModelSource>(terrain_entity, terrain_entity,
-                                      terrain_manager.get_model().file_path,
+                                      terrain_path,
                                       "shader/terrain.prog");
-  registry.assign<Afk::Transform>(terrain_entity, terrain_entity);
-  registry.assign<Afk::PhysicsBody>(terrain_entity, terrain_entity, &this->physics_body_system,
-                                    terrain_transform, 0.3f, 0.0f, 0.0f, 0.0f,
-                                    true, Afk::RigidBodyType::STATIC,
+  registry.assign<Afk::Transform>(terrain_entity, terrain_transform);
+  registry.assign<Afk::Terrain>(terrain_entity, terrain_entity);
+
+  // The height field is raised by the map's offset, so it gets an entity of
+  // its own rather than dragging the mesh up with it.
+  auto terrain_body_entity    = registry.create();
+  auto terrain_body_transform = Transform{terrain_body_entity};
+  terrain_body_transform.translation =
+      terrain_transform.translation + vec3{0.0f, this->terrain_manager.height_map.offset, 0.0f};
+  registry.assign<Afk::Transform>(terrain_body_entity, terrain_body_transform);
+  registry.assign<Afk::Terrain>(terrain_body_entity, terrain_body_entity);
+  registry.assign<Afk::PhysicsBody>(terrain_body_entity, terrain_body_entity,
+                                    &this->physics_body_system, terrain_body_transform, 0.3f,
+                                    0.0f, 0.0f, 0.0f, true, Afk::RigidBodyType::STATIC,
                                     this->terrain_manager.height_map);
 
+  // Queries answer in world space, from where the terrain is drawn.
+  this->terrain_manager.query.set_origin(
+      terrain_transform.translation -
+      vec3{terrain_width / 2.0f, 0.0f, terrain_length / 2.0f});
+
+  // Streamed tiles carry on from where the generated terrain's noise leaves off.
+  this->terrain_streamer.initialize(
+      vec3{-terrain_width / 2.0f, terrain_transform.translation.y, -terrain_length / 2.0f},
+      terrain_roughness, terrain_scaling);
+
   auto animation            = registry.create();
   auto animation_transform  = Transform{};
   auto const animation_model_name =
@@ -89,9 +128,57 @@ auto Engine::initialize() -> void {
       .add_script("script/component/camera_mouse_control.lua", this->lua, &this->event_manager)
       .add_script("script/component/debug.lua", this->lua, &this->event_manager);
 
+  this->transform_system.initialize(&this->registry);
+  this->add_systems();
+
+  // Everything's in the world, so it can start stepping on its own.
+  this->physics_body_system.set_threaded(true);
+
   this->is_initialized = true;
 }
 
+auto Engine::add_systems() -> void {
+  using Access = Afk::Scheduler::Access;
+
+  // Scripts run on events, and can do anything to the registry.
+  this->scheduler.add("Events", Access{}.writes_resource<entt::registry>().on_main_thread(),
+                      [this]() { this->update_window(); });
+  // Before physics, so bodies for new tiles are in this frame's step. Tiles'
+  // models are uploaded as they're loaded.
+  this->scheduler.add("Terrain streaming",
+                      Access{}.writes_resource<entt::registry>().on_main_thread(),
+                      [this]() { this->terrain_streamer.update(this->camera.get_position()); });
+  this->scheduler.add("Physics",
+                      Access{}
+                          .reads<Afk::Hierarchy>()
+                          .writes<Afk::Transform, Afk::WorldTransform>()
+                          .writes_resource<Afk::PhysicsBodySystem>(),
+                      [this]() {
+                        this->physics_body_system.update(&this->registry, this->delta_time);
+                      });
+  this->scheduler.add(
+      "Animation",
+      Access{}.writes<Afk::AnimationFrame>().reads_resource<Afk::EventManager>(),
+      [this]() { this->animation_control_system.update(&this->registry, this->delta_time); });
+  // After physics, so everything rendered this frame sees this frame's
+  // transforms.
+  this->scheduler.add("Transforms",
+                      Access{}
+                          .reads<Afk::Transform, Afk::Hierarchy>()
+                          .writes<Afk::WorldTransform>()
+                          .writes_resource<Afk::TransformSystem>(),
+                      [this]() { this->transform_system.update(&this->registry); });
+  // Last, so the frame's drawn as it finished. Selecting terrain chunks
+  // updates the terrain manager's selection.
+  this->scheduler.add("Frame extraction",
+                      Access{}
+                          .reads<Afk::WorldTransform, Afk::ModelSource, Afk::AnimationFrame,
+                                 Afk::Terrain>()
+                          .reads_resource<Afk::Camera, Afk::TerrainStreamer>()
+                          .writes_resource<Afk::TerrainManager, Afk::FramePacket>(),
+                      [this]() { this->extract_frame(); });
+}
+
 auto Engine::get() -> Engine & {
   static auto instance = Engine{};
 
@@ -103,17 +190,44 @@ auto Engine::exit() -> void {
 }
 
 auto Engine::render() -> void {
-  Afk::queue_models(&this->registry, &this->renderer);
+  // Whichever frame was extracted last, which is usually the one before the
+  // frame being simulated.
+  this->frame_packets.acquire();
 
   this->renderer.clear_screen({135.0f, 206.0f, 235.0f, 1.0f});
   this->ui.prepare();
-  this->renderer.draw();
+  this->renderer.draw(this->frame_packets.get_front());
+
+  // The UI looks at everything, so it waits until nothing else is.
+  this->scheduler.finish();
+  ++this->frame_count;
+  this->last_update = Afk::Engine::get_time();
+
   this->ui.draw();
   this->renderer.swap_buffers();
 }
 
 auto Engine::update() -> void {
+  this->delta_time = this->get_delta_time();
+  this->scheduler.start(&this->registry);
+  // Events and streaming touch GLFW and GL, and everything else waits on
+  // them, so they're run before the frame before is drawn.
+  Afk::JobSystem::get().run_main_jobs();
+}
+
+auto Engine::extract_frame() -> void {
+  auto &packet      = this->frame_packets.get_back();
+  packet.view       = this->camera.get_view_matrix();
+  packet.projection = this->camera.get_projection_matrix(this->window_size.x, this->window_size.y);
+  packet.frame      = static_cast<std::size_t>(this->frame_count);
+
+  Afk::extract_models(&this->registry, &packet);
+  this->frame_packets.publish();
+}
+
+auto Engine::update_window() -> void {
   this->event_manager.pump_events();
+  this->window_size = this->renderer.get_window_size();
 
   if (glfwWindowShouldClose(this->renderer.window)) {
     this->is_running = false;
@@ -124,14 +238,6 @@ auto Engine::update() -> void {
   } else {
     glfwSetInputMode(this->renderer.window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   }
-
-  // this->update_camera();
-
-  this->physics_body_system.update(&this->registry, this->get_delta_time());
-  this->animation_control_system.update(&this->registry, this->get_delta_time());
-
-  ++this->frame_count;
-  this->last_update = Afk::Engine::get_time();
 }
 
 auto Engine::get_time() -> float {
@@ -145,3 +251,7 @@ auto Engine::get_delta_time() -> float {
 auto Engine::get_is_running() const -> bool {
   return this->is_running;
 }
+
+auto Engine::get_frame_count() const -> std::size_t {
+  return static_cast<std::size_t>(this->frame_count);
+}
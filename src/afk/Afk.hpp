@@ -1,15 +1,22 @@
 #pragma once
 
+#include <cstddef>
+
 #include <entt/entt.hpp>
 #include <glm/glm.hpp>
 
 #include "afk/event/EventManager.hpp"
 #include "afk/physics/PhysicsBodySystem.hpp"
 #include "afk/renderer/Camera.hpp"
+#include "afk/renderer/FramePacket.hpp"
 #include "afk/renderer/Renderer.hpp"
 #include "afk/terrain/TerrainManager.hpp"
+#include "afk/terrain/TerrainStreamer.hpp"
 #include "afk/ui/Ui.hpp"
 #include "afk/component/AnimationControlSystem.hpp"
+#include "afk/component/TransformSystem.hpp"
+#include "afk/thread/Scheduler.hpp"
+#include "afk/thread/TripleBuffer.hpp"
 
 struct lua_State;
 namespace Afk {
@@ -17,14 +24,18 @@ namespace Afk {
   public:
     static constexpr const char *GAME_NAME = "ICT397";
 
-    Renderer renderer              = {};
-    EventManager event_manager     = {};
-    Ui ui                          = {};
-    Camera camera                  = {};
-    TerrainManager terrain_manager = {};
+    Renderer renderer                = {};
+    EventManager event_manager       = {};
+    Ui ui                            = {};
+    Camera camera                    = {};
+    TerrainManager terrain_manager   = {};
+    TerrainStreamer terrain_streamer = {};
     entt::registry registry;
     Afk::PhysicsBodySystem physics_body_system;
     Afk::AnimationControlSystem animation_control_system;
+    Afk::TransformSystem transform_system;
+    // Runs everything update does, in parallel where it can.
+    Afk::Scheduler scheduler;
     lua_State *lua;
 
     Engine()               = default;
@@ -37,17 +48,41 @@ namespace Afk {
 
     auto exit() -> void;
     auto initialize() -> void;
+    /**
+     * Draws the last frame simulated, while the next one's simulated, then
+     * waits for it to finish. Only called after update.
+     *
+     * Drawing stays on the main thread, where the GL context is, so GL
+     * submission, the UI and the main thread systems take turns on one
+     * thread, and a frame takes at least as long as the three together.
+     * Skinning palettes are still posed here, from each packet's animation
+     * frame, since the animation data lives with the renderer's models.
+     */
     auto render() -> void;
+    // Starts simulating the next frame, on the job system's workers.
     auto update() -> void;
 
     auto static get_time() -> float;
     auto get_delta_time() -> float;
     auto get_is_running() const -> bool;
+    // Frames simulated before the one being simulated now.
+    auto get_frame_count() const -> std::size_t;
 
   private:
     bool is_initialized = false;
     bool is_running     = true;
     int frame_count     = {};
     float last_update   = {};
+    // Read once a frame, so every system steps by the same time.
+    float delta_time = {};
+    // Kept from the last time the window was polled, since GLFW can only be
+    // asked from the main thread.
+    glm::ivec2 window_size = {};
+    // Handed from the frame extracting them to the one drawing them.
+    Afk::TripleBuffer<Afk::FramePacket> frame_packets;
+
+    auto add_systems() -> void;
+    auto update_window() -> void;
+    auto extract_frame() -> void;
   };
 }
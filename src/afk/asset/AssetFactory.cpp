@@ -23,7 +23,7 @@
 
 using Afk::Asset::Asset;
 using namespace std::string_literals;
-enum class Shape { Box, Sphere };
+enum class Shape { Box, Sphere, Mesh, Hull };
 
 static auto load_script(lua_State *lua, LuaRef tbl, Afk::GameObject owner)
     -> Afk::ScriptsComponent {
@@ -68,9 +68,10 @@ static auto load_object_asset(lua_State *lua) -> Asset {
 
     // bounciness = 0.1, linear_dampening = 0.4, angular_dampening = 0.4,
     // mass = 0.5, gravity = true, body_type = rigidbody.dynamic,
-    // shape = {type = shape.box}
+    // shape = {type = shape.box}, or just shape = shape.mesh
     auto shape      = LuaRef{phys["shape"]};
-    auto shape_type = static_cast<Shape>(shape["type"].cast<int>());
+    auto shape_type = static_cast<Shape>(shape.isNumber() ? shape.cast<int>()
+                                                          : shape["type"].cast<int>());
     switch (shape_type) {
       case Shape::Box: {
         auto box = Afk::Box{shape["x"].cast<float>(), shape["y"].cast<float>(),
@@ -93,15 +94,43 @@ static auto load_object_asset(lua_State *lua) -> Asset {
             static_cast<Afk::RigidBodyType>(phys["body_type"].cast<int>()), sphere);
         break;
       }
+      case Shape::Mesh:
+      case Shape::Hull: {
+        // Cooked from the object's own model, unless the shape names another.
+        auto model_path = LuaRef{components["model"]};
+        if (model_path.isTable()) {
+          model_path = LuaRef{model_path["path"]};
+        }
+        if (shape.isTable() && !shape["path"].isNil()) {
+          model_path = LuaRef{shape["path"]};
+        }
+        afk_assert(model_path.isString(), "Mesh and hull shapes need a model");
+        auto model_shape = Afk::ModelShape{
+            model_path.cast<std::string>(),
+            shape_type == Shape::Hull ? Afk::Collider::Type::Hull : Afk::Collider::Type::Mesh};
+        reg.assign<Afk::PhysicsBody>(
+            obj.ent, obj.ent, &Afk::Engine::get().physics_body_system,
+            reg.get<Afk::Transform>(obj.ent), phys["bounciness"].cast<float>(),
+            phys["linear_damping"].cast<float>(), phys["angular_damping"].cast<float>(),
+            phys["mass"].cast<float>(), phys["gravity"].cast<bool>(),
+            static_cast<Afk::RigidBodyType>(phys["body_type"].cast<int>()), model_shape);
+        break;
+      }
     }
   } // phys
   auto mdl = LuaRef{components["model"]};
   if (!mdl.isNil()) {
-    auto shader = mdl["shader"];
+    auto shader    = mdl["shader"];
+    auto keep_mesh = mdl["keep_mesh_data"];
+    // Models only keep their vertex and index arrays after upload if asked to.
+    const auto mesh_data_policy = !keep_mesh.isNil() && keep_mesh.cast<bool>()
+                                      ? Afk::Renderer::MeshDataPolicy::Keep
+                                      : Afk::Renderer::MeshDataPolicy::Release;
     reg.assign<Afk::ModelSource>(
         obj.ent, Afk::ModelSource{obj.ent, mdl["path"].cast<std::string>(),
                                   shader.isNil() ? "shader/default.prog"
-                                                 : shader.cast<std::string>()});
+                                                 : shader.cast<std::string>(),
+                                  mesh_data_policy});
   }
   auto script = LuaRef{components["script"]};
   if (!script.isNil()) {
@@ -143,8 +172,12 @@ auto Afk::Asset::game_asset_factory(const std::filesystem::path &path) -> Asset
   auto shape_enum = luabridge::getGlobalNamespace(lua).beginNamespace("shape");
   constexpr auto BOX    = static_cast<int>(Shape::Box);
   constexpr auto SPHERE = static_cast<int>(Shape::Sphere);
+  constexpr auto MESH   = static_cast<int>(Shape::Mesh);
+  constexpr auto HULL   = static_cast<int>(Shape::Hull);
   shape_enum.addVariable("box", const_cast<int *>(&BOX), false);
   shape_enum.addVariable("sphere", const_cast<int *>(&SPHERE), false);
+  shape_enum.addVariable("mesh", const_cast<int *>(&MESH), false);
+  shape_enum.addVariable("hull", const_cast<int *>(&HULL), false);
   shape_enum.endNamespace();
 
   auto abs_path   = Afk::get_absolute_path(path);
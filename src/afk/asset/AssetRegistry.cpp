@@ -0,0 +1,61 @@
+#include "afk/asset/AssetRegistry.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+#include "afk/debug/Assert.hpp"
+
+using namespace std::string_literals;
+using std::size_t;
+using std::filesystem::path;
+
+using Afk::Asset::AssetId;
+using Afk::Asset::AssetRegistry;
+
+auto AssetRegistry::get() -> AssetRegistry & {
+  static auto instance = AssetRegistry{};
+
+  return instance;
+}
+
+auto AssetRegistry::intern(const path &file_path) -> AssetId {
+  const auto normal_path = file_path.lexically_normal();
+  const auto key         = normal_path.generic_string();
+
+  {
+    auto lock     = std::shared_lock{this->mutex};
+    const auto id = this->ids.find(key);
+
+    if (id != this->ids.end()) {
+      return id->second;
+    }
+  }
+
+  auto lock = std::unique_lock{this->mutex};
+
+  // Another thread may have interned the path while the lock was released.
+  const auto [id, did_insert] = this->ids.try_emplace(key, static_cast<AssetId>(this->paths.size()));
+
+  if (did_insert) {
+    afk_assert(id->second != INVALID_ASSET_ID, "Too many assets interned");
+    this->paths.push_back(normal_path);
+  }
+
+  return id->second;
+}
+
+auto AssetRegistry::get_path(AssetId id) const -> const path & {
+  auto lock = std::shared_lock{this->mutex};
+
+  afk_assert(id < this->paths.size(), "Invalid asset ID "s + std::to_string(id));
+
+  return this->paths[id];
+}
+
+auto AssetRegistry::size() const -> size_t {
+  auto lock = std::shared_lock{this->mutex};
+
+  return this->paths.size();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Afk {
+  namespace Asset {
+    using AssetId = std::uint32_t;
+
+    constexpr auto INVALID_ASSET_ID = std::numeric_limits<AssetId>::max();
+
+    /**
+     * Interns asset paths into small, dense IDs.
+     *
+     * Each path is normalized and hashed once, when it's first interned, so hot
+     * lookups can index arrays by ID instead of hashing paths. IDs are never
+     * reused, and the path behind each ID is kept for logging and debugging.
+     * Interning is thread safe.
+     */
+    class AssetRegistry {
+    public:
+      AssetRegistry()                      = default;
+      AssetRegistry(AssetRegistry &&)      = delete;
+      AssetRegistry(const AssetRegistry &) = delete;
+      auto operator=(const AssetRegistry &) -> AssetRegistry & = delete;
+      auto operator=(AssetRegistry &&) -> AssetRegistry & = delete;
+
+      static auto get() -> AssetRegistry &;
+
+      auto intern(const std::filesystem::path &file_path) -> AssetId;
+      auto get_path(AssetId id) const -> const std::filesystem::path &;
+      auto size() const -> std::size_t;
+
+    private:
+      using Ids = std::unordered_map<std::string, AssetId>;
+      // A deque, so paths handed out stay put as more are interned.
+      using Paths = std::deque<std::filesystem::path>;
+
+      mutable std::shared_mutex mutex = {};
+      Ids ids                         = {};
+      Paths paths                     = {};
+    };
+  }
+}
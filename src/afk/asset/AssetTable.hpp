@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/debug/Assert.hpp"
+
+namespace Afk {
+  namespace Asset {
+    /**
+     * A dense table of resources indexed directly by asset ID.
+     *
+     * Slots for IDs without a resource are left empty and skipped over when
+     * iterating, which yields `(id, value)` pairs.
+     */
+    template<typename T>
+    class AssetTable {
+    public:
+      using Slots = std::vector<std::optional<T>>;
+
+      template<typename Value, typename SlotIterator>
+      class Iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::pair<AssetId, Value &>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = value_type;
+
+        Iterator(SlotIterator _slot, SlotIterator _end, AssetId _id)
+          : slot(_slot), end(_end), id(_id) {
+          this->skip_empty();
+        }
+
+        auto operator*() const -> reference {
+          return {this->id, **this->slot};
+        }
+
+        auto operator++() -> Iterator & {
+          ++this->slot;
+          ++this->id;
+          this->skip_empty();
+
+          return *this;
+        }
+
+        auto operator==(const Iterator &other) const -> bool {
+          return this->slot == other.slot;
+        }
+
+        auto operator!=(const Iterator &other) const -> bool {
+          return this->slot != other.slot;
+        }
+
+      private:
+        auto skip_empty() -> void {
+          while (this->slot != this->end && !this->slot->has_value()) {
+            ++this->slot;
+            ++this->id;
+          }
+        }
+
+        SlotIterator slot = {};
+        SlotIterator end  = {};
+        AssetId id        = {};
+      };
+
+      using iterator       = Iterator<T, typename Slots::iterator>;
+      using const_iterator = Iterator<const T, typename Slots::const_iterator>;
+
+      auto contains(AssetId id) const -> bool {
+        return id < this->slots.size() && this->slots[id].has_value();
+      }
+
+      auto find(AssetId id) -> T * {
+        return this->contains(id) ? &*this->slots[id] : nullptr;
+      }
+
+      auto find(AssetId id) const -> const T * {
+        return this->contains(id) ? &*this->slots[id] : nullptr;
+      }
+
+      auto at(AssetId id) -> T & {
+        afk_assert(this->contains(id), "No resource for asset " + describe(id));
+
+        return *this->slots[id];
+      }
+
+      auto at(AssetId id) const -> const T & {
+        afk_assert(this->contains(id), "No resource for asset " + describe(id));
+
+        return *this->slots[id];
+      }
+
+      // Default constructs the resource if there isn't one yet.
+      auto operator[](AssetId id) -> T & {
+        if (!this->contains(id)) {
+          return this->insert(id, T{});
+        }
+
+        return *this->slots[id];
+      }
+
+      auto insert(AssetId id, T value) -> T & {
+        afk_assert(id != INVALID_ASSET_ID, "Invalid asset ID");
+
+        if (id >= this->slots.size()) {
+          this->slots.resize(static_cast<std::size_t>(id) + 1);
+        }
+
+        if (!this->slots[id].has_value()) {
+          ++this->count;
+        }
+
+        this->slots[id] = std::move(value);
+
+        return *this->slots[id];
+      }
+
+      auto erase(AssetId id) -> void {
+        if (this->contains(id)) {
+          this->slots[id].reset();
+          --this->count;
+        }
+      }
+
+      auto size() const -> std::size_t {
+        return this->count;
+      }
+
+      auto empty() const -> bool {
+        return this->count == 0;
+      }
+
+      auto begin() -> iterator {
+        return {this->slots.begin(), this->slots.end(), 0};
+      }
+
+      auto end() -> iterator {
+        return {this->slots.end(), this->slots.end(), static_cast<AssetId>(this->slots.size())};
+      }
+
+      auto begin() const -> const_iterator {
+        return {this->slots.begin(), this->slots.end(), 0};
+      }
+
+      auto end() const -> const_iterator {
+        return {this->slots.end(), this->slots.end(), static_cast<AssetId>(this->slots.size())};
+      }
+
+    private:
+      static auto describe(AssetId id) -> std::string {
+        if (id < AssetRegistry::get().size()) {
+          return "'" + AssetRegistry::get().get_path(id).string() + "'";
+        }
+
+        return std::to_string(id);
+      }
+
+      Slots slots       = {};
+      std::size_t count = 0;
+    };
+  }
+}
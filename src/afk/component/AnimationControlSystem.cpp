@@ -4,6 +4,7 @@
 #include "afk/Afk.hpp"
 #include "afk/component/AnimationFrame.hpp"
 #include "afk/physics/PhysicsBody.hpp"
+#include "afk/thread/JobSystem.hpp"
 
 auto Afk::AnimationControlSystem::update(entt::registry *registry, double dt) -> void {
   // advance animation time if any key is down
@@ -36,8 +37,10 @@ auto Afk::AnimationControlSystem::update(entt::registry *registry, double dt) ->
 //        collision.apply_force(move_direction);
 //      });
 
-  auto view = registry->view<Afk::AnimationFrame>();
-  for (auto &entity : view) {
-    view.get<Afk::AnimationFrame>(entity).time = this->current_animation_time;
-  }
+  auto view       = registry->view<Afk::AnimationFrame>();
+  const auto time = this->current_animation_time;
+
+  Afk::JobSystem::get().parallel_for_each(view, [&view, time](Afk::GameObject entity) {
+    view.get<Afk::AnimationFrame>(entity).time = time;
+  });
 }
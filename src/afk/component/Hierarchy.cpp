@@ -0,0 +1,8 @@
+#include "afk/component/Hierarchy.hpp"
+
+using Afk::Hierarchy;
+
+Hierarchy::Hierarchy(GameObject e, GameObject _parent) {
+  this->owning_entity = e;
+  this->parent        = _parent;
+}
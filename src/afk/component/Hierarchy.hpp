@@ -0,0 +1,20 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include "afk/component/BaseComponent.hpp"
+#include "afk/component/GameObject.hpp"
+
+namespace Afk {
+  /**
+   * Attaches an entity's transform to another entity's, so it's relative to
+   * that entity rather than the world. Change the parent through
+   * TransformSystem::set_parent, which also checks for cycles.
+   */
+  struct Hierarchy : public BaseComponent {
+    GameObject parent = {entt::null};
+
+    Hierarchy() = default;
+    Hierarchy(GameObject e, GameObject _parent);
+  };
+}
@@ -0,0 +1,180 @@
+#include "afk/component/TransformBatch.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "afk/component/TransformSystem.hpp"
+#include "afk/thread/JobSystem.hpp"
+
+using std::size_t;
+using std::vector;
+
+using Afk::Transform;
+using Afk::TransformBatch;
+
+auto TransformBatch::clear() -> void {
+  for (auto *floats : {&this->translation_x, &this->translation_y, &this->translation_z,
+                       &this->rotation_x, &this->rotation_y, &this->rotation_z,
+                       &this->rotation_w, &this->scale_x, &this->scale_y, &this->scale_z}) {
+    floats->clear();
+  }
+
+  this->count = 0;
+}
+
+auto TransformBatch::reserve(size_t _count) -> void {
+  const auto padded = (_count + LANES - 1) / LANES * LANES;
+
+  for (auto *floats : {&this->translation_x, &this->translation_y, &this->translation_z,
+                       &this->rotation_x, &this->rotation_y, &this->rotation_z,
+                       &this->rotation_w, &this->scale_x, &this->scale_y, &this->scale_z}) {
+    floats->reserve(padded);
+  }
+
+  this->matrices.reserve(padded);
+}
+
+auto TransformBatch::push(const Transform &transform) -> void {
+  this->translation_x.push_back(transform.translation.x);
+  this->translation_y.push_back(transform.translation.y);
+  this->translation_z.push_back(transform.translation.z);
+  this->rotation_x.push_back(transform.rotation.x);
+  this->rotation_y.push_back(transform.rotation.y);
+  this->rotation_z.push_back(transform.rotation.z);
+  this->rotation_w.push_back(transform.rotation.w);
+  this->scale_x.push_back(transform.scale.x);
+  this->scale_y.push_back(transform.scale.y);
+  this->scale_z.push_back(transform.scale.z);
+  ++this->count;
+}
+
+auto TransformBatch::build() -> void {
+  // Pad out to a whole number of iterations with identity transforms, so the
+  // kernel never needs a scalar tail.
+  const auto padded = (this->count + LANES - 1) / LANES * LANES;
+
+  for (auto *floats : {&this->translation_x, &this->translation_y, &this->translation_z,
+                       &this->rotation_x, &this->rotation_y, &this->rotation_z}) {
+    floats->resize(padded, 0.0f);
+  }
+
+  for (auto *floats : {&this->rotation_w, &this->scale_x, &this->scale_y, &this->scale_z}) {
+    floats->resize(padded, 1.0f);
+  }
+
+  this->matrices.resize(padded);
+
+  const auto *tx = this->translation_x.data();
+  const auto *ty = this->translation_y.data();
+  const auto *tz = this->translation_z.data();
+  const auto *qx = this->rotation_x.data();
+  const auto *qy = this->rotation_y.data();
+  const auto *qz = this->rotation_z.data();
+  const auto *qw = this->rotation_w.data();
+  const auto *sx = this->scale_x.data();
+  const auto *sy = this->scale_y.data();
+  const auto *sz = this->scale_z.data();
+
+  // Chunks are whole iterations, and each writes matrices of its own.
+  JobSystem::get().parallel_for(
+      padded / LANES,
+      [&](size_t first, size_t last) {
+        for (auto base = first * LANES; base < last * LANES; base += LANES) {
+          // Column major, one row of LANES floats per matrix element.
+          float m[12][LANES];
+
+          // Same as translate(T) * mat4_cast(R) * scale(S), without the zero terms.
+          for (auto lane = size_t{0}; lane < LANES; ++lane) {
+            const auto i = base + lane;
+
+            const auto xx = qx[i] * qx[i];
+            const auto yy = qy[i] * qy[i];
+            const auto zz = qz[i] * qz[i];
+            const auto xy = qx[i] * qy[i];
+            const auto xz = qx[i] * qz[i];
+            const auto yz = qy[i] * qz[i];
+            const auto wx = qw[i] * qx[i];
+            const auto wy = qw[i] * qy[i];
+            const auto wz = qw[i] * qz[i];
+
+            m[0][lane]  = (1.0f - 2.0f * (yy + zz)) * sx[i];
+            m[1][lane]  = 2.0f * (xy + wz) * sx[i];
+            m[2][lane]  = 2.0f * (xz - wy) * sx[i];
+            m[3][lane]  = 2.0f * (xy - wz) * sy[i];
+            m[4][lane]  = (1.0f - 2.0f * (xx + zz)) * sy[i];
+            m[5][lane]  = 2.0f * (yz + wx) * sy[i];
+            m[6][lane]  = 2.0f * (xz + wy) * sz[i];
+            m[7][lane]  = 2.0f * (yz - wx) * sz[i];
+            m[8][lane]  = (1.0f - 2.0f * (xx + yy)) * sz[i];
+            m[9][lane]  = tx[i];
+            m[10][lane] = ty[i];
+            m[11][lane] = tz[i];
+          }
+
+          // Scatter the lanes out into contiguous matrices.
+          for (auto lane = size_t{0}; lane < LANES; ++lane) {
+            auto &matrix = this->matrices[base + lane];
+
+            matrix[0] = glm::vec4{m[0][lane], m[1][lane], m[2][lane], 0.0f};
+            matrix[1] = glm::vec4{m[3][lane], m[4][lane], m[5][lane], 0.0f};
+            matrix[2] = glm::vec4{m[6][lane], m[7][lane], m[8][lane], 0.0f};
+            matrix[3] = glm::vec4{m[9][lane], m[10][lane], m[11][lane], 1.0f};
+          }
+        }
+      });
+
+  this->matrices.resize(this->count);
+}
+
+auto TransformBatch::size() const -> size_t {
+  return this->count;
+}
+
+auto TransformBatch::empty() const -> bool {
+  return this->count == 0;
+}
+
+auto TransformBatch::get_matrices() const -> const Matrices & {
+  return this->matrices;
+}
+
+auto TransformBatch::measure_throughput(size_t _count, bool is_batched) -> double {
+  auto rng          = std::mt19937{static_cast<std::mt19937::result_type>(_count)};
+  auto distribution = std::uniform_real_distribution<float>{-1.0f, 1.0f};
+  auto transforms   = vector<Transform>(_count);
+
+  for (auto &transform : transforms) {
+    transform.translation = {distribution(rng), distribution(rng), distribution(rng)};
+    transform.scale       = {distribution(rng), distribution(rng), distribution(rng)};
+    transform.rotation    = glm::normalize(
+        glm::quat{distribution(rng), distribution(rng), distribution(rng), distribution(rng)});
+  }
+
+  auto batch    = TransformBatch{};
+  auto matrices = Matrices(_count);
+  batch.reserve(_count);
+
+  const auto start = std::chrono::steady_clock::now();
+
+  if (is_batched) {
+    for (const auto &transform : transforms) {
+      batch.push(transform);
+    }
+
+    batch.build();
+  } else {
+    for (auto i = size_t{0}; i < _count; ++i) {
+      matrices[i] = TransformSystem::get_matrix(transforms[i]);
+    }
+  }
+
+  const auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - start};
+
+  return elapsed.count() > 0.0 ? static_cast<double>(_count) / elapsed.count() : 0.0;
+}
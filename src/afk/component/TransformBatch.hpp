@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/physics/Transform.hpp"
+
+namespace Afk {
+  /**
+   * Builds model matrices for many transforms at once.
+   *
+   * Transforms are gathered into one array per scalar, so the kernel can build
+   * LANES matrices per iteration with straight-line code the compiler turns
+   * into vector instructions. The matrices end up in a single contiguous
+   * buffer, in the order the transforms were pushed, ready to be copied or
+   * uploaded as is.
+   */
+  class TransformBatch {
+  public:
+    using Matrices = std::vector<glm::mat4>;
+
+    // Wide enough for AVX, and a multiple of SSE/NEON's width.
+    static constexpr auto LANES = std::size_t{8};
+
+    auto clear() -> void;
+    auto reserve(std::size_t count) -> void;
+    auto push(const Transform &transform) -> void;
+    auto build() -> void;
+
+    auto size() const -> std::size_t;
+    auto empty() const -> bool;
+    auto get_matrices() const -> const Matrices &;
+
+    /**
+     * Returns how many matrices per second are built from count random
+     * transforms, either batched or one at a time with GLM.
+     */
+    static auto measure_throughput(std::size_t count, bool is_batched) -> double;
+
+  private:
+    using Floats = std::vector<float>;
+
+    Floats translation_x = {};
+    Floats translation_y = {};
+    Floats translation_z = {};
+    Floats rotation_x    = {};
+    Floats rotation_y    = {};
+    Floats rotation_z    = {};
+    Floats rotation_w    = {};
+    Floats scale_x       = {};
+    Floats scale_y       = {};
+    Floats scale_z       = {};
+    Matrices matrices    = {};
+    std::size_t count    = 0;
+  };
+}
@@ -0,0 +1,238 @@
+#include "afk/component/TransformSystem.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "afk/component/Hierarchy.hpp"
+#include "afk/component/WorldTransform.hpp"
+#include "afk/debug/Assert.hpp"
+#include "afk/thread/JobSystem.hpp"
+
+using std::size_t;
+using std::vector;
+
+using glm::mat4;
+
+using Afk::GameObject;
+using Afk::Hierarchy;
+using Afk::JobSystem;
+using Afk::Transform;
+using Afk::TransformSystem;
+using Afk::WorldTransform;
+
+auto TransformSystem::initialize(entt::registry *registry) -> void {
+  registry->on_replace<Hierarchy>().connect<&TransformSystem::on_hierarchy_replaced>(*this);
+}
+
+auto TransformSystem::update(entt::registry *registry) -> void {
+  // Give anything spawned since the last update somewhere to cache its matrix.
+  auto unattached = vector<GameObject>{};
+  for (const auto entity : registry->view<Transform>(entt::exclude<WorldTransform>)) {
+    unattached.push_back(entity);
+  }
+
+  for (const auto entity : unattached) {
+    registry->assign<WorldTransform>(entity, entity);
+  }
+
+  auto roots = registry->view<Transform, WorldTransform>(entt::exclude<Hierarchy>);
+  for (const auto entity : roots) {
+    this->queue_update(roots.get<Transform>(entity), roots.get<WorldTransform>(entity), nullptr);
+  }
+
+  this->flush();
+  this->sort_hierarchy(registry);
+
+  // Every parent is a level above its children, so each level only depends on
+  // ones already flushed.
+  for (auto level = size_t{0}; level + 1 < this->levels.size(); ++level) {
+    for (auto i = this->levels[level]; i < this->levels[level + 1]; ++i) {
+      const auto entity     = this->order[i];
+      auto *transform       = registry->try_get<Transform>(entity);
+      auto *world_transform = registry->try_get<WorldTransform>(entity);
+
+      if (transform == nullptr || world_transform == nullptr) {
+        continue;
+      }
+
+      const auto parent = registry->get<Hierarchy>(entity).parent;
+      const auto *parent_world_transform =
+          registry->valid(parent) ? registry->try_get<WorldTransform>(parent) : nullptr;
+
+      this->queue_update(*transform, *world_transform, parent_world_transform);
+    }
+
+    this->flush();
+  }
+}
+
+auto TransformSystem::set_parent(entt::registry *registry, GameObject child, GameObject parent)
+    -> void {
+  afk_assert(registry->valid(child), "Invalid child entity");
+
+  if (parent == entt::null) {
+    registry->remove_if_exists<Hierarchy>(child);
+  } else {
+    afk_assert(registry->valid(parent), "Invalid parent entity");
+
+    // Walk up from the new parent to make sure the child isn't one of its ancestors.
+    for (auto ancestor = parent; ancestor != entt::null;) {
+      afk_assert(ancestor != child, "Entity can't be its own ancestor");
+
+      const auto *hierarchy = registry->try_get<Hierarchy>(ancestor);
+      ancestor              = hierarchy != nullptr ? hierarchy->parent : entt::null;
+    }
+
+    registry->assign_or_replace<Hierarchy>(child, child, parent);
+  }
+
+  if (auto *world_transform = registry->try_get<WorldTransform>(child)) {
+    world_transform->is_dirty = true;
+  }
+
+  this->is_order_dirty = true;
+}
+
+auto TransformSystem::on_hierarchy_replaced([[maybe_unused]] entt::registry &registry,
+                                            [[maybe_unused]] GameObject entity,
+                                            [[maybe_unused]] Hierarchy &hierarchy) -> void {
+  // Reparenting keeps the pool the same size, so sort_hierarchy can't tell.
+  this->is_order_dirty = true;
+}
+
+auto TransformSystem::get_matrix(const Transform &transform) -> mat4 {
+  auto matrix = mat4{1.0f};
+  matrix      = glm::translate(matrix, transform.translation);
+  matrix *= glm::mat4_cast(transform.rotation);
+  matrix = glm::scale(matrix, transform.scale);
+
+  return matrix;
+}
+
+auto TransformSystem::sort_hierarchy(entt::registry *registry) -> void {
+  auto attached = registry->view<Hierarchy>();
+
+  // Entities attached or destroyed without going through set_parent.
+  if (attached.size() != this->order.size() ||
+      std::any_of(this->order.begin(), this->order.end(),
+                  [registry](GameObject entity) { return !registry->valid(entity); })) {
+    this->is_order_dirty = true;
+  }
+
+  if (!this->is_order_dirty) {
+    return;
+  }
+
+  auto depths = std::unordered_map<GameObject, size_t>{};
+
+  // Depths are memoised, so each entity's ancestors are only walked once.
+  const auto get_depth = [registry, &attached, &depths](GameObject entity) {
+    auto chain    = vector<GameObject>{};
+    auto depth    = size_t{0};
+    auto ancestor = entity;
+
+    // Walk up until reaching a root, or an ancestor with a known depth.
+    while (depths.count(ancestor) == 0) {
+      const auto *hierarchy =
+          registry->valid(ancestor) ? registry->try_get<Hierarchy>(ancestor) : nullptr;
+
+      if (hierarchy == nullptr) {
+        break;
+      }
+
+      afk_assert(chain.size() < attached.size(), "Transform hierarchy has a cycle");
+      chain.push_back(ancestor);
+      ancestor = hierarchy->parent;
+    }
+
+    if (depths.count(ancestor) > 0) {
+      depth = depths.at(ancestor);
+    }
+
+    for (auto i = chain.size(); i-- > 0;) {
+      depths[chain[i]] = ++depth;
+    }
+  };
+
+  this->order.clear();
+  this->order.reserve(attached.size());
+
+  for (const auto entity : attached) {
+    get_depth(entity);
+    this->order.push_back(entity);
+  }
+
+  std::stable_sort(this->order.begin(), this->order.end(),
+                   [&depths](GameObject lhs, GameObject rhs) {
+                     return depths.at(lhs) < depths.at(rhs);
+                   });
+
+  // Remember where each depth starts, so levels can be batched separately.
+  this->levels.clear();
+  for (auto i = size_t{0}; i < this->order.size(); ++i) {
+    if (i == 0 || depths.at(this->order[i]) != depths.at(this->order[i - 1])) {
+      this->levels.push_back(i);
+    }
+  }
+  this->levels.push_back(this->order.size());
+
+  this->is_order_dirty = false;
+}
+
+auto TransformSystem::queue_update(const Transform &transform, WorldTransform &world_transform,
+                                   const WorldTransform *parent) -> void {
+  const auto parent_version = parent != nullptr ? parent->version : WorldTransform::Version{0};
+  const auto is_unchanged   = world_transform.translation == transform.translation &&
+                            world_transform.rotation == transform.rotation &&
+                            world_transform.scale == transform.scale;
+
+  if (!world_transform.is_dirty && is_unchanged &&
+      world_transform.parent_version == parent_version) {
+    return;
+  }
+
+  this->batch.push(transform);
+  this->pending.push_back({&transform, &world_transform, parent});
+}
+
+auto TransformSystem::flush() -> void {
+  if (this->batch.empty()) {
+    return;
+  }
+
+  this->batch.build();
+
+  const auto &locals = this->batch.get_matrices();
+
+  // Every update is to a different entity, and parents are a level up, so
+  // they're split between threads as is.
+  JobSystem::get().parallel_for(this->pending.size(), [this, &locals](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      const auto &[transform, world_transform, parent] = this->pending[i];
+
+      if (parent != nullptr) {
+        world_transform->matrix         = parent->matrix * locals[i];
+        world_transform->parent_version = parent->version;
+      } else {
+        world_transform->matrix         = locals[i];
+        world_transform->parent_version = 0;
+      }
+
+      world_transform->translation = transform->translation;
+      world_transform->rotation    = transform->rotation;
+      world_transform->scale       = transform->scale;
+      world_transform->is_dirty    = false;
+      ++world_transform->version;
+    }
+  });
+
+  this->batch.clear();
+  this->pending.clear();
+}
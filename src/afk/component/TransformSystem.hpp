@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "afk/component/GameObject.hpp"
+#include "afk/component/TransformBatch.hpp"
+#include "afk/physics/Transform.hpp"
+
+namespace Afk {
+  struct Hierarchy;
+  struct WorldTransform;
+
+  /**
+   * Keeps every entity's WorldTransform in sync with its Transform and those
+   * of its ancestors.
+   *
+   * Roots are updated first, then attached entities in order of depth, so a
+   * parent's world matrix is always up to date before its children read it.
+   * Entities whose transform and ancestors haven't changed are skipped, and
+   * the rest have their local matrices built together, one level at a time.
+   */
+  class TransformSystem {
+  public:
+    // Watches for hierarchies replaced without going through set_parent.
+    auto initialize(entt::registry *registry) -> void;
+    auto update(entt::registry *registry) -> void;
+
+    /**
+     * Attaches child to parent, or detaches it if parent is null.
+     */
+    auto set_parent(entt::registry *registry, GameObject child, GameObject parent) -> void;
+
+    static auto get_matrix(const Transform &transform) -> glm::mat4;
+
+  private:
+    struct Update {
+      const Transform *transform      = nullptr;
+      WorldTransform *world_transform = nullptr;
+      const WorldTransform *parent    = nullptr;
+    };
+
+    using Order   = std::vector<GameObject>;
+    using Levels  = std::vector<std::size_t>;
+    using Updates = std::vector<Update>;
+
+    auto sort_hierarchy(entt::registry *registry) -> void;
+    auto on_hierarchy_replaced(entt::registry &registry, GameObject entity, Hierarchy &hierarchy)
+        -> void;
+    auto queue_update(const Transform &transform, WorldTransform &world_transform,
+                      const WorldTransform *parent) -> void;
+    auto flush() -> void;
+
+    // Attached entities, shallowest first.
+    Order order = {};
+    // Where each depth starts in the order, followed by its end.
+    Levels levels        = {};
+    bool is_order_dirty  = true;
+    TransformBatch batch = {};
+    Updates pending      = {};
+  };
+}
@@ -0,0 +1,13 @@
+#include "afk/component/WorldTransform.hpp"
+
+#include <glm/glm.hpp>
+
+using Afk::WorldTransform;
+
+WorldTransform::WorldTransform(GameObject e) {
+  this->owning_entity = e;
+}
+
+auto WorldTransform::get_position() const -> glm::vec3 {
+  return glm::vec3{this->matrix[3]};
+}
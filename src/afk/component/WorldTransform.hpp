@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "afk/component/BaseComponent.hpp"
+
+namespace Afk {
+  /**
+   * An entity's transform relative to the world, cached by the transform
+   * system. Only recomputed when the entity's Transform or one of its
+   * ancestors' changes.
+   */
+  struct WorldTransform : public BaseComponent {
+    using Version = std::uint64_t;
+
+    glm::mat4 matrix = glm::mat4{1.0f};
+    // Forces a recompute next update, for changes the system can't see.
+    bool is_dirty = true;
+    // Bumped every time the matrix is recomputed, so children can tell.
+    Version version = 0;
+
+    // What the matrix was last computed from.
+    glm::vec3 translation  = glm::vec3{0.0f};
+    glm::vec3 scale        = glm::vec3{1.0f};
+    glm::quat rotation     = glm::quat{1.0f, 0.0f, 0.0f, 0.0f};
+    Version parent_version = 0;
+
+    WorldTransform() = default;
+    WorldTransform(GameObject e);
+
+    auto get_position() const -> glm::vec3;
+  };
+}
@@ -1,8 +1,16 @@
 #include "ModelSource.hpp"
 
+#include "afk/Afk.hpp"
+#include "afk/asset/AssetRegistry.hpp"
+
 Afk::ModelSource::ModelSource(GameObject e, const std::filesystem::path &name_,
-                              const std::filesystem::path &shader_path) {
-  this->owning_entity = e;
-  this->name          = name_;
-  this->shader_program_path = shader_path;
+                              const std::filesystem::path &shader_path,
+                              Renderer::MeshDataPolicy mesh_data_policy) {
+  auto &assets = Afk::Asset::AssetRegistry::get();
+
+  this->owning_entity     = e;
+  this->name              = name_;
+  this->model_id          = assets.intern(name_);
+  this->shader_program_id = assets.intern(shader_path);
+  this->reference         = Afk::Engine::get().renderer.acquire_model(this->model_id, mesh_data_policy);
 }
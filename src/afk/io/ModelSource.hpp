@@ -1,6 +1,9 @@
 #pragma once
 
+#include "afk/asset/AssetRegistry.hpp"
 #include "afk/component/BaseComponent.hpp"
+#include "afk/renderer/Renderer.hpp"
+#include "afk/renderer/ResourceManager.hpp"
 
 #include <string>
 #include <filesystem>
@@ -8,9 +11,15 @@
 namespace Afk {
   class ModelSource : public BaseComponent {
   public:
+    // Models only keep their vertex and index arrays after upload if asked to.
     ModelSource(GameObject e, const std::filesystem::path &name_,
-                const std::filesystem::path &shader_path);
+                const std::filesystem::path &shader_path,
+                Renderer::MeshDataPolicy mesh_data_policy = Renderer::MeshDataPolicy::Release);
+    // Kept for scripts and debugging; rendering only uses the IDs.
     std::filesystem::path name;
-    std::filesystem::path shader_program_path;
+    Asset::AssetId model_id          = Asset::INVALID_ASSET_ID;
+    Asset::AssetId shader_program_id = Asset::INVALID_ASSET_ID;
+    // Keeps the model loaded for as long as this component exists.
+    ResourceManager::Reference reference;
   };
 }
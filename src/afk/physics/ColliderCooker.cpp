@@ -0,0 +1,504 @@
+#include "afk/physics/ColliderCooker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "afk/debug/Assert.hpp"
+#include "afk/io/ModelLoader.hpp"
+#include "afk/io/Path.hpp"
+
+using namespace std::string_literals;
+using std::array;
+using std::ifstream;
+using std::ofstream;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+using std::filesystem::path;
+
+using glm::mat4;
+using glm::vec3;
+using glm::vec4;
+
+using Afk::Collider;
+using Index    = Afk::Collider::Index;
+using Vertices = Afk::Collider::Vertices;
+using Indices  = Afk::Collider::Indices;
+// Nodes that can't be reached from the root have none, and aren't drawn.
+using NodeMatrices = vector<std::optional<mat4>>;
+
+constexpr auto container_magic = uint32_t{0x434b4641}; // "AFKC"
+
+struct ContainerHeader {
+  uint32_t magic        = container_magic;
+  uint32_t version      = Afk::ColliderCooker::VERSION;
+  Collider::Type type   = Collider::Type::Mesh;
+  uint64_t vertex_count = {};
+  uint64_t index_count  = {};
+};
+
+struct HullFace {
+  array<Index, 3> vertices = {};
+  vec3 normal              = {};
+  float offset             = {};
+  bool is_alive            = true;
+};
+
+struct PositionHash {
+  auto operator()(const vec3 &position) const -> size_t {
+    const auto hash = std::hash<float>{};
+
+    return hash(position.x) ^ (hash(position.y) << 1) ^ (hash(position.z) << 2);
+  }
+};
+
+static auto read_file(const path &file_path) -> vector<unsigned char> {
+  auto file = ifstream{file_path, std::ios::binary};
+
+  afk_assert(file.is_open(), "Unable to open model '"s + file_path.string() + "'"s);
+
+  return vector<unsigned char>{std::istreambuf_iterator<char>{file},
+                               std::istreambuf_iterator<char>{}};
+}
+
+static auto hash(const vector<unsigned char> &bytes) -> uint64_t {
+  // 64-bit FNV-1a, as textures are keyed.
+  auto value = uint64_t{0xcbf29ce484222325};
+
+  for (const auto byte : bytes) {
+    value ^= byte;
+    value *= uint64_t{0x100000001b3};
+  }
+
+  return value;
+}
+
+// Every node's transform relative to the model's root, built the same way
+// the renderer builds its world matrices.
+static auto get_node_matrices(const Afk::Model &model) -> NodeMatrices {
+  auto matrices = NodeMatrices(model.nodes.size());
+  auto stack    = vector<std::pair<size_t, mat4>>{};
+
+  if (!model.nodes.empty()) {
+    stack.emplace_back(model.root_node_index, mat4{1.0f});
+  }
+
+  while (!stack.empty()) {
+    const auto [index, parent] = stack.back();
+    stack.pop_back();
+
+    afk_assert(index < model.nodes.size(), "Invalid node index");
+    afk_assert(!matrices[index].has_value(), "Node hierarchy has a cycle");
+
+    const auto &node = model.nodes[index];
+    auto matrix      = glm::translate(parent, node.transform.translation);
+    matrix *= glm::mat4_cast(node.transform.rotation);
+    matrix = glm::scale(matrix, node.transform.scale);
+
+    matrices[index] = matrix;
+
+    for (const auto child : node.child_ids) {
+      stack.emplace_back(child, matrix);
+    }
+  }
+
+  return matrices;
+}
+
+// Welds every vertex shared between triangles, and drops triangles that are
+// only lines or points once welded.
+static auto gather_triangles(const Afk::Model &model) -> Collider {
+  const auto matrices = get_node_matrices(model);
+
+  auto collider = Collider{};
+  auto welded   = std::unordered_map<vec3, Index, PositionHash>{};
+  collider.type = Collider::Type::Mesh;
+
+  for (const auto &mesh : model.meshes) {
+    if (mesh.node_id >= matrices.size() || !matrices[mesh.node_id].has_value()) {
+      continue;
+    }
+
+    const auto &matrix = *matrices[mesh.node_id];
+
+    for (auto i = size_t{0}; i + 2 < mesh.indices.size(); i += 3) {
+      auto triangle = array<Index, 3>{};
+
+      for (auto j = size_t{0}; j < 3; ++j) {
+        const auto position =
+            vec3{matrix * vec4{mesh.vertices[mesh.indices[i + j]].position, 1.0f}};
+        const auto found = welded.find(position);
+
+        if (found != welded.end()) {
+          triangle[j] = found->second;
+        } else {
+          triangle[j] = static_cast<Index>(collider.vertices.size());
+          welded.emplace(position, triangle[j]);
+          collider.vertices.push_back(position);
+        }
+      }
+
+      const auto &a = collider.vertices[triangle[0]];
+      const auto &b = collider.vertices[triangle[1]];
+      const auto &c = collider.vertices[triangle[2]];
+
+      if (glm::length(glm::cross(b - a, c - a)) > 0.0f) {
+        collider.indices.insert(collider.indices.end(), triangle.begin(), triangle.end());
+      }
+    }
+  }
+
+  return collider;
+}
+
+// Faces away from interior, a point inside the hull.
+static auto make_face(const Vertices &points, Index a, Index b, Index c, vec3 interior)
+    -> HullFace {
+  auto normal = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+
+  if (glm::dot(normal, interior - points[a]) > 0.0f) {
+    std::swap(b, c);
+    normal = -normal;
+  }
+
+  return HullFace{{a, b, c}, normal, glm::dot(normal, points[a]), true};
+}
+
+// A box around the points, for when they don't span a volume to wrap.
+static auto make_box_hull(vec3 min, vec3 max, float padding) -> Collider {
+  constexpr auto triangles = array<Index, 36>{0, 1, 2, 1, 2, 3, 4, 5, 6, 5, 6, 7, 0, 1, 4, 1, 4, 5,
+                                              2, 3, 6, 3, 6, 7, 0, 2, 4, 2, 4, 6, 1, 3, 5, 3, 5, 7};
+
+  min -= vec3{padding};
+  max += vec3{padding};
+
+  auto collider = Collider{};
+  collider.type = Collider::Type::Hull;
+
+  for (auto i = 0; i < 8; ++i) {
+    collider.vertices.emplace_back((i & 4) != 0 ? max.x : min.x, (i & 2) != 0 ? max.y : min.y,
+                                   (i & 1) != 0 ? max.z : min.z);
+  }
+
+  for (auto i = size_t{0}; i < triangles.size(); i += 3) {
+    const auto face = make_face(collider.vertices, triangles[i], triangles[i + 1],
+                                triangles[i + 2], (min + max) * 0.5f);
+
+    collider.indices.insert(collider.indices.end(), face.vertices.begin(), face.vertices.end());
+  }
+
+  return collider;
+}
+
+/**
+ * Wraps the points in their convex hull, adding them one at a time. Each
+ * point outside the hull so far removes the faces it can see, and joins the
+ * horizon they leave to itself.
+ */
+static auto wrap_hull(const Vertices &points) -> Collider {
+  afk_assert(!points.empty(), "Can't wrap a hull around nothing");
+
+  auto min = points.front();
+  auto max = points.front();
+
+  for (const auto &point : points) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+
+  // Scaled to the model, so a point has to be clearly outside to count.
+  const auto epsilon = std::max(glm::length(max - min) * 1e-5f, 1e-6f);
+
+  // Start from the two points furthest apart along an axis, then the
+  // furthest from the line between them, then from the plane of all three.
+  auto first  = Index{0};
+  auto second = Index{0};
+
+  for (auto axis = 0; axis < 3; ++axis) {
+    const auto [low, high] = std::minmax_element(
+        points.begin(), points.end(),
+        [axis](const vec3 &a, const vec3 &b) { return a[axis] < b[axis]; });
+
+    if (glm::distance(*low, *high) > glm::distance(points[first], points[second])) {
+      first  = static_cast<Index>(low - points.begin());
+      second = static_cast<Index>(high - points.begin());
+    }
+  }
+
+  const auto line = glm::normalize(points[second] - points[first]);
+  auto third      = Index{0};
+  auto fourth     = Index{0};
+  auto best       = 0.0f;
+
+  for (auto i = Index{0}; i < points.size(); ++i) {
+    const auto distance = glm::length(glm::cross(points[i] - points[first], line));
+
+    if (distance > best) {
+      third = i;
+      best  = distance;
+    }
+  }
+
+  const auto plane = glm::normalize(
+      glm::cross(points[second] - points[first], points[third] - points[first]));
+  best = 0.0f;
+
+  for (auto i = Index{0}; i < points.size(); ++i) {
+    const auto distance = std::abs(glm::dot(points[i] - points[first], plane));
+
+    if (distance > best) {
+      fourth = i;
+      best   = distance;
+    }
+  }
+
+  if (glm::distance(points[first], points[second]) <= epsilon || best <= epsilon ||
+      glm::length(glm::cross(points[third] - points[first], line)) <= epsilon) {
+    return make_box_hull(min, max, epsilon);
+  }
+
+  const auto interior =
+      (points[first] + points[second] + points[third] + points[fourth]) * 0.25f;
+
+  auto faces = vector<HullFace>{make_face(points, first, second, third, interior),
+                                make_face(points, first, second, fourth, interior),
+                                make_face(points, first, third, fourth, interior),
+                                make_face(points, second, third, fourth, interior)};
+  auto visible_edges = vector<std::pair<Index, Index>>{};
+  auto horizon       = vector<std::pair<Index, Index>>{};
+  auto alive         = faces.size();
+
+  for (auto i = Index{0}; i < points.size(); ++i) {
+    const auto &point = points[i];
+
+    visible_edges.clear();
+
+    for (auto &face : faces) {
+      if (face.is_alive && glm::dot(face.normal, point) - face.offset > epsilon) {
+        const auto &[a, b, c] = face.vertices;
+
+        visible_edges.emplace_back(a, b);
+        visible_edges.emplace_back(b, c);
+        visible_edges.emplace_back(c, a);
+        face.is_alive = false;
+        --alive;
+      }
+    }
+
+    if (visible_edges.empty()) {
+      continue;
+    }
+
+    // Edges shared by two visible faces are inside the hole, the rest of
+    // them ring it.
+    horizon.clear();
+
+    for (const auto &[a, b] : visible_edges) {
+      const auto reverse = std::make_pair(b, a);
+
+      if (std::find(visible_edges.begin(), visible_edges.end(), reverse) ==
+          visible_edges.end()) {
+        horizon.emplace_back(a, b);
+      }
+    }
+
+    for (const auto &[a, b] : horizon) {
+      faces.push_back(make_face(points, a, b, i, interior));
+      ++alive;
+    }
+
+    // Keep the faces tested against each point to the live ones.
+    if (faces.size() > alive * 2) {
+      faces.erase(std::remove_if(faces.begin(), faces.end(),
+                                 [](const HullFace &face) { return !face.is_alive; }),
+                  faces.end());
+    }
+  }
+
+  // Keep only the points on the hull.
+  auto collider = Collider{};
+  auto remap    = vector<Index>(points.size(), std::numeric_limits<Index>::max());
+  collider.type = Collider::Type::Hull;
+
+  for (const auto &face : faces) {
+    if (!face.is_alive) {
+      continue;
+    }
+
+    for (const auto vertex : face.vertices) {
+      if (remap[vertex] == std::numeric_limits<Index>::max()) {
+        remap[vertex] = static_cast<Index>(collider.vertices.size());
+        collider.vertices.push_back(points[vertex]);
+      }
+
+      collider.indices.push_back(remap[vertex]);
+    }
+  }
+
+  return collider;
+}
+
+static auto get_cache_path(uint64_t key) -> path {
+  auto ss = std::ostringstream{};
+  ss << std::hex << key << ".afkcol";
+
+  return Afk::get_absolute_path(".cache/collider") / ss.str();
+}
+
+static auto write_cache(const path &cache_path, const Collider &collider) -> void {
+  auto error = std::error_code{};
+  std::filesystem::create_directories(cache_path.parent_path(), error);
+
+  // Write to a temporary file first so a concurrent reader never sees a partial entry.
+  auto tmp_path = cache_path;
+  tmp_path += ".tmp"s + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  if (!Afk::ColliderCooker::write(tmp_path, collider)) {
+    std::filesystem::remove(tmp_path, error);
+    return;
+  }
+
+  std::filesystem::rename(tmp_path, cache_path, error);
+
+  if (error) {
+    std::filesystem::remove(tmp_path, error);
+  }
+}
+
+auto Afk::ColliderCooker::cook(const Model &model, Collider::Type type) -> Collider {
+  auto collider = gather_triangles(model);
+
+  afk_assert(!collider.indices.empty(),
+             "Model "s + model.file_path.string() + " has no triangles to collide with"s);
+
+  if (type == Collider::Type::Hull) {
+    collider = wrap_hull(collider.vertices);
+  }
+
+  return collider;
+}
+
+auto Afk::ColliderCooker::load(const path &model_path, Collider::Type type) -> Collider {
+  const auto abs_path = Afk::get_absolute_path(model_path);
+
+  afk_assert(std::filesystem::exists(abs_path),
+             "Model "s + model_path.string() + " doesn't exist"s);
+
+  // Mix everything that affects the cooked output into the cache key.
+  auto key = hash(read_file(abs_path));
+  key ^= (static_cast<uint64_t>(type) + 1) * uint64_t{0x9e3779b97f4a7c15};
+  key ^= static_cast<uint64_t>(ColliderCooker::VERSION) << 56;
+
+  const auto cache_path = get_cache_path(key);
+  auto collider         = Collider{};
+
+  if (ColliderCooker::read(cache_path, collider) && collider.type == type) {
+    return collider;
+  }
+
+  collider = ColliderCooker::cook(ModelLoader{}.load(model_path), type);
+  write_cache(cache_path, collider);
+
+  return collider;
+}
+
+auto Afk::ColliderCooker::read(const path &file_path, Collider &collider) -> bool {
+  auto file = ifstream{file_path, std::ios::binary};
+
+  if (!file.is_open()) {
+    return false;
+  }
+
+  auto error           = std::error_code{};
+  const auto file_size = std::filesystem::file_size(file_path, error);
+
+  if (error) {
+    return false;
+  }
+
+  auto header = ContainerHeader{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+  if (!file || header.magic != container_magic || header.version != ColliderCooker::VERSION) {
+    return false;
+  }
+
+  // The counts go straight to rp3d, so anything that doesn't fit the file,
+  // or isn't whole triangles, is rejected and cooked again. Checked by
+  // division first, so huge counts can't overflow.
+  const auto body_size = file_size - std::min<uint64_t>(file_size, sizeof(header));
+  const auto is_valid_type =
+      header.type == Collider::Type::Mesh || header.type == Collider::Type::Hull;
+
+  if (!is_valid_type || header.vertex_count == 0 || header.index_count == 0 ||
+      header.index_count % 3 != 0 || header.vertex_count > body_size / sizeof(vec3) ||
+      header.index_count > body_size / sizeof(Index) ||
+      header.vertex_count * sizeof(vec3) + header.index_count * sizeof(Index) != body_size) {
+    return false;
+  }
+
+  auto cooked = Collider{};
+  cooked.type = header.type;
+  cooked.vertices.resize(static_cast<size_t>(header.vertex_count));
+  cooked.indices.resize(static_cast<size_t>(header.index_count));
+  file.read(reinterpret_cast<char *>(cooked.vertices.data()),
+            static_cast<std::streamsize>(cooked.vertices.size() * sizeof(vec3)));
+  file.read(reinterpret_cast<char *>(cooked.indices.data()),
+            static_cast<std::streamsize>(cooked.indices.size() * sizeof(Index)));
+
+  if (!file) {
+    return false;
+  }
+
+  const auto is_out_of_range = std::any_of(
+      cooked.indices.begin(), cooked.indices.end(),
+      [&cooked](Index index) { return index >= cooked.vertices.size(); });
+
+  if (is_out_of_range) {
+    return false;
+  }
+
+  collider = std::move(cooked);
+
+  return true;
+}
+
+auto Afk::ColliderCooker::write(const path &file_path, const Collider &collider) -> bool {
+  auto file = ofstream{file_path, std::ios::binary};
+
+  if (!file.is_open()) {
+    return false;
+  }
+
+  auto header         = ContainerHeader{};
+  header.type         = collider.type;
+  header.vertex_count = static_cast<uint64_t>(collider.vertices.size());
+  header.index_count  = static_cast<uint64_t>(collider.indices.size());
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(collider.vertices.data()),
+             static_cast<std::streamsize>(collider.vertices.size() * sizeof(vec3)));
+  file.write(reinterpret_cast<const char *>(collider.indices.data()),
+             static_cast<std::streamsize>(collider.indices.size() * sizeof(Index)));
+
+  return static_cast<bool>(file);
+}
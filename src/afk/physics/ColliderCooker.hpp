@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+
+#include "afk/physics/shape/Collider.hpp"
+#include "afk/renderer/Model.hpp"
+
+namespace Afk::ColliderCooker {
+  // Bump whenever the cooked container layout or cooking changes.
+  constexpr auto VERSION = 2u;
+
+  /**
+   * Gathers the triangles of every mesh in the model, or wraps their
+   * vertices in a convex hull. Meshes are placed by their nodes' transforms,
+   * relative to the model's root, as they're drawn.
+   */
+  auto cook(const Model &model, Collider::Type type) -> Collider;
+
+  /**
+   * Returns the model's collider, read from the disk cache if it's been
+   * cooked before, otherwise cooked and cached for next time. The cache is
+   * keyed by a hash of the model file's contents.
+   */
+  auto load(const std::filesystem::path &model_path, Collider::Type type) -> Collider;
+
+  auto read(const std::filesystem::path &file_path, Collider &collider) -> bool;
+  auto write(const std::filesystem::path &file_path, const Collider &collider) -> bool;
+}
@@ -12,6 +12,7 @@
 #include "afk/physics/shape/Box.hpp"
 #include "afk/physics/shape/Sphere.hpp"
 #include "afk/physics/shape/HeightMap.hpp"
+#include "afk/physics/shape/ModelShape.hpp"
 #include "glm/vec3.hpp"
 
 namespace Afk {
@@ -37,13 +38,25 @@ namespace Afk {
                 float angular_dampening, float mass, bool gravity_enabled,
                 Afk::RigidBodyType body_type, Afk::Sphere bounding_sphere);
 
+    // The height map must outlive the body. Heights are relative to the map's
+    // offset, so raise the body by it to line the field up with the map.
     PhysicsBody(GameObject e, Afk::PhysicsBodySystem *physics_system, Afk::Transform transform,
                 float bounciness, float linear_dampening,
                 float angular_dampening, float mass, bool gravity_enabled,
                 Afk::RigidBodyType body_type, const Afk::HeightMap& height_map);
 
+    // The model's collider is cooked the first time, and read from the disk
+    // cache after that.
+    PhysicsBody(GameObject e, Afk::PhysicsBodySystem *physics_system, Afk::Transform transform,
+                float bounciness, float linear_dampening, float angular_dampening, float mass,
+                bool gravity_enabled, Afk::RigidBodyType body_type,
+                const Afk::ModelShape &model_shape);
+
     // todo add rotate method
 
+    // Commands are queued for the physics thread, so they're all called from
+    // the main thread.
+
     // translate the position of the physics body
     void translate(glm::vec3 translate);
 
@@ -54,9 +67,20 @@ namespace Afk {
     void apply_torque(glm::vec3 force);
 
   private:
-    RigidBody *body;
-    ProxyShape *proxy_shape;
-    std::unique_ptr<CollisionShape> collision_shape;
+    PhysicsBodySystem *system;
+    // Boxes, spheres and model shapes are shared between bodies of the same size.
+    std::shared_ptr<CollisionShape> collision_shape;
+    // The offset of the height map the body was last raised by, if it has one.
+    float height_offset = 0.0f;
+
+    // Where every constructor ends up, once it has its shape.
+    PhysicsBody(GameObject e, Afk::PhysicsBodySystem *physics_system, Afk::Transform transform,
+                float bounciness, float linear_dampening, float angular_dampening, float mass,
+                bool gravity_enabled, Afk::RigidBodyType body_type,
+                std::shared_ptr<CollisionShape> shape);
+
+    static auto create_height_field(const Afk::HeightMap &height_map)
+        -> std::shared_ptr<CollisionShape>;
 
     friend class PhysicsBodySystem;
   };
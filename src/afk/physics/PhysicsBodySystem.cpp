@@ -1,49 +1,1117 @@
 #include "afk/physics/PhysicsBodySystem.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <future>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
 
+#include "afk/component/Hierarchy.hpp"
+#include "afk/component/WorldTransform.hpp"
+#include "afk/debug/Assert.hpp"
+#include "afk/physics/ColliderCooker.hpp"
 #include "afk/physics/PhysicsBody.hpp"
+#include "afk/physics/PhysicsQuery.hpp"
 #include "afk/physics/Transform.hpp"
-#include <iostream>
+#include "afk/thread/JobSystem.hpp"
 
+using Afk::Collider;
 using Afk::PhysicsBodySystem;
 
-PhysicsBodySystem::PhysicsBodySystem() {
-  this->world = std::make_unique<rp3d::DynamicsWorld>(rp3d::Vector3{0.0f, -9.81f, 0.0f});
+// Times a sweep's first contact is halved down, once its sphere's stepped into
+// something.
+constexpr auto SWEEP_REFINEMENTS = 8;
+// Ghosts are in a collision category of their own, so they're left out of
+// queries, and don't collide with each other.
+constexpr auto GHOST_CATEGORY   = unsigned short{0x8000};
+constexpr auto QUERY_CATEGORIES = static_cast<unsigned short>(~GHOST_CATEGORY);
+
+// Keeps the closest of the hits a ray reports, which come in no set order.
+class ClosestHit : public rp3d::RaycastCallback {
+public:
+  bool is_hit               = false;
+  rp3d::decimal fraction    = 1.0f;
+  rp3d::Vector3 point       = {};
+  rp3d::Vector3 normal      = {};
+  rp3d::CollisionBody *body = nullptr;
+
+  auto notifyRaycastHit(const rp3d::RaycastInfo &info) -> rp3d::decimal override {
+    if (!this->is_hit || info.hitFraction < this->fraction) {
+      this->is_hit   = true;
+      this->fraction = info.hitFraction;
+      this->point    = info.worldPoint;
+      this->normal   = info.worldNormal;
+      this->body     = info.body;
+    }
+
+    // Clipping the ray at the hit skips anything further along it.
+    return info.hitFraction;
+  }
+};
+
+class OverlapCollector : public rp3d::OverlapCallback {
+public:
+  std::vector<rp3d::CollisionBody *> *bodies = nullptr;
+
+  auto notifyOverlap(rp3d::CollisionBody *body) -> void override {
+    this->bodies->push_back(body);
+  }
+};
+
+// A shape built from a cooked collider, along with everything rp3d reads in
+// place to build it. Members are destroyed bottom up, shape first.
+struct ColliderShape {
+  Afk::Collider collider                                   = {};
+  std::vector<rp3d::PolygonVertexArray::PolygonFace> faces = {};
+  std::unique_ptr<rp3d::PolygonVertexArray> polygons       = nullptr;
+  std::unique_ptr<rp3d::PolyhedronMesh> polyhedron         = nullptr;
+  std::unique_ptr<rp3d::TriangleVertexArray> triangles     = nullptr;
+  std::unique_ptr<rp3d::TriangleMesh> triangle_mesh        = nullptr;
+  std::unique_ptr<rp3d::CollisionShape> shape              = nullptr;
+};
+
+static auto to_rp3d(glm::vec3 v) -> rp3d::Vector3 {
+  return rp3d::Vector3{v.x, v.y, v.z};
+}
+
+static auto to_glm(const rp3d::Vector3 &v) -> glm::vec3 {
+  return glm::vec3{v.x, v.y, v.z};
 }
 
+static auto copy_material(rp3d::RigidBody *from, rp3d::RigidBody *to) -> void {
+  const auto &material = from->getMaterial();
+
+  to->getMaterial().setBounciness(material.getBounciness());
+  to->getMaterial().setFrictionCoefficient(material.getFrictionCoefficient());
+}
+
+PhysicsBodySystem::PhysicsBodySystem() {}
+
 PhysicsBodySystem::PhysicsBodySystem(glm::vec3 gravity) {
-  this->world = std::make_unique<rp3d::DynamicsWorld>(
-      rp3d::Vector3{gravity.x, gravity.y, gravity.z});
+  this->gravity = gravity;
 }
 
 auto PhysicsBodySystem::get_gravity() {
-  return glm::vec3{this->world->getGravity().x, this->world->getGravity().y,
-                   this->world->getGravity().z};
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  return this->gravity;
 }
 
 auto PhysicsBodySystem::set_gravity(glm::vec3 gravity) {
-  // TODO: remove temporary variable
-  auto gravity_rp3d = rp3d::Vector3{gravity.x, gravity.y, gravity.z};
-  this->world->setGravity(gravity_rp3d);
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  this->gravity = gravity;
+
+  for (auto &[key, region] : this->regions) {
+    region.world->setGravity(to_rp3d(gravity));
+  }
+}
+
+PhysicsBodySystem::~PhysicsBodySystem() {
+  // Queries still running need the query spheres and worlds, so they finish first.
+  this->query_workers.reset();
+
+  // The thread has to be joined before the worlds it steps are destroyed.
+  this->set_threaded(false);
 }
 
 auto PhysicsBodySystem::update(entt::registry *registry, float dt) -> void {
-  this->world->update(dt);
+  afk_assert(this->fixed_step > 0.0f, "Fixed step must be positive");
+  afk_assert(this->max_substeps > 0, "Max substeps must be positive");
+
+  auto alpha = 0.0f;
+
+  if (this->is_threaded.load(std::memory_order_acquire)) {
+    {
+      // Never wait on the physics thread, if it's publishing a snapshot the
+      // last one will do for this frame.
+      auto lock = std::unique_lock{this->snapshot_mutex, std::try_to_lock};
+
+      if (lock.owns_lock() && this->is_published) {
+        std::swap(this->front, this->published);
+        this->is_published = false;
+      }
+    }
+
+    const auto since_step = std::chrono::duration<float>{Clock::now() - this->front.time};
+    const auto &snapshot  = this->front;
+
+    const auto read_step_count = this->read_step_count.load(std::memory_order_relaxed);
+
+    this->stats.steps              = snapshot.step_count - read_step_count;
+    this->stats.dropped_time       = snapshot.total_dropped_time - this->stats.total_dropped_time;
+    this->stats.total_dropped_time = snapshot.total_dropped_time;
+    this->stats.step_time          = snapshot.step_time;
+    this->stats.regions            = snapshot.regions;
+    this->stats.ghosts             = snapshot.ghosts;
+    this->read_step_count.store(snapshot.step_count, std::memory_order_release);
+
+    alpha = since_step.count() / this->fixed_step;
+  } else {
+    const auto lock     = std::scoped_lock{this->world_mutex};
+    const auto max_time = this->fixed_step * static_cast<float>(this->max_substeps);
+
+    this->accumulator += dt;
+    this->stats.dropped_time = 0.0f;
+
+    // Drop whatever can't be caught up on this frame, rather than taking more
+    // steps and making the next frame later still.
+    if (this->accumulator > max_time) {
+      this->stats.dropped_time = this->accumulator - max_time;
+      this->accumulator        = max_time;
+      this->stats.total_dropped_time += this->stats.dropped_time;
+    }
+
+    const auto steps = static_cast<std::size_t>(this->accumulator / this->fixed_step);
+    const auto start = Clock::now();
+
+    this->apply_commands();
+
+    for (auto step = std::size_t{0}; step < steps; ++step) {
+      this->step(this->fixed_step, step == steps - 1);
+      this->accumulator -= this->fixed_step;
+    }
+
+    if (steps > 0) {
+      this->take_snapshot(this->front);
+      this->read_step_count.store(this->front.step_count, std::memory_order_release);
+    }
+
+    const auto step_time = std::chrono::duration<double, std::milli>{Clock::now() - start};
+
+    this->stats.steps     = steps;
+    this->stats.step_time = step_time.count();
+    this->stats.regions   = this->regions.size();
+    this->stats.ghosts    = this->ghost_count;
+
+    alpha = this->accumulator / this->fixed_step;
+  }
+
+  const auto sync_start = Clock::now();
+
+  this->stats.alpha = std::clamp(alpha, 0.0f, 1.0f);
+  this->sync_transforms(registry, this->stats.alpha);
+  this->stats.sync_time =
+      std::chrono::duration<double, std::milli>{Clock::now() - sync_start}.count();
+}
+
+auto PhysicsBodySystem::get_stats() const -> Stats {
+  return this->stats;
+}
+
+auto PhysicsBodySystem::get_moved() const -> const Entities & {
+  return this->moved;
+}
+
+auto PhysicsBodySystem::set_threaded(bool threaded) -> void {
+  if (threaded == this->is_threaded.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  this->is_threaded.store(threaded, std::memory_order_release);
+
+  if (threaded) {
+    this->thread = std::thread{&PhysicsBodySystem::run, this};
+  } else {
+    this->thread.join();
+    // Carry on stepping inline from the thread's last step.
+    this->accumulator = 0.0f;
+    this->take_snapshot(this->front);
+  }
+}
+
+auto PhysicsBodySystem::get_threaded() const -> bool {
+  return this->is_threaded.load(std::memory_order_acquire);
+}
+
+auto PhysicsBodySystem::lock() -> std::unique_lock<std::recursive_mutex> {
+  return std::unique_lock{this->world_mutex};
+}
+
+auto PhysicsBodySystem::set_region_size(float size) -> void {
+  afk_assert(size >= 0.0f, "Region size can't be negative");
+
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  this->region_size        = size;
+  this->is_regions_changed = true;
+  this->rebalance();
+}
+
+auto PhysicsBodySystem::get_region_size() const -> float {
+  return this->region_size;
+}
+
+auto PhysicsBodySystem::run() -> void {
+  // Read once, so they can't change under the thread.
+  const auto dt = this->fixed_step;
+  const auto step_length =
+      std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>{dt});
+  const auto max_lag      = step_length * static_cast<Clock::rep>(this->max_substeps);
+  auto next_step          = Clock::now();
+  auto total_dropped_time = this->stats.total_dropped_time;
+
+  while (this->is_threaded.load(std::memory_order_acquire)) {
+    const auto now = Clock::now();
+
+    if (now < next_step) {
+      std::this_thread::sleep_until(next_step);
+      continue;
+    }
+
+    // Drop whatever can't be caught up on, rather than falling further behind.
+    if (now - next_step > max_lag) {
+      total_dropped_time += std::chrono::duration<float>{now - next_step - max_lag}.count();
+      next_step = now - max_lag;
+    }
+
+    const auto start = Clock::now();
+
+    {
+      const auto lock = std::scoped_lock{this->world_mutex};
+
+      this->apply_commands();
+      this->step(dt, true);
+      this->take_snapshot(this->back);
+    }
+
+    next_step += step_length;
+
+    const auto step_time = std::chrono::duration<double, std::milli>{Clock::now() - start};
+
+    this->back.step_time          = step_time.count();
+    this->back.total_dropped_time = total_dropped_time;
+
+    {
+      const auto lock = std::scoped_lock{this->snapshot_mutex};
+
+      std::swap(this->back, this->published);
+      this->is_published = true;
+    }
+  }
+}
+
+auto PhysicsBodySystem::step(float dt, bool is_last) -> void {
+  // Transforms are drawn between the last two steps, so only the poses
+  // before the last one are kept. Bodies at rest are where they were.
+  if (is_last) {
+    for (auto &[entity, info] : this->bodies) {
+      if (!PhysicsBodySystem::is_resting(info.body)) {
+        info.previous_pose = info.body->getTransform();
+      }
+    }
+  }
+
+  this->step_regions(dt);
+  this->rebalance();
+  ++this->step_count;
+}
+
+auto PhysicsBodySystem::step_regions(float dt) -> void {
+  this->stepping.clear();
+
+  for (auto &[key, region] : this->regions) {
+    this->stepping.push_back(region.world.get());
+  }
+
+  // Regions share nothing but the shapes their bodies collide with, which
+  // rp3d only reads, so each is a job of its own.
+  JobSystem::get().parallel_for(
+      this->stepping.size(),
+      [this, dt](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+          this->stepping[i]->update(dt);
+        }
+      },
+      1);
+}
+
+auto PhysicsBodySystem::rebalance() -> void {
+  // Nothing's ever out of place in one world.
+  if (this->region_size <= 0.0f && !this->is_regions_changed) {
+    return;
+  }
+
+  // A body moving into a new region opens it, and every body near it then
+  // has to be placed again to be ghosted into it.
+  while (true) {
+    const auto is_changed    = this->is_regions_changed;
+    this->is_regions_changed = false;
+
+    for (auto &[entity, info] : this->bodies) {
+      if (is_changed || !info.is_placed || !PhysicsBodySystem::is_resting(info.body)) {
+        this->place(info);
+      } else if (!info.is_settled) {
+        this->settle(info);
+      }
+    }
+
+    if (!this->is_regions_changed) {
+      break;
+    }
+  }
+
+  this->close_empty_regions();
+}
+
+auto PhysicsBodySystem::place(Body &info) -> void {
+  const auto home = this->get_region_key(info.body->getTransform().getPosition());
+
+  if (home != info.region) {
+    this->migrate(info, home);
+  }
+
+  const auto bounds = info.body->getAABB();
+
+  // Ghosts follow their bodies, and leave regions their bodies aren't near.
+  for (auto ghost = info.ghosts.begin(); ghost != info.ghosts.end();) {
+    if (this->is_near(ghost->first, bounds)) {
+      ghost->second->setTransform(info.body->getTransform());
+
+      if (ghost->second->getType() == rp3d::BodyType::KINEMATIC) {
+        ghost->second->setLinearVelocity(info.body->getLinearVelocity());
+        ghost->second->setAngularVelocity(info.body->getAngularVelocity());
+      }
+
+      ++ghost;
+    } else {
+      this->regions.at(ghost->first).world->destroyRigidBody(ghost->second);
+      --this->ghost_count;
+      ghost = info.ghosts.erase(ghost);
+    }
+  }
+
+  const auto ghost_into = [this, &info, &bounds](RegionKey key, Region &region) {
+    if (key != info.region && info.ghosts.count(key) == 0 && this->is_near(key, bounds)) {
+      info.ghosts.emplace(key, this->create_ghost(region, info));
+    }
+  };
+
+  // Only regions the bounds reach into can need a ghost, so they're looked
+  // up by key, unless there are fewer regions open than keys to look up.
+  const auto margin = rp3d::Vector3{this->ghost_margin, 0.0f, this->ghost_margin};
+  const auto first  = this->get_region_key(bounds.getMin() - margin);
+  const auto last   = this->get_region_key(bounds.getMax() + margin);
+  const auto keys   = static_cast<std::size_t>(last.first - first.first + 1) *
+                    static_cast<std::size_t>(last.second - first.second + 1);
+
+  if (keys > this->regions.size()) {
+    for (auto &[key, region] : this->regions) {
+      ghost_into(key, region);
+    }
+  } else {
+    for (auto x = first.first; x <= last.first; ++x) {
+      for (auto z = first.second; z <= last.second; ++z) {
+        const auto region = this->regions.find(RegionKey{x, z});
+
+        if (region != this->regions.end()) {
+          ghost_into(region->first, region->second);
+        }
+      }
+    }
+  }
+
+  info.is_placed  = true;
+  info.is_settled = false;
+}
+
+auto PhysicsBodySystem::settle(Body &info) -> void {
+  // Kinematic ghosts keep the velocities they were last placed with, so once
+  // their body comes to rest they're stopped where it is, not left drifting.
+  for (auto &[key, ghost] : info.ghosts) {
+    if (ghost->getType() == rp3d::BodyType::KINEMATIC) {
+      ghost->setTransform(info.body->getTransform());
+      ghost->setLinearVelocity(rp3d::Vector3::zero());
+      ghost->setAngularVelocity(rp3d::Vector3::zero());
+    }
+  }
+
+  info.is_settled = true;
+}
+
+auto PhysicsBodySystem::migrate(Body &info, RegionKey key) -> void {
+  auto &to = this->get_region(key);
+
+  // The body takes the place of its ghost there.
+  const auto ghost = info.ghosts.find(key);
+
+  if (ghost != info.ghosts.end()) {
+    to.world->destroyRigidBody(ghost->second);
+    --this->ghost_count;
+    info.ghosts.erase(ghost);
+  }
+
+  auto *from = info.body;
+  auto *body = to.world->createRigidBody(from->getTransform());
+
+  body->setType(from->getType());
+  body->enableGravity(from->isGravityEnabled());
+  body->setLinearDamping(from->getLinearDamping());
+  body->setAngularDamping(from->getAngularDamping());
+  copy_material(from, body);
+
+  info.proxy = body->addCollisionShape(info.shape, rp3d::Transform::identity(),
+                                       info.proxy->getMass());
+  body->setLinearVelocity(from->getLinearVelocity());
+  body->setAngularVelocity(from->getAngularVelocity());
+  body->setUserData(&info);
+
+  auto &region = this->regions.at(info.region);
+  region.world->destroyRigidBody(from);
+  --region.body_count;
+  ++to.body_count;
+
+  info.body   = body;
+  info.region = key;
+}
+
+auto PhysicsBodySystem::create_ghost(Region &region, const Body &info) -> rp3d::RigidBody * {
+  auto *ghost = region.world->createRigidBody(info.body->getTransform());
+
+  // Static bodies stay put, so only moving ones need to be kinematic.
+  if (info.body->getType() == rp3d::BodyType::STATIC) {
+    ghost->setType(rp3d::BodyType::STATIC);
+  } else {
+    ghost->setType(rp3d::BodyType::KINEMATIC);
+    ghost->setLinearVelocity(info.body->getLinearVelocity());
+    ghost->setAngularVelocity(info.body->getAngularVelocity());
+  }
+
+  ghost->enableGravity(false);
+  copy_material(info.body, ghost);
+
+  auto *proxy =
+      ghost->addCollisionShape(info.shape, rp3d::Transform::identity(), info.proxy->getMass());
+  proxy->setCollisionCategoryBits(GHOST_CATEGORY);
+  proxy->setCollideWithMaskBits(QUERY_CATEGORIES);
+
+  ++this->ghost_count;
+
+  return ghost;
+}
+
+auto PhysicsBodySystem::close_empty_regions() -> void {
+  for (auto region = this->regions.begin(); region != this->regions.end();) {
+    if (region->second.body_count > 0 || this->regions.size() == 1) {
+      ++region;
+      continue;
+    }
+
+    // The region's world takes the ghosts in it along with it.
+    for (auto &[entity, info] : this->bodies) {
+      this->ghost_count -= info.ghosts.erase(region->first);
+    }
+
+    region = this->regions.erase(region);
+  }
+}
+
+auto PhysicsBodySystem::get_region(RegionKey key) -> Region & {
+  const auto found = this->regions.find(key);
+
+  if (found != this->regions.end()) {
+    return found->second;
+  }
+
+  auto &region             = this->regions[key];
+  region.world             = std::make_unique<rp3d::DynamicsWorld>(to_rp3d(this->gravity));
+  this->is_regions_changed = true;
+
+  return region;
+}
+
+auto PhysicsBodySystem::get_region_key(const rp3d::Vector3 &position) const -> RegionKey {
+  if (this->region_size <= 0.0f) {
+    return RegionKey{0, 0};
+  }
+
+  return RegionKey{static_cast<int>(std::floor(position.x / this->region_size)),
+                   static_cast<int>(std::floor(position.z / this->region_size))};
+}
+
+auto PhysicsBodySystem::is_near(RegionKey key, const rp3d::AABB &bounds) const -> bool {
+  if (this->region_size <= 0.0f) {
+    return false;
+  }
+
+  const auto min_x = static_cast<float>(key.first) * this->region_size - this->ghost_margin;
+  const auto min_z = static_cast<float>(key.second) * this->region_size - this->ghost_margin;
+  const auto max_x = min_x + this->region_size + this->ghost_margin * 2.0f;
+  const auto max_z = min_z + this->region_size + this->ghost_margin * 2.0f;
+  const auto &min  = bounds.getMin();
+  const auto &max  = bounds.getMax();
+
+  return min.x <= max_x && max.x >= min_x && min.z <= max_z && max.z >= min_z;
+}
+
+auto PhysicsBodySystem::take_snapshot(Snapshot &snapshot) -> void {
+  // Bodies that moved since the main thread last read a snapshot, including
+  // those that came to rest then, still have to be synced to where they are.
+  const auto read_step_count = this->read_step_count.load(std::memory_order_acquire);
+
+  snapshot.poses.clear();
+
+  for (auto &[entity, info] : this->bodies) {
+    const auto is_unread = info.moved_step_count >= read_step_count;
+
+    // Sleeping and static bodies can't have moved, unless by hand.
+    if (!info.is_moved && !is_unread && PhysicsBodySystem::is_resting(info.body)) {
+      continue;
+    }
+
+    const auto &pose = info.body->getTransform();
+
+    if (info.is_moved || !(pose == info.last_pose)) {
+      info.last_pose        = pose;
+      info.moved_step_count = this->step_count;
+      info.is_moved         = false;
+    } else if (!is_unread) {
+      continue;
+    }
 
-  // Mirror changes in physics engine to Transform component
+    snapshot.poses.push_back(Pose{info.entity, info.previous_pose, pose});
+  }
+
+  snapshot.time       = Clock::now();
+  snapshot.step_count = this->step_count;
+  snapshot.regions    = this->regions.size();
+  snapshot.ghosts     = this->ghost_count;
+}
+
+auto PhysicsBodySystem::is_resting(const rp3d::RigidBody *body) -> bool {
+  return body->isSleeping() || body->getType() == rp3d::BodyType::STATIC;
+}
+
+auto PhysicsBodySystem::apply_commands() -> void {
+  auto command = Command{};
+
+  while (this->commands.pop(command)) {
+    this->apply(command);
+  }
+}
+
+auto PhysicsBodySystem::apply(const Command &command) -> void {
+  const auto found = this->bodies.find(command.entity);
+
+  // Commands can outlive the bodies they're for.
+  if (found == this->bodies.end()) {
+    return;
+  }
+
+  auto &info       = found->second;
+  const auto value = to_rp3d(command.value);
+
+  switch (command.type) {
+    case Command::Type::Force:
+      info.body->applyForceToCenterOfMass(value);
+      break;
+    case Command::Type::Torque:
+      info.body->applyTorque(value);
+      break;
+    case Command::Type::Translate: {
+      const auto &transform = info.body->getTransform();
+      const auto moved =
+          rp3d::Transform{transform.getPosition() + value, transform.getOrientation()};
+
+      info.body->setTransform(moved);
+
+      // Moved by hand, so it jumps rather than being interpolated there.
+      info.previous_pose = moved;
+      info.is_moved      = true;
+      info.is_placed     = false;
+      break;
+    }
+  }
+}
+
+auto PhysicsBodySystem::push(const Command &command) -> void {
+  if (this->commands.push(command)) {
+    return;
+  }
+
+  // The queue's full, so empty it in order before applying this one.
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  this->apply_commands();
+  this->apply(command);
+}
+
+auto PhysicsBodySystem::add_body(GameObject entity, const rp3d::Transform &transform,
+                                 rp3d::CollisionShape *shape, float mass) -> rp3d::RigidBody * {
+  const auto lock = std::scoped_lock{this->world_mutex};
+  const auto key  = this->get_region_key(transform.getPosition());
+  auto &region    = this->get_region(key);
+  auto &info      = this->bodies[entity];
+
+  afk_assert(info.body == nullptr, "Entity already has a physics body");
+
+  info.entity        = entity;
+  info.body          = region.world->createRigidBody(transform);
+  info.proxy         = info.body->addCollisionShape(shape, rp3d::Transform::identity(), mass);
+  info.shape         = shape;
+  info.region        = key;
+  info.previous_pose = transform;
+  // Synced once, so its transform starts out where the body is.
+  info.is_moved = true;
+  info.body->setUserData(&info);
+  ++region.body_count;
+
+  return info.body;
+}
+
+auto PhysicsBodySystem::sync_transforms(entt::registry *registry, float alpha) -> void {
+  this->moved.clear();
+
+  // Mirror changes in physics engine to Transform component, for the bodies
+  // in the snapshot, i.e. the ones that moved.
   // TODO: Scale shapes of rigid bodies on the fly
   // @see https://github.com/DanielChappuis/reactphysics3d/issues/103
-  registry->view<Afk::Transform, Afk::PhysicsBody>().each(
-      [](Afk::Transform &transform, Afk::PhysicsBody &collision) {
-        const auto rp3d_position = collision.body->getTransform().getPosition();
-        const auto rp3d_orientation = collision.body->getTransform().getOrientation();
-
-        transform.translation =
-            glm::vec3{rp3d_position.x, rp3d_position.y, rp3d_position.z};
-        transform.rotation = glm::quat{rp3d_orientation.w, rp3d_orientation.x,
-                                       rp3d_orientation.y, rp3d_orientation.z};
-
-//        std::cout << transform.translation.x << ", " << transform.translation.y << ", " << transform.translation.z << std::endl;
-      });
+  for (const auto &pose : this->front.poses) {
+    // Snapshots can outlive the entities in them.
+    auto *transform =
+        registry->valid(pose.entity) ? registry->try_get<Afk::Transform>(pose.entity) : nullptr;
+
+    if (transform == nullptr) {
+      continue;
+    }
+
+    const auto interpolated = rp3d::Transform::interpolateTransforms(
+        pose.previous_pose, pose.current_pose, static_cast<rp3d::decimal>(alpha));
+    const auto rp3d_position    = interpolated.getPosition();
+    const auto rp3d_orientation = interpolated.getOrientation();
+
+    auto position = glm::vec3{rp3d_position.x, rp3d_position.y, rp3d_position.z};
+    auto rotation = glm::quat{rp3d_orientation.w, rp3d_orientation.x, rp3d_orientation.y,
+                              rp3d_orientation.z};
+
+    // Bodies live in world space, but attached entities' transforms are
+    // relative to their parent's cached world transform.
+    const auto *hierarchy = registry->try_get<Afk::Hierarchy>(pose.entity);
+    const auto *parent    = hierarchy != nullptr && registry->valid(hierarchy->parent)
+                                ? registry->try_get<Afk::WorldTransform>(hierarchy->parent)
+                                : nullptr;
+
+    if (parent != nullptr) {
+      const auto to_parent = glm::inverse(parent->matrix);
+      position             = glm::vec3{to_parent * glm::vec4{position, 1.0f}};
+
+      // The parent's columns are its axes scaled, so they're normalized
+      // to leave just its rotation, which is then undone.
+      const auto basis           = glm::mat3{parent->matrix};
+      const auto parent_rotation = glm::quat_cast(glm::mat3{
+          glm::normalize(basis[0]), glm::normalize(basis[1]), glm::normalize(basis[2])});
+      rotation = glm::normalize(glm::inverse(parent_rotation) * rotation);
+    }
+
+    transform->translation = position;
+    transform->rotation    = rotation;
+
+    if (auto *world_transform = registry->try_get<Afk::WorldTransform>(pose.entity)) {
+      world_transform->is_dirty = true;
+    }
+
+    this->moved.push_back(pose.entity);
+  }
+
+  this->stats.synced = this->moved.size();
+}
+
+auto PhysicsBodySystem::spawn(entt::registry *registry, const Spawns &spawns) -> void {
+  // Cooking a model's collider can take a while, so any the spawns need are
+  // built before the world's locked, and held until their bodies share them.
+  auto model_shapes = std::vector<std::shared_ptr<rp3d::CollisionShape>>{};
+
+  for (const auto &spawn : spawns) {
+    if (const auto *model_shape = std::get_if<ModelShape>(&spawn.shape)) {
+      model_shapes.push_back(
+          this->get_model_shape(*model_shape, spawn.transform.scale, spawn.body_type));
+    }
+  }
+
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  this->bodies.reserve(this->bodies.size() + spawns.size());
+  registry->reserve<Afk::PhysicsBody>(registry->size<Afk::PhysicsBody>() + spawns.size());
+
+  for (const auto &spawn : spawns) {
+    std::visit(
+        [this, registry, &spawn](const auto &shape) {
+          registry->assign<Afk::PhysicsBody>(
+              spawn.entity, spawn.entity, this, spawn.transform, spawn.bounciness,
+              spawn.linear_dampening, spawn.angular_dampening, spawn.mass, spawn.gravity_enabled,
+              spawn.body_type, shape);
+        },
+        spawn.shape);
+  }
+}
+
+auto PhysicsBodySystem::get_shape_count() -> std::size_t {
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  return static_cast<std::size_t>(
+      std::count_if(this->shapes.begin(), this->shapes.end(),
+                    [](const auto &entry) { return !entry.second.expired(); }));
+}
+
+auto PhysicsBodySystem::prune_shapes() -> void {
+  if (this->shapes.size() + this->model_shapes.size() < this->shape_capacity) {
+    return;
+  }
+
+  const auto prune = [](auto &cache) {
+    for (auto shape = cache.begin(); shape != cache.end();) {
+      shape = shape->second.expired() ? cache.erase(shape) : std::next(shape);
+    }
+  };
+
+  prune(this->shapes);
+  prune(this->model_shapes);
+
+  // Sweeping again only once the caches have doubled keeps lookups amortized O(log n).
+  this->shape_capacity =
+      std::max(std::size_t{64}, (this->shapes.size() + this->model_shapes.size()) * 2);
+}
+
+auto PhysicsBodySystem::get_box_shape(glm::vec3 half_extents)
+    -> std::shared_ptr<rp3d::CollisionShape> {
+  const auto lock = std::scoped_lock{this->world_mutex};
+  this->prune_shapes();
+
+  auto &shape = this->shapes[{0, half_extents.x, half_extents.y, half_extents.z}];
+  auto shared = shape.lock();
+
+  if (shared == nullptr) {
+    shared = std::make_shared<rp3d::BoxShape>(
+        rp3d::Vector3{half_extents.x, half_extents.y, half_extents.z});
+    shape = shared;
+  }
+
+  return shared;
+}
+
+auto PhysicsBodySystem::get_sphere_shape(float radius) -> std::shared_ptr<rp3d::CollisionShape> {
+  const auto lock = std::scoped_lock{this->world_mutex};
+  this->prune_shapes();
+
+  auto &shape = this->shapes[{1, radius, 0.0f, 0.0f}];
+  auto shared = shape.lock();
+
+  if (shared == nullptr) {
+    shared = std::make_shared<rp3d::SphereShape>(radius);
+    shape  = shared;
+  }
+
+  return shared;
+}
+
+auto PhysicsBodySystem::get_model_shape(const ModelShape &model_shape, glm::vec3 scale,
+                                        RigidBodyType body_type)
+    -> std::shared_ptr<rp3d::CollisionShape> {
+  // rp3d only collides triangle meshes with convex shapes, so moving bodies
+  // need a hull.
+  afk_assert(model_shape.type == Collider::Type::Hull || body_type == RigidBodyType::STATIC,
+             "Mesh shapes are only for static bodies, use a hull instead");
+
+  const auto key = ModelKey{model_shape.model_path.lexically_normal().string(),
+                            static_cast<int>(model_shape.type), scale.x, scale.y, scale.z};
+
+  {
+    const auto lock = std::scoped_lock{this->world_mutex};
+    this->prune_shapes();
+
+    const auto shared = this->model_shapes[key].lock();
+
+    if (shared != nullptr) {
+      return shared;
+    }
+  }
+
+  // Cooking a model for the first time can take a while, so it's done
+  // without holding up the physics thread.
+  auto built      = std::make_shared<ColliderShape>();
+  built->collider = ColliderCooker::load(model_shape.model_path, model_shape.type);
+
+  const auto &collider = built->collider;
+  const auto size      = rp3d::Vector3{scale.x, scale.y, scale.z};
+
+  // rp3d only reads the arrays, it just doesn't say so.
+  auto *vertices            = const_cast<glm::vec3 *>(collider.vertices.data());
+  auto *indices             = const_cast<Collider::Index *>(collider.indices.data());
+  const auto vertex_count   = static_cast<rp3d::uint>(collider.vertices.size());
+  const auto triangle_count = static_cast<rp3d::uint>(collider.indices.size() / 3);
+
+  switch (collider.type) {
+    case Collider::Type::Hull:
+      for (auto i = rp3d::uint{0}; i < triangle_count; ++i) {
+        built->faces.push_back({3, i * 3});
+      }
+
+      built->polygons = std::make_unique<rp3d::PolygonVertexArray>(
+          vertex_count, vertices, static_cast<int>(sizeof(glm::vec3)), indices,
+          static_cast<int>(sizeof(Collider::Index)), triangle_count, built->faces.data(),
+          rp3d::PolygonVertexArray::VertexDataType::VERTEX_FLOAT_TYPE,
+          rp3d::PolygonVertexArray::IndexDataType::INDEX_INTEGER_TYPE);
+      built->polyhedron = std::make_unique<rp3d::PolyhedronMesh>(built->polygons.get());
+      built->shape      = std::make_unique<rp3d::ConvexMeshShape>(built->polyhedron.get(), size);
+      break;
+    case Collider::Type::Mesh:
+      built->triangles = std::make_unique<rp3d::TriangleVertexArray>(
+          vertex_count, vertices, static_cast<rp3d::uint>(sizeof(glm::vec3)), triangle_count,
+          indices, static_cast<rp3d::uint>(sizeof(Collider::Index) * 3),
+          rp3d::TriangleVertexArray::VertexDataType::VERTEX_FLOAT_TYPE,
+          rp3d::TriangleVertexArray::IndexDataType::INDEX_INTEGER_TYPE);
+      built->triangle_mesh = std::make_unique<rp3d::TriangleMesh>();
+      built->triangle_mesh->addSubpart(built->triangles.get());
+      built->shape = std::make_unique<rp3d::ConcaveMeshShape>(built->triangle_mesh.get(), size);
+      break;
+  }
+
+  const auto lock = std::scoped_lock{this->world_mutex};
+  auto &shape     = this->model_shapes[key];
+  auto shared     = shape.lock();
+
+  // Another body may have built the same shape in the meantime.
+  if (shared == nullptr) {
+    shared = std::shared_ptr<rp3d::CollisionShape>{built, built->shape.get()};
+    shape  = shared;
+  }
+
+  return shared;
+}
+
+auto PhysicsBodySystem::query(PhysicsQuery &batch) -> void {
+  const auto lock = std::scoped_lock{this->world_mutex};
+
+  batch.ray_hits.resize(batch.rays.size());
+  batch.sweep_hits.resize(batch.sweeps.size());
+  batch.overlap_spans.clear();
+  batch.overlapped.clear();
+
+  for (auto i = std::size_t{0}; i < batch.rays.size(); ++i) {
+    this->raycast(batch.rays[i], batch.ray_hits[i]);
+  }
+
+  for (auto i = std::size_t{0}; i < batch.sweeps.size(); ++i) {
+    this->sweep(batch.sweeps[i], batch.sweep_hits[i]);
+  }
+
+  for (const auto &overlap : batch.overlaps) {
+    this->overlap(overlap, batch);
+  }
+}
+
+auto PhysicsBodySystem::query_async(PhysicsQuery &batch) -> std::future<void> {
+  return this->query_workers->enqueue([this, &batch]() { this->query(batch); });
+}
+
+auto PhysicsBodySystem::raycast(const PhysicsQuery::Ray &ray, PhysicsQuery::Hit &hit) -> void {
+  afk_assert(glm::length(ray.direction) > 0.0f, "Ray direction must be non-zero");
+
+  const auto direction = glm::normalize(ray.direction);
+  const auto end       = ray.origin + direction * ray.max_distance;
+  auto closest         = ClosestHit{};
+
+  // The closest hit of all is kept, whichever region it's in.
+  for (auto &[key, region] : this->regions) {
+    region.world->raycast(rp3d::Ray{to_rp3d(ray.origin), to_rp3d(end)}, &closest,
+                          QUERY_CATEGORIES);
+  }
+
+  hit = PhysicsQuery::Hit{};
+
+  if (closest.is_hit) {
+    hit.is_hit   = true;
+    hit.entity   = this->get_entity(closest.body);
+    hit.distance = closest.fraction * ray.max_distance;
+    hit.position = to_glm(closest.point);
+    hit.normal   = to_glm(closest.normal);
+  }
+}
+
+auto PhysicsBodySystem::sweep(const PhysicsQuery::Sweep &sweep, PhysicsQuery::Hit &hit) -> void {
+  afk_assert(sweep.radius > 0.0f, "Sweep radius must be positive");
+  afk_assert(glm::length(sweep.direction) > 0.0f, "Sweep direction must be non-zero");
+
+  const auto direction = glm::normalize(sweep.direction);
+  const auto steps     = static_cast<int>(std::ceil(sweep.max_distance / sweep.radius));
+  auto clear_distance  = 0.0f;
+
+  hit = PhysicsQuery::Hit{};
+
+  // Step a radius at a time until the sphere's in something, then narrow
+  // the contact down to between there and the last step that was clear.
+  for (auto step = 0; step <= steps; ++step) {
+    auto distance = std::min(static_cast<float>(step) * sweep.radius, sweep.max_distance);
+
+    if (this->test_overlap(sweep.origin + direction * distance, sweep.radius).empty()) {
+      clear_distance = distance;
+      continue;
+    }
+
+    if (step > 0) {
+      for (auto refinement = 0; refinement < SWEEP_REFINEMENTS; ++refinement) {
+        const auto middle = (clear_distance + distance) * 0.5f;
+
+        if (this->test_overlap(sweep.origin + direction * middle, sweep.radius).empty()) {
+          clear_distance = middle;
+        } else {
+          distance = middle;
+        }
+      }
+    }
+
+    const auto center = sweep.origin + direction * distance;
+    auto *body        = this->test_overlap(center, sweep.radius).front();
+
+    hit.is_hit   = true;
+    hit.entity   = this->get_entity(body);
+    hit.distance = distance;
+    hit.position = center;
+    hit.normal   = -direction;
+
+    // The body's surface straight ahead gives a better normal, when the
+    // sphere didn't catch it off centre.
+    auto info = rp3d::RaycastInfo{};
+    const auto ahead =
+        rp3d::Ray{to_rp3d(center), to_rp3d(center + direction * (sweep.radius * 2.0f))};
+
+    if (body->raycast(ahead, info)) {
+      hit.normal = to_glm(info.worldNormal);
+    }
+
+    return;
+  }
+}
+
+auto PhysicsBodySystem::overlap(const PhysicsQuery::Overlap &overlap, PhysicsQuery &batch)
+    -> void {
+  afk_assert(overlap.radius > 0.0f, "Overlap radius must be positive");
+
+  const auto &bodies = this->test_overlap(overlap.center, overlap.radius);
+
+  batch.overlap_spans.push_back({batch.overlapped.size(), bodies.size()});
+
+  for (const auto *body : bodies) {
+    batch.overlapped.push_back(this->get_entity(body));
+  }
+}
+
+auto PhysicsBodySystem::test_overlap(glm::vec3 center, float radius) -> const Overlapping & {
+  const auto transform = rp3d::Transform{to_rp3d(center), rp3d::Quaternion::identity()};
+  auto collector       = OverlapCollector{};
+  collector.bodies     = &this->overlapping;
+
+  this->overlapping.clear();
+
+  // Every region has a sphere of its own. Ghosts are left out, so bodies
+  // near a region's edge are found once, in their home region.
+  for (auto &[key, region] : this->regions) {
+    // The sphere is static, and in no collision category, so nothing
+    // collides with it and it's left out of raycasts.
+    if (region.query_body == nullptr) {
+      region.query_body = region.world->createRigidBody(transform);
+      region.query_body->setType(rp3d::BodyType::STATIC);
+    } else {
+      region.query_body->setTransform(transform);
+    }
+
+    if (region.query_proxy == nullptr ||
+        static_cast<const rp3d::SphereShape *>(region.query_shape.get())->getRadius() != radius) {
+      if (region.query_proxy != nullptr) {
+        region.query_body->removeCollisionShape(region.query_proxy);
+      }
+
+      region.query_shape = this->get_sphere_shape(radius);
+      region.query_proxy = region.query_body->addCollisionShape(
+          region.query_shape.get(), rp3d::Transform::identity(), 1.0f);
+      region.query_proxy->setCollisionCategoryBits(0);
+      region.query_proxy->setCollideWithMaskBits(0);
+    }
+
+    region.world->testOverlap(region.query_body, &collector, QUERY_CATEGORIES);
+  }
+
+  return this->overlapping;
+}
+
+auto PhysicsBodySystem::get_entity(const rp3d::CollisionBody *body) const -> GameObject {
+  const auto *info = static_cast<const Body *>(body->getUserData());
+
+  if (info == nullptr) {
+    return entt::null;
+  }
+
+  return info->entity;
+}
+
+auto PhysicsBodySystem::destroy(Afk::PhysicsBody &physics_body) -> void {
+  const auto lock  = std::scoped_lock{this->world_mutex};
+  const auto found = this->bodies.find(physics_body.owning_entity);
+
+  if (found == this->bodies.end()) {
+    return;
+  }
+
+  // Commands queued for the body can't be left to reach it after it's gone.
+  this->apply_commands();
+
+  auto &info = found->second;
+
+  for (const auto &[key, ghost] : info.ghosts) {
+    this->regions.at(key).world->destroyRigidBody(ghost);
+    --this->ghost_count;
+  }
+
+  // Destroying the body destroys its proxy shape along with it.
+  auto &region = this->regions.at(info.region);
+  region.world->destroyRigidBody(info.body);
+  --region.body_count;
+
+  this->bodies.erase(found);
+}
+
+auto PhysicsBodySystem::set_height_map(Afk::PhysicsBody &physics_body,
+                                       const Afk::HeightMap &height_map) -> void {
+  const auto lock  = std::scoped_lock{this->world_mutex};
+  const auto found = this->bodies.find(physics_body.owning_entity);
+
+  afk_assert(found != this->bodies.end(), "Physics body already destroyed");
+
+  auto &info      = found->second;
+  const auto mass = info.proxy->getMass();
+
+  // Ghosts share the old shape, so they go too, and are made again with the
+  // new one when the body's next placed.
+  for (const auto &[key, ghost] : info.ghosts) {
+    this->regions.at(key).world->destroyRigidBody(ghost);
+    --this->ghost_count;
+  }
+
+  info.ghosts.clear();
+
+  // The old shape has to outlive its proxy.
+  info.body->removeCollisionShape(info.proxy);
+  physics_body.collision_shape = PhysicsBody::create_height_field(height_map);
+  info.shape                   = physics_body.collision_shape.get();
+  info.proxy = info.body->addCollisionShape(info.shape, rp3d::Transform::identity(), mass);
+
+  // Heights are relative to the map's offset, so the body moves with it.
+  auto transform = info.body->getTransform();
+  auto position  = transform.getPosition();
+  position.y += height_map.offset - physics_body.height_offset;
+  transform.setPosition(position);
+  info.body->setTransform(transform);
+  physics_body.height_offset = height_map.offset;
+
+  // Moved by hand, so it jumps rather than being interpolated there.
+  info.previous_pose = transform;
+  info.is_moved      = true;
+  info.is_placed     = false;
 }
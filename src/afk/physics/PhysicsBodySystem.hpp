@@ -1,11 +1,35 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
 #include <reactphysics3d.h>
 
 #include <entt/entt.hpp>
 
+#include "afk/component/GameObject.hpp"
 #include "afk/physics/PhysicsBody.hpp"
+#include "afk/physics/PhysicsQuery.hpp"
+#include "afk/physics/RigidBodyType.hpp"
+#include "afk/physics/Transform.hpp"
+#include "afk/physics/shape/Box.hpp"
+#include "afk/physics/shape/HeightMap.hpp"
+#include "afk/physics/shape/ModelShape.hpp"
+#include "afk/physics/shape/Sphere.hpp"
+#include "afk/thread/RingBuffer.hpp"
+#include "afk/thread/ThreadPool.hpp"
 #include "glm/vec3.hpp"
 
 namespace Afk {
@@ -13,20 +37,302 @@ namespace Afk {
 
   using World = std::unique_ptr<rp3d::DynamicsWorld>;
 
+  /**
+   * Steps the physics world at a fixed rate, however fast frames come.
+   *
+   * Frame time is banked in an accumulator and spent in fixed steps, at most
+   * max_substeps a frame. Time beyond that is dropped rather than caught up
+   * on later, so one slow frame can't snowball into slower ones. Transforms
+   * are interpolated between the last two steps by whatever time is left
+   * over, so motion stays smooth at any frame rate.
+   *
+   * The world can also be stepped on a thread of its own, at the same fixed
+   * rate, overlapping whatever the main thread is doing. Forces, torques and
+   * translations reach it through a lock-free command queue. Each step's
+   * poses are published as a snapshot, swapped with the one the main thread
+   * reads transforms from whenever it finds a newer one, never waiting on
+   * the physics thread to do so.
+   *
+   * Snapshots only hold bodies that moved since the main thread last read
+   * one, so only their transforms are synced and marked dirty. Sleeping and
+   * static bodies cost nothing a frame, unless they're moved by hand.
+   *
+   * Everything else that touches the world, like creating and destroying
+   * bodies, locks it. Data bodies read in place, like a height field's
+   * samples, should only be changed with the world locked too.
+   *
+   * Box, sphere and model shapes are interned by size, so bodies of the same
+   * size share one shape, freed with the last of them. Entries for freed
+   * shapes are swept out of the caches as they grow. Model shapes are built
+   * from the model's cooked collider, so nothing's computed at runtime but
+   * the tree rp3d builds over a mesh's triangles.
+   *
+   * The world can be partitioned into square regions on the ground, each a
+   * world of its own, stepped alongside the others as jobs. Bodies move to
+   * whichever region they're over after every step. Bodies near a region's
+   * edges are ghosted into the regions across them, as kinematic
+   * copies that push bodies there, but aren't pushed back. Static bodies are
+   * ghosted into every region they reach, so a region only ever needs its
+   * neighbours' bodies to collide with, and separate clusters of bodies are
+   * simulated in parallel.
+   *
+   * Rays, sweeps and overlaps are queried in batches, each taking the lock
+   * once for all of its queries. The world's allocators aren't safe to share
+   * between threads, so a batch can't be split up, but it can run on a query
+   * thread of its own, alongside the caller.
+   */
   class PhysicsBodySystem {
   public:
-    PhysicsBodySystem();
+    using Entities = std::vector<GameObject>;
+
+    // A body to create, with everything its constructor takes.
+    struct Spawn {
+      GameObject entity                           = {};
+      Transform transform                         = {};
+      float bounciness                            = 0.0f;
+      float linear_dampening                      = 0.0f;
+      float angular_dampening                     = 0.0f;
+      float mass                                  = 1.0f;
+      bool gravity_enabled                        = true;
+      RigidBodyType body_type                     = RigidBodyType::DYNAMIC;
+      std::variant<Box, Sphere, ModelShape> shape = Box{1.0f};
+    };
+
+    using Spawns = std::vector<Spawn>;
+
+    struct Stats {
+      // Steps taken since the last frame.
+      std::size_t steps = 0;
+      // Transforms synced this frame.
+      std::size_t synced = 0;
+      // Seconds of frame time dropped since the last frame, and since starting.
+      float dropped_time       = 0.0f;
+      float total_dropped_time = 0.0f;
+      // How far between the last two steps transforms were drawn, from 0 to 1.
+      float alpha = 0.0f;
+      // Milliseconds the last step took, and syncing transforms this frame.
+      double step_time = 0.0;
+      double sync_time = 0.0;
+      // Regions being simulated, and ghosts in them standing in for bodies
+      // in their neighbours.
+      std::size_t regions = 0;
+      std::size_t ghosts  = 0;
+    };
+
+    // Seconds of simulation each step covers.
+    float fixed_step = 1.0f / 60.0f;
+    // Steps taken at once to catch up at most. Both of these are read by the
+    // physics thread when it starts.
+    std::size_t max_substeps = 4;
+    // Bodies within this distance of a region are ghosted into it.
+    float ghost_margin = 2.0f;
 
+    PhysicsBodySystem();
     explicit PhysicsBodySystem(glm::vec3 gravity);
+    ~PhysicsBodySystem();
+    PhysicsBodySystem(PhysicsBodySystem &&)      = delete;
+    PhysicsBodySystem(const PhysicsBodySystem &) = delete;
+    auto operator=(const PhysicsBodySystem &) -> PhysicsBodySystem & = delete;
+    auto operator=(PhysicsBodySystem &&) -> PhysicsBodySystem & = delete;
 
     auto get_gravity();
 
     auto set_gravity(glm::vec3 gravity);
 
+    /**
+     * Steps the world with dt seconds of frame time, or picks up the physics
+     * thread's latest poses if it's running, then syncs transforms.
+     */
     auto update(entt::registry *registry, float dt) -> void;
+    auto get_stats() const -> Stats;
+    // Returns the entities whose transforms the last update synced.
+    auto get_moved() const -> const Entities &;
+    auto set_threaded(bool threaded) -> void;
+    auto get_threaded() const -> bool;
+    // Keeps the physics thread from stepping until the lock is released.
+    auto lock() -> std::unique_lock<std::recursive_mutex>;
+    /**
+     * Partitions the world into regions size across, moving every body into
+     * its region straight away. Zero puts every body back in one world.
+     */
+    auto set_region_size(float size) -> void;
+    auto get_region_size() const -> float;
+
+    /**
+     * Creates a body for each spawn, and assigns it to the spawn's entity,
+     * taking the world's lock once for all of them. Model colliders are
+     * cooked before the lock's taken.
+     */
+    auto spawn(entt::registry *registry, const Spawns &spawns) -> void;
+    // Returns how many distinct shapes are still shared between bodies.
+    auto get_shape_count() -> std::size_t;
+
+    /**
+     * Runs every query in the batch, and writes their results into it, as of
+     * the last step. Sweeps step a sphere along the ray a radius at a time,
+     * so they can pass through bodies thinner than that at their edges.
+     */
+    auto query(PhysicsQuery &batch) -> void;
+    // Runs the batch on the query thread. Leave it be until the future's ready.
+    auto query_async(PhysicsQuery &batch) -> std::future<void>;
+
+    // Removes the body and its ghosts, before its component is destroyed.
+    auto destroy(PhysicsBody &physics_body) -> void;
+
+    // Swaps a height field body's shape for one matching its map's current
+    // scale, and moves the body by however much the map's offset changed.
+    // Edits that keep both don't need this, the field reads the map's
+    // samples in place.
+    auto set_height_map(PhysicsBody &physics_body, const HeightMap &height_map) -> void;
 
   private:
-    World world = nullptr;
+    using Clock = std::chrono::steady_clock;
+
+    struct Command {
+      enum class Type { Force, Torque, Translate };
+
+      Type type         = {};
+      GameObject entity = {};
+      glm::vec3 value   = {};
+    };
+
+    // Regions by their column and row on the ground.
+    using RegionKey = std::pair<int, int>;
+    using Ghosts    = std::map<RegionKey, rp3d::RigidBody *>;
+
+    struct Region {
+      // Declared before the world, so it outlives the query sphere in it.
+      std::shared_ptr<rp3d::CollisionShape> query_shape = nullptr;
+      World world                                       = nullptr;
+      // The sphere overlaps and sweeps are tested with, colliding with nothing.
+      rp3d::RigidBody *query_body                       = nullptr;
+      rp3d::ProxyShape *query_proxy                     = nullptr;
+      // Bodies the region owns, not counting ghosts.
+      std::size_t body_count                            = 0;
+    };
+
+    /**
+     * A body the world steps, where it was before the last step, and where
+     * it last moved to. Bodies are kept by entity, since moving to another
+     * region means being created again in that region's world.
+     */
+    struct Body {
+      GameObject entity             = {};
+      rp3d::RigidBody *body         = nullptr;
+      rp3d::ProxyShape *proxy       = nullptr;
+      // Owned by the body's component.
+      rp3d::CollisionShape *shape   = nullptr;
+      RegionKey region              = {};
+      Ghosts ghosts                 = {};
+      rp3d::Transform previous_pose = rp3d::Transform::identity();
+      rp3d::Transform last_pose     = rp3d::Transform::identity();
+      std::size_t moved_step_count  = 0;
+      // Moved by hand since the last snapshot.
+      bool is_moved = false;
+      // In its region, with ghosts wherever it's near, as of its last move.
+      bool is_placed = false;
+      // At rest, with its ghosts stopped along with it.
+      bool is_settled = false;
+    };
+
+    struct Pose {
+      GameObject entity             = {};
+      rp3d::Transform previous_pose = rp3d::Transform::identity();
+      rp3d::Transform current_pose  = rp3d::Transform::identity();
+    };
+
+    struct Snapshot {
+      std::vector<Pose> poses = {};
+      // When the step was taken, and how many have been taken in total.
+      Clock::time_point time   = {};
+      std::size_t step_count   = 0;
+      double step_time         = 0.0;
+      float total_dropped_time = 0.0f;
+      std::size_t regions      = 0;
+      std::size_t ghosts       = 0;
+    };
+
+    // Shapes by type and size, each size being its scaled dimensions.
+    using ShapeKey    = std::tuple<int, float, float, float>;
+    using Shapes      = std::map<ShapeKey, std::weak_ptr<rp3d::CollisionShape>>;
+    // And by model and collider type, each scaled by the body's transform.
+    using ModelKey    = std::tuple<std::string, int, float, float, float>;
+    using ModelShapes = std::map<ModelKey, std::weak_ptr<rp3d::CollisionShape>>;
+    using Bodies      = std::unordered_map<GameObject, Body>;
+    using Regions     = std::map<RegionKey, Region>;
+    using Worlds      = std::vector<rp3d::DynamicsWorld *>;
+    using Commands    = RingBuffer<Command, 4096>;
+    using Overlapping = std::vector<rp3d::CollisionBody *>;
+
+    glm::vec3 gravity                         = {0.0f, -9.81f, 0.0f};
+    float region_size                         = 0.0f;
+    // Guards the regions and bodies. Recursive, so a caller holding the lock
+    // can still call anything that takes it.
+    std::recursive_mutex world_mutex          = {};
+    Bodies bodies                             = {};
+    Regions regions                           = {};
+    // A region was opened, so bodies near it have to be ghosted into it.
+    bool is_regions_changed                   = false;
+    std::size_t ghost_count                   = 0;
+    Shapes shapes                             = {};
+    ModelShapes model_shapes                  = {};
+    // How many shapes the caches can hold before expired ones are swept out.
+    std::size_t shape_capacity                = 64;
+    Commands commands                         = {};
+    float accumulator                         = 0.0f;
+    // Steps taken in total, guarded by the world lock.
+    std::size_t step_count                    = 0;
+    // Steps taken as of the snapshot last read from, so snapshots can leave
+    // out bodies that haven't moved since.
+    std::atomic<std::size_t> read_step_count  = {0};
+    Entities moved                            = {};
+    Stats stats                               = {};
+    // The physics thread fills its own snapshot, then swaps it with the
+    // published one, which the main thread swaps with the one it reads.
+    Snapshot back                             = {};
+    Snapshot published                        = {};
+    Snapshot front                            = {};
+    std::mutex snapshot_mutex                 = {};
+    bool is_published                         = false;
+    std::atomic<bool> is_threaded             = {false};
+    std::thread thread                        = {};
+    Overlapping overlapping                   = {};
+    // The regions' worlds, in the order they're stepped.
+    Worlds stepping                           = {};
+    // Joined first thing on destruction, before anything a query touches goes.
+    std::unique_ptr<ThreadPool> query_workers = std::make_unique<ThreadPool>(1);
+
+    auto run() -> void;
+    auto step(float dt, bool is_last) -> void;
+    auto take_snapshot(Snapshot &snapshot) -> void;
+    auto apply_commands() -> void;
+    auto apply(const Command &command) -> void;
+    auto push(const Command &command) -> void;
+    auto add_body(GameObject entity, const rp3d::Transform &transform,
+                  rp3d::CollisionShape *shape, float mass) -> rp3d::RigidBody *;
+    auto step_regions(float dt) -> void;
+    auto rebalance() -> void;
+    auto place(Body &info) -> void;
+    auto settle(Body &info) -> void;
+    auto migrate(Body &info, RegionKey key) -> void;
+    auto create_ghost(Region &region, const Body &info) -> rp3d::RigidBody *;
+    auto close_empty_regions() -> void;
+    auto get_region(RegionKey key) -> Region &;
+    auto get_region_key(const rp3d::Vector3 &position) const -> RegionKey;
+    auto is_near(RegionKey key, const rp3d::AABB &bounds) const -> bool;
+    auto prune_shapes() -> void;
+    auto get_box_shape(glm::vec3 half_extents) -> std::shared_ptr<rp3d::CollisionShape>;
+    auto get_sphere_shape(float radius) -> std::shared_ptr<rp3d::CollisionShape>;
+    auto get_model_shape(const ModelShape &model_shape, glm::vec3 scale,
+                         RigidBodyType body_type) -> std::shared_ptr<rp3d::CollisionShape>;
+    auto sync_transforms(entt::registry *registry, float alpha) -> void;
+    auto raycast(const PhysicsQuery::Ray &ray, PhysicsQuery::Hit &hit) -> void;
+    auto sweep(const PhysicsQuery::Sweep &sweep, PhysicsQuery::Hit &hit) -> void;
+    auto overlap(const PhysicsQuery::Overlap &overlap, PhysicsQuery &batch) -> void;
+    auto test_overlap(glm::vec3 center, float radius) -> const Overlapping &;
+    auto get_entity(const rp3d::CollisionBody *body) const -> GameObject;
+
+    static auto is_resting(const rp3d::RigidBody *body) -> bool;
 
     friend class PhysicsBody;
   };
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "afk/component/GameObject.hpp"
+#include "glm/vec3.hpp"
+
+namespace Afk {
+  /**
+   * A batch of queries against the physics world, and where their results
+   * go, run all at once by PhysicsBodySystem::query.
+   *
+   * Each kind of query has its own results, one per query in the same order.
+   * Results are written over the last batch's, so a batch that's kept and
+   * refilled stops allocating once it's grown to size.
+   */
+  struct PhysicsQuery {
+    struct Ray {
+      glm::vec3 origin    = {};
+      glm::vec3 direction = {0.0f, -1.0f, 0.0f};
+      float max_distance  = 0.0f;
+    };
+
+    // A sphere swept along a ray.
+    struct Sweep {
+      glm::vec3 origin    = {};
+      glm::vec3 direction = {0.0f, -1.0f, 0.0f};
+      float max_distance  = 0.0f;
+      float radius        = 0.5f;
+    };
+
+    // Every body a sphere overlaps.
+    struct Overlap {
+      glm::vec3 center = {};
+      float radius     = 0.5f;
+    };
+
+    struct Hit {
+      bool is_hit       = false;
+      GameObject entity = entt::null;
+      // How far along the ray the hit is. A sweep's position is where the
+      // sphere's centre is when it first touches the body.
+      float distance     = 0.0f;
+      glm::vec3 position = {};
+      glm::vec3 normal   = {};
+    };
+
+    // Where an overlap's entities are in overlapped.
+    struct Span {
+      std::size_t first = 0;
+      std::size_t count = 0;
+    };
+
+    std::vector<Ray> rays         = {};
+    std::vector<Sweep> sweeps     = {};
+    std::vector<Overlap> overlaps = {};
+
+    std::vector<Hit> ray_hits          = {};
+    std::vector<Hit> sweep_hits        = {};
+    std::vector<Span> overlap_spans    = {};
+    std::vector<GameObject> overlapped = {};
+  };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/vec3.hpp"
+
+namespace Afk {
+  /**
+   * Collision geometry cooked from a model: either every triangle it has,
+   * with shared vertices welded, or the convex hull of its vertices.
+   *
+   * Triangle meshes collide exactly, but only with convex shapes, so they
+   * suit static scenery. Hulls collide with anything, so they suit dynamic
+   * bodies.
+   */
+  struct Collider {
+    enum class Type { Mesh, Hull };
+
+    using Index    = std::uint32_t;
+    using Vertices = std::vector<glm::vec3>;
+    using Indices  = std::vector<Index>;
+
+    Type type = Type::Mesh;
+    // In the model's space. Both kinds are triangles, three indices to each,
+    // wound counter-clockwise seen from outside.
+    Vertices vertices = {};
+    Indices indices   = {};
+  };
+}
@@ -1,11 +1,49 @@
 #include "afk/physics/shape/HeightMap.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include "afk/debug/Assert.hpp"
+
 using Afk::HeightMap;
+using Sample = Afk::HeightMap::Sample;
 
 auto HeightMap::at(Point p) const -> float {
-  return this->heights.at(static_cast<size_t>(p.y * this->width + p.x));
+  return this->dequantize(this->heights.at(static_cast<size_t>(p.y * this->width + p.x)));
+}
+
+auto HeightMap::get_length() const -> int {
+  return this->width > 0 ? static_cast<int>(this->heights.size()) / this->width : 0;
+}
+
+auto HeightMap::get_region() const -> Region {
+  return Region{0, 0, this->width, this->get_length()};
+}
+
+auto HeightMap::get_min_height() const -> float {
+  return this->dequantize(-MAX_SAMPLE);
+}
+
+auto HeightMap::get_max_height() const -> float {
+  return this->dequantize(MAX_SAMPLE);
+}
+
+auto HeightMap::set_range(float min_height, float max_height) -> void {
+  afk_assert(min_height <= max_height, "Invalid height range");
+
+  const auto half_range = (max_height - min_height) / 2.0f;
+
+  // A flat map still needs a usable scale.
+  this->scale  = half_range > 0.0f ? half_range / static_cast<float>(MAX_SAMPLE) : 1.0f;
+  this->offset = min_height + half_range;
+}
+
+auto HeightMap::quantize(float height) const -> Sample {
+  const auto sample = static_cast<Sample>(std::lround((height - this->offset) / this->scale));
+
+  return std::clamp(sample, -MAX_SAMPLE, MAX_SAMPLE);
 }
 
-auto HeightMap::operator[](Point p) -> float & {
-  return this->heights[static_cast<size_t>(p.y * this->width + p.x)];
+auto HeightMap::dequantize(Sample sample) const -> float {
+  return static_cast<float>(sample) * this->scale + this->offset;
 }
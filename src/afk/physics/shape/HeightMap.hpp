@@ -1,18 +1,52 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 namespace Afk {
+  /**
+   * Heights quantized to 16 bits, as height = sample * scale + offset.
+   *
+   * This is the one copy of the terrain's heights: physics reads the samples
+   * in place as an integer height field, and the renderer uploads them as the
+   * height texture its terrain grid is displaced by. Samples are stored as
+   * ints rather than shorts since that's what rp3d's integer height fields
+   * read.
+   */
   struct HeightMap {
+    using Sample = std::int32_t;
+
+    // Samples span [-MAX_SAMPLE, MAX_SAMPLE], so they fit a signed normalized texture.
+    static constexpr auto MAX_SAMPLE = Sample{32767};
+
     struct Point {
       int x = {};
       int y = {};
     };
 
-    std::vector<float> heights = {};
-    int width                  = {};
+    // A rectangle of samples, e.g. the part of the map an edit changed.
+    struct Region {
+      int x      = {};
+      int y      = {};
+      int width  = {};
+      int length = {};
+    };
+
+    std::vector<Sample> heights = {};
+    int width                   = {};
+    float scale                 = 1.0f;
+    float offset                = 0.0f;
 
     auto at(Point p) const -> float;
-    auto operator[](Point p) -> float &;
+    auto get_length() const -> int;
+    auto get_region() const -> Region;
+
+    // The lowest and highest heights the samples can hold.
+    auto get_min_height() const -> float;
+    auto get_max_height() const -> float;
+    // Picks the scale and offset so heights between the two use every sample.
+    auto set_range(float min_height, float max_height) -> void;
+    auto quantize(float height) const -> Sample;
+    auto dequantize(Sample sample) const -> float;
   };
 }
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <filesystem>
+
+#include "afk/physics/shape/Collider.hpp"
+
+namespace Afk {
+  // A collider cooked from the model at model_path.
+  struct ModelShape {
+    std::filesystem::path model_path = {};
+    Collider::Type type              = Collider::Type::Mesh;
+  };
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/renderer/Renderer.hpp"
+
+namespace Afk {
+  /**
+   * Everything the renderer needs to draw a frame, taken from the registry
+   * once the frame's been simulated. Nothing in it points back into the
+   * registry, so it can be drawn while the next frame's simulated.
+   *
+   * Animated models carry the frame of animation they're at, and their
+   * bones are posed as they're drawn, since the animations themselves
+   * belong to the renderer's model handles.
+   */
+  struct FramePacket {
+    using DrawCommands = std::vector<Renderer::DrawCommand>;
+
+    DrawCommands draws   = {};
+    glm::mat4 view       = glm::mat4{1.0f};
+    glm::mat4 projection = glm::mat4{1.0f};
+    // Frames simulated before this one was taken.
+    std::size_t frame = 0;
+  };
+}
@@ -0,0 +1,33 @@
+#include "afk/renderer/Frustum.hpp"
+
+#include <glm/glm.hpp>
+
+using glm::mat4;
+using glm::vec3;
+using glm::vec4;
+
+using Afk::Frustum;
+
+Frustum::Frustum(const mat4 &matrix) {
+  // GLM is column major, so the rows need gathering.
+  const auto row = [&matrix](int i) {
+    return vec4{matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]};
+  };
+
+  this->planes = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                  row(3) - row(1), row(3) + row(2), row(3) - row(2)};
+}
+
+auto Frustum::intersects(const vec3 &min, const vec3 &max) const -> bool {
+  for (const auto &plane : this->planes) {
+    // The corner furthest along the plane's normal.
+    const auto corner = vec3{plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y,
+                             plane.z > 0.0f ? max.z : min.z};
+
+    if (glm::dot(vec3{plane}, corner) + plane.w < 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+namespace Afk {
+  /**
+   * The volume visible through a camera, as six inward facing planes.
+   *
+   * Planes are extracted from a combined projection, view and optionally model
+   * matrix, so the frustum is in whatever space the matrix transforms from.
+   */
+  class Frustum {
+  public:
+    using Planes = std::array<glm::vec4, 6>;
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4 &matrix);
+
+    /**
+     * Returns whether any part of the axis-aligned box may be visible. Boxes
+     * near the frustum's corners may be reported visible when they aren't.
+     */
+    auto intersects(const glm::vec3 &min, const glm::vec3 &max) const -> bool;
+
+  private:
+    Planes planes = {};
+  };
+}
@@ -0,0 +1,15 @@
+#include "afk/renderer/Image.hpp"
+
+#include <cstddef>
+
+using Afk::Image;
+
+auto Image::get_size() const -> std::size_t {
+  auto size = std::size_t{0};
+
+  for (const auto &level : this->levels) {
+    size += level.pixels.size();
+  }
+
+  return size;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afk {
+  /**
+   * Texture pixel data with its full mip chain, either as 8-bit RGBA or as
+   * block compressed data ready to be uploaded directly.
+   */
+  struct Image {
+    using Pixels = std::vector<unsigned char>;
+
+    enum class Format : std::uint32_t { Rgba8, Bc1, Bc3, Bc5 };
+
+    struct Level {
+      int width     = {};
+      int height    = {};
+      Pixels pixels = {};
+    };
+
+    using Levels = std::vector<Level>;
+
+    Format format = Format::Rgba8;
+    int width     = {};
+    int height    = {};
+    int channels  = {};
+    Levels levels = {};
+
+    auto get_size() const -> std::size_t;
+  };
+}
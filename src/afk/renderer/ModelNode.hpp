@@ -15,6 +15,8 @@ namespace Afk {
     ChildIds child_ids = {};
     // points to index of meshes contained in node
     MeshIds mesh_ids     = {};
-    Transform transform  = {};
+    // Relative to the parent node. Identity unless loaded, since a default
+    // Transform is translated.
+    Transform transform = Transform{glm::mat4{1.0f}};
   };
 }
@@ -1,29 +1,78 @@
 #include "afk/renderer/ModelRenderSystem.hpp"
 
+#include <glm/glm.hpp>
+
+#include "afk/Afk.hpp"
 #include "afk/component/AnimationFrame.hpp"
+#include "afk/component/WorldTransform.hpp"
 #include "afk/io/ModelSource.hpp"
-#include "afk/physics/Transform.hpp"
+#include "afk/renderer/Frustum.hpp"
+#include "afk/terrain/Terrain.hpp"
+
+auto Afk::extract_models(entt::registry *registry, Afk::FramePacket *packet) -> void {
+  packet->draws.clear();
 
-auto Afk::queue_models(entt::registry *registry, Afk::Renderer *renderer) -> void {
   // draw normal models without animations
-  auto render_view = registry->view<Afk::Transform, Afk::ModelSource>(
-      entt::exclude<Afk::AnimationFrame>);
+  auto render_view = registry->view<Afk::WorldTransform, Afk::ModelSource>(
+      entt::exclude<Afk::AnimationFrame, Afk::Terrain>);
   for (const auto entity : render_view) {
-    const auto model_component = render_view.get<Afk::ModelSource>(entity);
-    const auto model_transform = render_view.get<Afk::Transform>(entity);
-    renderer->queue_draw({model_component.name,
-                          model_component.shader_program_path, model_transform});
+    const auto &model_component = render_view.get<Afk::ModelSource>(entity);
+    const auto &model_transform = render_view.get<Afk::WorldTransform>(entity);
+    packet->draws.push_back({model_component.model_id, model_component.shader_program_id,
+                             model_transform.matrix});
   }
 
   // draw models with animations
   auto animated_render_view =
-      registry->view<Afk::Transform, Afk::ModelSource, Afk::AnimationFrame>();
+      registry->view<Afk::WorldTransform, Afk::ModelSource, Afk::AnimationFrame>();
   for (const auto entity : animated_render_view) {
-    const auto model_component = animated_render_view.get<Afk::ModelSource>(entity);
-    const auto model_transform = animated_render_view.get<Afk::Transform>(entity);
-    const auto model_animation_frame =
+    const auto &model_component = animated_render_view.get<Afk::ModelSource>(entity);
+    const auto &model_transform = animated_render_view.get<Afk::WorldTransform>(entity);
+    const auto &model_animation_frame =
         animated_render_view.get<Afk::AnimationFrame>(entity);
-    renderer->queue_draw({model_component.name, model_component.shader_program_path,
-                          model_transform, model_animation_frame});
+    packet->draws.push_back({model_component.model_id, model_component.shader_program_id,
+                             model_transform.matrix, model_animation_frame});
+  }
+
+  // draw only the terrain chunks in view, at a detail depending on distance
+  auto &afk                  = Afk::Engine::get();
+  const auto view_projection = packet->projection * packet->view;
+
+  // Streamed tiles cover the generated terrain, so drawing both would z-fight.
+  if (afk.terrain_streamer.get_enabled()) {
+    return;
+  }
+
+  auto terrain_view = registry->view<Afk::WorldTransform, Afk::ModelSource, Afk::Terrain>();
+  for (const auto entity : terrain_view) {
+    const auto &model_component = terrain_view.get<Afk::ModelSource>(entity);
+    const auto &model_transform = terrain_view.get<Afk::WorldTransform>(entity);
+
+    // Select in the terrain's own space, so chunk bounds needn't be transformed.
+    const auto frustum    = Afk::Frustum{view_projection * model_transform.matrix};
+    const auto to_terrain = glm::inverse(model_transform.matrix);
+    const auto camera_position =
+        glm::vec3{to_terrain * glm::vec4{afk.camera.get_position(), 1.0f}};
+    const auto &chunk_ids = afk.terrain_manager.select_chunks(frustum, camera_position);
+    const auto &chunks    = afk.terrain_manager.get_chunks();
+
+    // No patches means the whole model, so skip the draw when nothing's in view.
+    if (chunk_ids.empty()) {
+      continue;
+    }
+
+    // Every chunk is the same grid, placed and spaced out on the height map.
+    auto patches = Afk::Renderer::Patches{};
+    patches.reserve(chunk_ids.size());
+
+    for (const auto chunk_id : chunk_ids) {
+      const auto &chunk = chunks[chunk_id];
+
+      patches.push_back({glm::vec2{chunk.x, chunk.y}, static_cast<float>(1 << chunk.level),
+                         chunk.skirt_depth});
+    }
+
+    packet->draws.push_back({model_component.model_id, model_component.shader_program_id,
+                             model_transform.matrix, {}, std::move(patches)});
   }
 }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <entt/entt.hpp>
-#include "afk/renderer/Renderer.hpp"
+#include "afk/renderer/FramePacket.hpp"
 
 namespace Afk {
-  auto queue_models(entt::registry* registry, Afk::Renderer* renderer) -> void;
+  /**
+   * Fills a frame packet with draws for every model in the registry, and the
+   * terrain chunks in view of its camera, which must already be set.
+   */
+  auto extract_models(entt::registry* registry, Afk::FramePacket* packet) -> void;
 };
@@ -0,0 +1,183 @@
+#include "afk/renderer/ResourceManager.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "afk/debug/Assert.hpp"
+
+using namespace std::string_literals;
+using std::size_t;
+
+using Afk::ResourceManager;
+using Afk::Asset::AssetId;
+using Pool = Afk::ResourceManager::Pool;
+
+ResourceManager::ResourceManager() {
+  constexpr auto mebibyte  = size_t{1024 * 1024};
+  constexpr auto unlimited = std::numeric_limits<size_t>::max();
+
+  this->budgets[index(Pool::Model)]         = {512 * mebibyte, 256 * mebibyte};
+  this->budgets[index(Pool::Texture)]       = {1024 * mebibyte, unlimited};
+  this->budgets[index(Pool::Shader)]        = {unlimited, unlimited};
+  this->budgets[index(Pool::ShaderProgram)] = {unlimited, unlimited};
+}
+
+auto ResourceManager::acquire(Pool pool, AssetId id) -> Reference {
+  auto &weak = this->references[index(pool)][id];
+
+  if (auto reference = weak.lock()) {
+    return reference;
+  }
+
+  auto reference = std::make_shared<const AssetId>(id);
+  weak           = reference;
+
+  return reference;
+}
+
+auto ResourceManager::get_reference_count(Pool pool, AssetId id) const -> size_t {
+  const auto *reference = this->references[index(pool)].find(id);
+
+  return reference != nullptr ? static_cast<size_t>(reference->use_count()) : 0;
+}
+
+auto ResourceManager::is_referenced(Pool pool, AssetId id) const -> bool {
+  return this->get_reference_count(pool, id) > 0;
+}
+
+auto ResourceManager::track(Pool pool, AssetId id, Usage resource_usage) -> void {
+  auto &entry      = this->entries[index(pool)][id];
+  auto &pool_usage = this->usage[index(pool)];
+  pool_usage.gpu_bytes += resource_usage.gpu_bytes - entry.usage.gpu_bytes;
+  pool_usage.cpu_bytes += resource_usage.cpu_bytes - entry.usage.cpu_bytes;
+  entry.usage     = resource_usage;
+  entry.last_used = this->frame;
+}
+
+auto ResourceManager::untrack(Pool pool, AssetId id) -> void {
+  auto &pool_entries = this->entries[index(pool)];
+  const auto *entry  = pool_entries.find(id);
+
+  if (entry == nullptr) {
+    return;
+  }
+
+  auto &pool_usage = this->usage[index(pool)];
+  pool_usage.gpu_bytes -= entry->usage.gpu_bytes;
+  pool_usage.cpu_bytes -= entry->usage.cpu_bytes;
+  pool_entries.erase(id);
+
+  // Don't let references to long gone resources accumulate.
+  auto &pool_references = this->references[index(pool)];
+  const auto *reference = pool_references.find(id);
+
+  if (reference != nullptr && reference->expired()) {
+    pool_references.erase(id);
+  }
+}
+
+auto ResourceManager::touch(Pool pool, AssetId id) -> void {
+  auto *entry = this->entries[index(pool)].find(id);
+
+  if (entry != nullptr) {
+    entry->last_used = this->frame;
+  }
+}
+
+auto ResourceManager::retain(Pool pool, AssetId id) -> void {
+  ++this->entries[index(pool)][id].users;
+}
+
+auto ResourceManager::release(Pool pool, AssetId id) -> void {
+  auto &entry = this->entries[index(pool)][id];
+
+  afk_assert(entry.users > 0, "Released unused resource '"s +
+                                  Asset::AssetRegistry::get().get_path(id).string() + "'"s);
+  --entry.users;
+
+  // The last user going away is the last time the resource was needed.
+  entry.last_used = this->frame;
+}
+
+auto ResourceManager::set_pinned(Pool pool, AssetId id, bool is_pinned) -> void {
+  this->entries[index(pool)][id].is_pinned = is_pinned;
+}
+
+auto ResourceManager::next_frame() -> void {
+  ++this->frame;
+}
+
+auto ResourceManager::get_usage(Pool pool) const -> Usage {
+  return this->usage[index(pool)];
+}
+
+auto ResourceManager::get_budget(Pool pool) const -> Usage {
+  return this->budgets[index(pool)];
+}
+
+auto ResourceManager::set_budget(Pool pool, Usage budget) -> void {
+  this->budgets[index(pool)] = budget;
+}
+
+auto ResourceManager::is_over_budget(Pool pool) const -> bool {
+  const auto &pool_usage  = this->usage[index(pool)];
+  const auto &pool_budget = this->budgets[index(pool)];
+
+  return pool_usage.gpu_bytes > pool_budget.gpu_bytes ||
+         pool_usage.cpu_bytes > pool_budget.cpu_bytes;
+}
+
+auto ResourceManager::get_entries(Pool pool) const -> const Entries & {
+  return this->entries[index(pool)];
+}
+
+auto ResourceManager::get_frame() const -> Frame {
+  return this->frame;
+}
+
+auto ResourceManager::get_eviction_candidates(Pool pool) const -> Ids {
+  auto candidates = std::vector<std::pair<Frame, AssetId>>{};
+
+  for (const auto &[id, entry] : this->entries[index(pool)]) {
+    const auto is_loaded = entry.usage.gpu_bytes > 0 || entry.usage.cpu_bytes > 0;
+    const auto is_unused = entry.users == 0 && !this->is_referenced(pool, id);
+
+    // Anything used last frame is likely to be used again this frame.
+    const auto is_stale = entry.last_used + 1 < this->frame;
+
+    if (is_loaded && is_unused && is_stale && !entry.is_pinned) {
+      candidates.emplace_back(entry.last_used, id);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+  auto ids = Ids{};
+  ids.reserve(candidates.size());
+
+  for (const auto &[last_used, id] : candidates) {
+    ids.push_back(id);
+  }
+
+  return ids;
+}
+
+auto ResourceManager::get_pool_name(Pool pool) -> const char * {
+  switch (pool) {
+    case Pool::Model: return "Models";
+    case Pool::Texture: return "Textures";
+    case Pool::Shader: return "Shaders";
+    case Pool::ShaderProgram: return "Shader programs";
+    default: afk_unreachable();
+  }
+}
+
+auto ResourceManager::index(Pool pool) -> size_t {
+  return static_cast<size_t>(pool);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/asset/AssetTable.hpp"
+
+namespace Afk {
+  /**
+   * Book-keeping for renderer resources.
+   *
+   * Tracks how many bytes each pool holds on the GPU and CPU, who is still
+   * using each resource and when it was last used, so the renderer can evict
+   * the least recently used resources nobody references once a pool goes over
+   * budget. Evicted resources are reloaded from disk the next time they're
+   * requested.
+   */
+  class ResourceManager {
+  public:
+    enum class Pool { Model, Texture, Shader, ShaderProgram, Count };
+
+    static constexpr auto POOL_COUNT = static_cast<std::size_t>(Pool::Count);
+
+    // Keeps a resource alive for as long as any copy of it exists.
+    using AssetId   = Asset::AssetId;
+    using Reference = std::shared_ptr<const AssetId>;
+    using Frame     = std::uint64_t;
+    using Ids       = std::vector<AssetId>;
+
+    struct Usage {
+      std::size_t gpu_bytes = 0;
+      std::size_t cpu_bytes = 0;
+    };
+
+    struct Entry {
+      Usage usage       = {};
+      Frame last_used   = 0;
+      // Resources depending on this one, e.g. models sampling a texture.
+      std::size_t users = 0;
+      // Pinned resources can't be reloaded from disk, so are never evicted.
+      bool is_pinned = false;
+    };
+
+    using Entries = Asset::AssetTable<Entry>;
+
+    ResourceManager();
+
+    auto acquire(Pool pool, AssetId id) -> Reference;
+    auto get_reference_count(Pool pool, AssetId id) const
+        -> std::size_t;
+    auto is_referenced(Pool pool, AssetId id) const -> bool;
+
+    auto track(Pool pool, AssetId id, Usage usage) -> void;
+    auto untrack(Pool pool, AssetId id) -> void;
+    auto touch(Pool pool, AssetId id) -> void;
+    auto retain(Pool pool, AssetId id) -> void;
+    auto release(Pool pool, AssetId id) -> void;
+    auto set_pinned(Pool pool, AssetId id, bool is_pinned) -> void;
+    auto next_frame() -> void;
+
+    auto get_usage(Pool pool) const -> Usage;
+    auto get_budget(Pool pool) const -> Usage;
+    auto set_budget(Pool pool, Usage budget) -> void;
+    auto is_over_budget(Pool pool) const -> bool;
+    auto get_entries(Pool pool) const -> const Entries &;
+    auto get_frame() const -> Frame;
+
+    /**
+     * Returns every resource in the pool which could be unloaded right now,
+     * least recently used first. Resources used this or the previous frame
+     * are never returned.
+     */
+    auto get_eviction_candidates(Pool pool) const -> Ids;
+
+    static auto get_pool_name(Pool pool) -> const char *;
+
+  private:
+    using References = Asset::AssetTable<std::weak_ptr<const AssetId>>;
+
+    static auto index(Pool pool) -> std::size_t;
+
+    std::array<Entries, POOL_COUNT> entries       = {};
+    std::array<References, POOL_COUNT> references = {};
+    std::array<Usage, POOL_COUNT> usage           = {};
+    std::array<Usage, POOL_COUNT> budgets         = {};
+    Frame frame                                   = 1;
+  };
+}
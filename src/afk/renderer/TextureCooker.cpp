@@ -0,0 +1,548 @@
+#include "afk/renderer/TextureCooker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/debug/Assert.hpp"
+
+using std::array;
+using std::ifstream;
+using std::ofstream;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using std::vector;
+using std::filesystem::path;
+
+using glm::vec3;
+using glm::vec4;
+
+using Afk::Image;
+using Afk::Texture;
+using Format = Afk::Image::Format;
+
+constexpr auto container_magic = uint32_t{0x544b4641}; // "AFKT"
+constexpr auto lanczos_radius  = 3.0f;
+// Larger than any texture GL will take, and small enough that level sizes
+// can't overflow.
+constexpr auto max_dimension = int32_t{1 << 16};
+constexpr auto pi              = 3.14159265358979f;
+
+struct ContainerHeader {
+  uint32_t magic       = container_magic;
+  uint32_t version     = Afk::TextureCooker::VERSION;
+  Format format        = Format::Rgba8;
+  int32_t width        = {};
+  int32_t height       = {};
+  int32_t channels     = {};
+  uint32_t level_count = {};
+};
+
+struct LevelHeader {
+  int32_t width  = {};
+  int32_t height = {};
+  uint64_t size  = {};
+};
+
+struct FloatImage {
+  int width           = {};
+  int height          = {};
+  vector<vec4> texels = {};
+
+  auto at(int x, int y) const -> vec4 {
+    return this->texels[static_cast<size_t>(y * this->width + x)];
+  }
+};
+
+using Block = array<vec4, 16>;
+
+static auto lanczos(float x) -> float {
+  if (std::abs(x) < 1e-5f) {
+    return 1.0f;
+  }
+
+  if (std::abs(x) >= lanczos_radius) {
+    return 0.0f;
+  }
+
+  const auto px = pi * x;
+
+  return lanczos_radius * std::sin(px) * std::sin(px / lanczos_radius) / (px * px);
+}
+
+// Filters one output texel along a row or column, wrapping like GL_REPEAT.
+static auto filter(const FloatImage &src, int x, int y, bool horizontal, float scale) -> vec4 {
+  const auto src_length = horizontal ? src.width : src.height;
+  const auto i          = horizontal ? x : y;
+  const auto center     = (static_cast<float>(i) + 0.5f) * scale;
+  const auto support    = lanczos_radius * scale;
+  const auto first      = static_cast<int>(std::floor(center - support));
+  const auto last       = static_cast<int>(std::ceil(center + support));
+
+  auto sum        = vec4{0.0f};
+  auto weight_sum = 0.0f;
+
+  for (auto j = first; j <= last; ++j) {
+    const auto weight  = lanczos((static_cast<float>(j) + 0.5f - center) / scale);
+    const auto wrapped = ((j % src_length) + src_length) % src_length;
+
+    sum += weight * (horizontal ? src.at(wrapped, y) : src.at(x, wrapped));
+    weight_sum += weight;
+  }
+
+  return weight_sum != 0.0f ? sum / weight_sum : sum;
+}
+
+static auto downsample(const FloatImage &src, bool is_normal_map) -> FloatImage {
+  const auto width   = std::max(1, src.width / 2);
+  const auto height  = std::max(1, src.height / 2);
+  const auto scale_x = static_cast<float>(src.width) / static_cast<float>(width);
+  const auto scale_y = static_cast<float>(src.height) / static_cast<float>(height);
+
+  // The filter is separable, so resample rows then columns.
+  auto rows = FloatImage{width, src.height, {}};
+  rows.texels.resize(static_cast<size_t>(width * src.height));
+
+  for (auto y = 0; y < src.height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      rows.texels[static_cast<size_t>(y * width + x)] = filter(src, x, y, true, scale_x);
+    }
+  }
+
+  auto dst = FloatImage{width, height, {}};
+  dst.texels.resize(static_cast<size_t>(width * height));
+
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      auto texel = glm::clamp(filter(rows, x, y, false, scale_y), 0.0f, 1.0f);
+
+      if (is_normal_map) {
+        const auto normal = vec3{texel} * 2.0f - 1.0f;
+        const auto length = glm::length(normal);
+
+        if (length > 0.0f) {
+          texel = vec4{(normal / length) * 0.5f + 0.5f, texel.a};
+        }
+      }
+
+      dst.texels[static_cast<size_t>(y * width + x)] = texel;
+    }
+  }
+
+  return dst;
+}
+
+static auto to_float_image(const Image &image) -> FloatImage {
+  afk_assert(image.format == Format::Rgba8 && !image.levels.empty(),
+             "Only uncompressed images can be cooked");
+
+  const auto &level = image.levels.front();
+  auto float_image  = FloatImage{level.width, level.height, {}};
+  float_image.texels.resize(static_cast<size_t>(level.width * level.height));
+
+  for (auto i = size_t{0}; i < float_image.texels.size(); ++i) {
+    float_image.texels[i] = vec4{level.pixels[i * 4], level.pixels[i * 4 + 1],
+                                 level.pixels[i * 4 + 2], level.pixels[i * 4 + 3]} /
+                            255.0f;
+  }
+
+  return float_image;
+}
+
+static auto to_unorm8(float value) -> uint8_t {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+static auto to_565(vec3 color) -> uint16_t {
+  const auto r = static_cast<uint16_t>(std::lround(std::clamp(color.r, 0.0f, 1.0f) * 31.0f));
+  const auto g = static_cast<uint16_t>(std::lround(std::clamp(color.g, 0.0f, 1.0f) * 63.0f));
+  const auto b = static_cast<uint16_t>(std::lround(std::clamp(color.b, 0.0f, 1.0f) * 31.0f));
+
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static auto from_565(uint16_t color) -> vec3 {
+  return vec3{static_cast<float>((color >> 11) & 0x1f) / 31.0f,
+              static_cast<float>((color >> 5) & 0x3f) / 63.0f,
+              static_cast<float>(color & 0x1f) / 31.0f};
+}
+
+static auto write_u16(uint8_t *out, uint16_t value) -> void {
+  out[0] = static_cast<uint8_t>(value & 0xff);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+// Encodes the colour of a block as BC1, fitting the endpoints to the block's principal axis.
+static auto encode_bc1(const Block &block, uint8_t *out) -> void {
+  auto mean = vec3{0.0f};
+  for (const auto &texel : block) {
+    mean += vec3{texel};
+  }
+  mean /= 16.0f;
+
+  auto covariance = glm::mat3{0.0f};
+  for (const auto &texel : block) {
+    const auto d = vec3{texel} - mean;
+    covariance += glm::outerProduct(d, d);
+  }
+
+  // A few rounds of power iteration are plenty for a 3x3 matrix.
+  auto axis = vec3{1.0f, 1.0f, 1.0f};
+  for (auto i = 0; i < 4; ++i) {
+    axis              = covariance * axis;
+    const auto length = glm::length(axis);
+    axis              = length > 0.0f ? axis / length : vec3{0.0f};
+  }
+
+  auto min_color = vec3{block[0]};
+  auto max_color = vec3{block[0]};
+  auto min_dot   = glm::dot(min_color, axis);
+  auto max_dot   = min_dot;
+
+  for (const auto &texel : block) {
+    const auto dot = glm::dot(vec3{texel}, axis);
+
+    if (dot < min_dot) {
+      min_dot   = dot;
+      min_color = vec3{texel};
+    } else if (dot > max_dot) {
+      max_dot   = dot;
+      max_color = vec3{texel};
+    }
+  }
+
+  auto color0 = to_565(max_color);
+  auto color1 = to_565(min_color);
+
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  const auto p0      = from_565(color0);
+  const auto p1      = from_565(color1);
+  const auto palette = array<vec3, 4>{p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f};
+
+  auto indices = uint32_t{0};
+
+  // Equal endpoints select the three colour mode, where index 0 is still the endpoint.
+  if (color0 != color1) {
+    for (auto i = size_t{0}; i < block.size(); ++i) {
+      auto best          = uint32_t{0};
+      auto best_distance = std::numeric_limits<float>::max();
+
+      for (auto j = uint32_t{0}; j < palette.size(); ++j) {
+        const auto d        = vec3{block[i]} - palette[j];
+        const auto distance = glm::dot(d, d);
+
+        if (distance < best_distance) {
+          best          = j;
+          best_distance = distance;
+        }
+      }
+
+      indices |= best << (i * 2);
+    }
+  }
+
+  write_u16(out, color0);
+  write_u16(out + 2, color1);
+  write_u16(out + 4, static_cast<uint16_t>(indices & 0xffff));
+  write_u16(out + 6, static_cast<uint16_t>(indices >> 16));
+}
+
+// Encodes one channel of a block as BC4, which also makes up BC3 alpha and BC5.
+static auto encode_bc4(const Block &block, int channel, uint8_t *out) -> void {
+  auto min_value = block[0][channel];
+  auto max_value = block[0][channel];
+
+  for (const auto &texel : block) {
+    min_value = std::min(min_value, texel[channel]);
+    max_value = std::max(max_value, texel[channel]);
+  }
+
+  const auto value0 = to_unorm8(max_value);
+  const auto value1 = to_unorm8(min_value);
+
+  // With value0 > value1 the palette is eight evenly spaced values.
+  auto palette = array<float, 8>{};
+  palette[0]   = static_cast<float>(value0);
+  palette[1]   = static_cast<float>(value1);
+  for (auto i = 1; i < 7; ++i) {
+    palette[static_cast<size_t>(i + 1)] =
+        (static_cast<float>(7 - i) * palette[0] + static_cast<float>(i) * palette[1]) / 7.0f;
+  }
+
+  auto indices = uint64_t{0};
+
+  if (value0 != value1) {
+    for (auto i = size_t{0}; i < block.size(); ++i) {
+      const auto value   = block[i][channel] * 255.0f;
+      auto best          = uint64_t{0};
+      auto best_distance = std::numeric_limits<float>::max();
+
+      for (auto j = uint64_t{0}; j < palette.size(); ++j) {
+        const auto distance = std::abs(value - palette[j]);
+
+        if (distance < best_distance) {
+          best          = j;
+          best_distance = distance;
+        }
+      }
+
+      indices |= best << (i * 3);
+    }
+  }
+
+  out[0] = value0;
+  out[1] = value1;
+  for (auto i = size_t{0}; i < 6; ++i) {
+    out[2 + i] = static_cast<uint8_t>((indices >> (i * 8)) & 0xff);
+  }
+}
+
+static auto block_size(Format format) -> size_t {
+  switch (format) {
+    case Format::Bc1: return 8;
+    case Format::Bc3: return 16;
+    case Format::Bc5: return 16;
+    case Format::Rgba8: break;
+  }
+
+  afk_unreachable();
+}
+
+static auto get_level_size(Format format, int32_t width, int32_t height) -> uint64_t {
+  const auto texels = static_cast<uint64_t>(width) * static_cast<uint64_t>(height);
+
+  if (format == Format::Rgba8) {
+    return texels * 4;
+  }
+
+  const auto blocks_x = static_cast<uint64_t>((width + 3) / 4);
+  const auto blocks_y = static_cast<uint64_t>((height + 3) / 4);
+
+  return blocks_x * blocks_y * block_size(format);
+}
+
+static auto encode(const FloatImage &image, Format format) -> Image::Pixels {
+  auto pixels = Image::Pixels{};
+
+  if (format == Format::Rgba8) {
+    pixels.reserve(image.texels.size() * 4);
+
+    for (const auto &texel : image.texels) {
+      pixels.push_back(to_unorm8(texel.r));
+      pixels.push_back(to_unorm8(texel.g));
+      pixels.push_back(to_unorm8(texel.b));
+      pixels.push_back(to_unorm8(texel.a));
+    }
+
+    return pixels;
+  }
+
+  const auto blocks_x = (image.width + 3) / 4;
+  const auto blocks_y = (image.height + 3) / 4;
+  const auto size     = block_size(format);
+
+  pixels.resize(static_cast<size_t>(blocks_x * blocks_y) * size);
+
+  auto *out = pixels.data();
+  for (auto by = 0; by < blocks_y; ++by) {
+    for (auto bx = 0; bx < blocks_x; ++bx) {
+      // Clamp partial blocks at the edges of small mips.
+      auto block = Block{};
+      for (auto y = 0; y < 4; ++y) {
+        for (auto x = 0; x < 4; ++x) {
+          block[static_cast<size_t>(y * 4 + x)] =
+              image.at(std::min(bx * 4 + x, image.width - 1),
+                       std::min(by * 4 + y, image.height - 1));
+        }
+      }
+
+      switch (format) {
+        case Format::Bc1: encode_bc1(block, out); break;
+        case Format::Bc3:
+          encode_bc4(block, 3, out);
+          encode_bc1(block, out + 8);
+          break;
+        case Format::Bc5:
+          encode_bc4(block, 0, out);
+          encode_bc4(block, 1, out + 8);
+          break;
+        case Format::Rgba8: afk_unreachable();
+      }
+
+      out += size;
+    }
+  }
+
+  return pixels;
+}
+
+auto Afk::TextureCooker::choose_format(const Image &image, Texture::Type type) -> Format {
+  switch (type) {
+    case Texture::Type::Normal: return Format::Bc5;
+    case Texture::Type::Diffuse: {
+      const auto &pixels = image.levels.front().pixels;
+
+      for (auto i = size_t{3}; i < pixels.size(); i += 4) {
+        if (pixels[i] != 255) {
+          return Format::Bc3;
+        }
+      }
+
+      return Format::Bc1;
+    }
+    case Texture::Type::Specular:
+    case Texture::Type::Height:
+    case Texture::Type::Count: break;
+  }
+
+  return Format::Bc1;
+}
+
+auto Afk::TextureCooker::cook(const Image &image, Texture::Type type, bool compress) -> Image {
+  const auto is_normal_map = type == Texture::Type::Normal;
+
+  auto cooked     = Image{};
+  cooked.format   = compress ? TextureCooker::choose_format(image, type) : Format::Rgba8;
+  cooked.width    = image.width;
+  cooked.height   = image.height;
+  cooked.channels = image.channels;
+
+  auto level = to_float_image(image);
+
+  while (true) {
+    cooked.levels.push_back(
+        Image::Level{level.width, level.height, encode(level, cooked.format)});
+
+    if (level.width == 1 && level.height == 1) {
+      break;
+    }
+
+    level = downsample(level, is_normal_map);
+  }
+
+  return cooked;
+}
+
+auto Afk::TextureCooker::read(const path &file_path, Image &image) -> bool {
+  auto file = ifstream{file_path, std::ios::binary};
+
+  if (!file.is_open()) {
+    return false;
+  }
+
+  auto error           = std::error_code{};
+  const auto file_size = std::filesystem::file_size(file_path, error);
+
+  if (error) {
+    return false;
+  }
+
+  auto header = ContainerHeader{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+  if (!file || header.magic != container_magic || header.version != TextureCooker::VERSION) {
+    return false;
+  }
+
+  // Anything that doesn't match what cook would have written is rejected, so
+  // a truncated or corrupt file is cooked again rather than trusted.
+  const auto is_format_valid = header.format == Format::Rgba8 || header.format == Format::Bc1 ||
+                               header.format == Format::Bc3 || header.format == Format::Bc5;
+
+  if (!is_format_valid || header.width < 1 || header.width > max_dimension ||
+      header.height < 1 || header.height > max_dimension || header.channels < 0 ||
+      header.channels > 4) {
+    return false;
+  }
+
+  // Every level down to 1x1.
+  auto level_count = uint32_t{1};
+  for (auto size = std::max(header.width, header.height); size > 1; size /= 2) {
+    ++level_count;
+  }
+
+  if (header.level_count != level_count) {
+    return false;
+  }
+
+  auto cooked     = Image{};
+  cooked.format   = header.format;
+  cooked.width    = header.width;
+  cooked.height   = header.height;
+  cooked.channels = header.channels;
+  cooked.levels.resize(level_count);
+
+  auto total  = static_cast<uint64_t>(sizeof(header));
+  auto width  = header.width;
+  auto height = header.height;
+
+  for (auto &level : cooked.levels) {
+    auto level_header = LevelHeader{};
+    file.read(reinterpret_cast<char *>(&level_header), sizeof(level_header));
+    total += sizeof(level_header) + level_header.size;
+
+    if (!file || level_header.width != width || level_header.height != height ||
+        level_header.size != get_level_size(cooked.format, width, height) || total > file_size) {
+      return false;
+    }
+
+    level.width  = level_header.width;
+    level.height = level_header.height;
+    level.pixels.resize(static_cast<size_t>(level_header.size));
+    file.read(reinterpret_cast<char *>(level.pixels.data()),
+              static_cast<std::streamsize>(level.pixels.size()));
+
+    width  = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+
+  if (!file || total != file_size) {
+    return false;
+  }
+
+  image = std::move(cooked);
+
+  return true;
+}
+
+auto Afk::TextureCooker::write(const path &file_path, const Image &image) -> bool {
+  auto file = ofstream{file_path, std::ios::binary};
+
+  if (!file.is_open()) {
+    return false;
+  }
+
+  auto header        = ContainerHeader{};
+  header.format      = image.format;
+  header.width       = image.width;
+  header.height      = image.height;
+  header.channels    = image.channels;
+  header.level_count = static_cast<uint32_t>(image.levels.size());
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  for (const auto &level : image.levels) {
+    const auto level_header =
+        LevelHeader{level.width, level.height, static_cast<uint64_t>(level.pixels.size())};
+    file.write(reinterpret_cast<const char *>(&level_header), sizeof(level_header));
+    file.write(reinterpret_cast<const char *>(level.pixels.data()),
+               static_cast<std::streamsize>(level.pixels.size()));
+  }
+
+  return static_cast<bool>(file);
+}
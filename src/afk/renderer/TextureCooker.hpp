@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+
+#include "afk/renderer/Image.hpp"
+#include "afk/renderer/Texture.hpp"
+
+namespace Afk::TextureCooker {
+  // Bump whenever the cooked container layout or encoders change.
+  constexpr auto VERSION = 1u;
+
+  /**
+   * Picks the block compression format for a texture based on how it's used.
+   * Normal maps keep two high precision channels, everything else uses BC1
+   * unless it has an alpha channel.
+   */
+  auto choose_format(const Image &image, Texture::Type type) -> Image::Format;
+
+  /**
+   * Builds the full mip chain for a single level RGBA image with a Lanczos
+   * filter and optionally block compresses every level.
+   */
+  auto cook(const Image &image, Texture::Type type, bool compress) -> Image;
+
+  auto read(const std::filesystem::path &file_path, Image &image) -> bool;
+  auto write(const std::filesystem::path &file_path, const Image &image) -> bool;
+}
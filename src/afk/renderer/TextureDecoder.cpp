@@ -0,0 +1,200 @@
+#include "afk/renderer/TextureDecoder.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <stb/stb_image.h>
+
+#include "afk/debug/Assert.hpp"
+#include "afk/io/Path.hpp"
+#include "afk/renderer/TextureCooker.hpp"
+
+using namespace std::string_literals;
+using std::ifstream;
+using std::shared_ptr;
+using std::size_t;
+using std::string;
+using std::vector;
+using std::filesystem::path;
+
+using Afk::Image;
+using Afk::Texture;
+using Afk::TextureDecoder;
+
+static auto read_file(const path &file_path) -> vector<unsigned char> {
+  auto file = ifstream{file_path, std::ios::binary};
+
+  afk_assert(file.is_open(), "Unable to open texture '"s + file_path.string() + "'"s);
+
+  return vector<unsigned char>{std::istreambuf_iterator<char>{file},
+                               std::istreambuf_iterator<char>{}};
+}
+
+TextureDecoder::TextureDecoder(size_t num_threads) : threads(num_threads) {}
+
+auto TextureDecoder::decode(const Texture &texture) -> Result {
+  // The same file cooks differently depending on how it's used.
+  const auto key = texture.file_path.lexically_normal().string() + ":"s +
+                   std::to_string(static_cast<size_t>(texture.type));
+  auto lock      = std::scoped_lock{this->mutex};
+  const auto it  = this->in_flight.find(key);
+
+  if (it != this->in_flight.end()) {
+    return it->second;
+  }
+
+  auto result = Result{this->threads.enqueue([this, texture, key]() {
+    // Finished decodes are handed back through the future, not kept around.
+    // Failed ones are forgotten too, so the next request tries again.
+    const auto forget = [this, &key]() {
+      auto in_flight_lock = std::scoped_lock{this->mutex};
+      this->in_flight.erase(key);
+    };
+
+    try {
+      auto image = this->decode_file(texture);
+      forget();
+
+      return image;
+    } catch (...) {
+      forget();
+      throw;
+    }
+  })};
+
+  this->in_flight[key] = result;
+
+  return result;
+}
+
+auto TextureDecoder::set_cache_enabled(bool enabled) -> void {
+  this->cache_enabled = enabled;
+}
+
+auto TextureDecoder::set_compression_enabled(bool enabled) -> void {
+  this->compression_enabled = enabled;
+}
+
+auto TextureDecoder::get_thread_count() const -> size_t {
+  return this->threads.get_thread_count();
+}
+
+auto TextureDecoder::measure_throughput(const vector<path> &file_paths, size_t num_threads)
+    -> double {
+  auto decoder = TextureDecoder{num_threads};
+  decoder.set_cache_enabled(false);
+
+  auto results = vector<Result>{};
+  results.reserve(file_paths.size());
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (const auto &file_path : file_paths) {
+    results.push_back(decoder.decode(Texture{file_path}));
+  }
+
+  auto bytes = size_t{0};
+  for (const auto &result : results) {
+    bytes += result.get().get_size();
+  }
+
+  const auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - start};
+
+  return elapsed.count() > 0.0
+             ? static_cast<double>(bytes) / (1024.0 * 1024.0) / elapsed.count()
+             : 0.0;
+}
+
+auto TextureDecoder::decode_file(const Texture &texture) const -> Image {
+  const auto abs_path = Afk::get_absolute_path(texture.file_path);
+
+  afk_assert(std::filesystem::exists(abs_path),
+             "Texture "s + texture.file_path.string() + " doesn't exist"s);
+
+  const auto compress = this->compression_enabled.load();
+  const auto bytes    = read_file(abs_path);
+
+  // Mix everything that affects the cooked output into the cache key.
+  auto key = TextureDecoder::hash(bytes);
+  key ^= (static_cast<Hash>(texture.type) << 1 | (compress ? 1 : 0)) * Hash{0x9e3779b97f4a7c15};
+  key ^= static_cast<Hash>(TextureCooker::VERSION) << 56;
+
+  const auto cache_path = TextureDecoder::get_cache_path(key);
+  auto image            = Image{};
+
+  if (this->cache_enabled && TextureCooker::read(cache_path, image)) {
+    return image;
+  }
+
+  auto level  = Image::Level{};
+  auto pixels = shared_ptr<unsigned char>{
+      stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &level.width,
+                            &level.height, &image.channels, STBI_rgb_alpha),
+      stbi_image_free};
+
+  afk_assert(pixels != nullptr, "Failed to load image: '"s + texture.file_path.string() + "'"s);
+
+  const auto size = static_cast<size_t>(level.width) * static_cast<size_t>(level.height) * 4;
+  level.pixels.assign(pixels.get(), pixels.get() + size);
+  image.width  = level.width;
+  image.height = level.height;
+  image.levels.push_back(std::move(level));
+
+  image = TextureCooker::cook(image, texture.type, compress);
+
+  if (this->cache_enabled) {
+    TextureDecoder::write_cache(cache_path, image);
+  }
+
+  return image;
+}
+
+auto TextureDecoder::hash(const vector<unsigned char> &bytes) -> Hash {
+  // 64-bit FNV-1a.
+  auto value = Hash{0xcbf29ce484222325};
+
+  for (const auto byte : bytes) {
+    value ^= byte;
+    value *= Hash{0x100000001b3};
+  }
+
+  return value;
+}
+
+auto TextureDecoder::get_cache_path(Hash hash) -> path {
+  auto ss = std::ostringstream{};
+  ss << std::hex << hash << ".afktex";
+
+  return Afk::get_absolute_path(".cache/texture") / ss.str();
+}
+
+auto TextureDecoder::write_cache(const path &cache_path, const Image &image) -> void {
+  auto error = std::error_code{};
+  std::filesystem::create_directories(cache_path.parent_path(), error);
+
+  // Write to a temporary file first so a concurrent reader never sees a partial entry.
+  auto tmp_path = cache_path;
+  tmp_path += ".tmp"s + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  if (!TextureCooker::write(tmp_path, image)) {
+    std::filesystem::remove(tmp_path, error);
+    return;
+  }
+
+  std::filesystem::rename(tmp_path, cache_path, error);
+
+  if (error) {
+    std::filesystem::remove(tmp_path, error);
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "afk/renderer/Image.hpp"
+#include "afk/renderer/Texture.hpp"
+#include "afk/thread/ThreadPool.hpp"
+
+namespace Afk {
+  /**
+   * Decodes and cooks texture files on a bounded pool of worker threads.
+   *
+   * Concurrent requests for the same texture share a single decode, and cooked
+   * textures are cached on disk keyed by a hash of the source file's contents.
+   */
+  class TextureDecoder {
+  public:
+    using Result = std::shared_future<Image>;
+    using Hash   = std::uint64_t;
+
+    explicit TextureDecoder(std::size_t num_threads = ThreadPool::default_thread_count());
+    TextureDecoder(TextureDecoder &&)      = delete;
+    TextureDecoder(const TextureDecoder &) = delete;
+    auto operator=(const TextureDecoder &) -> TextureDecoder & = delete;
+    auto operator=(TextureDecoder &&) -> TextureDecoder & = delete;
+
+    auto decode(const Texture &texture) -> Result;
+    auto set_cache_enabled(bool enabled) -> void;
+    auto set_compression_enabled(bool enabled) -> void;
+    auto get_thread_count() const -> std::size_t;
+
+    /**
+     * Decodes every file with `num_threads` workers, bypassing the disk cache,
+     * and returns the throughput in megabytes of decoded pixels per second.
+     */
+    static auto measure_throughput(const std::vector<std::filesystem::path> &file_paths,
+                                   std::size_t num_threads) -> double;
+
+  private:
+    using InFlight = std::unordered_map<std::string, Result>;
+
+    auto decode_file(const Texture &texture) const -> Image;
+
+    static auto hash(const std::vector<unsigned char> &bytes) -> Hash;
+    static auto get_cache_path(Hash hash) -> std::filesystem::path;
+    static auto write_cache(const std::filesystem::path &cache_path, const Image &image) -> void;
+
+    std::atomic<bool> cache_enabled       = true;
+    std::atomic<bool> compression_enabled = false;
+    std::mutex mutex                      = {};
+    InFlight in_flight                    = {};
+    // Declared last so the workers are joined before the state they use is destroyed.
+    ThreadPool threads;
+  };
+}
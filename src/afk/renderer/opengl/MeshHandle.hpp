@@ -38,11 +38,14 @@ namespace Afk {
 
       static constexpr auto INDEX = GL_INDICES.at(ctti::type_id<Mesh::Index>());
 
-      GLuint vao              = {};
-      GLuint vbo              = {};
-      GLuint ibo              = {};
-      Textures textures       = {};
-      std::size_t num_indices = {};
+      GLuint vao               = {};
+      GLuint vbo               = {};
+      GLuint ibo               = {};
+      Textures textures        = {};
+      std::size_t num_indices  = {};
+      std::size_t num_vertices = {};
+      // The node whose world matrix the mesh is drawn with.
+      std::size_t node_index = {};
     };
   }
 }
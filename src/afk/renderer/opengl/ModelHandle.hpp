@@ -1,8 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <glob.h>
+#include <limits>
+#include <memory>
 #include <vector>
 
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "afk/asset/AssetRegistry.hpp"
 #include "afk/physics/Transform.hpp"
 #include "afk/renderer/Animation.hpp"
 #include "afk/renderer/Bone.hpp"
@@ -16,14 +23,36 @@ namespace Afk {
       using Nodes  = std::vector<ModelNode>;
       // TODO: convert to use frozen unordered_map for better efficiency
       using Animations = std::unordered_map<std::string, Animation>;
+      using TextureIds = std::vector<Asset::AssetId>;
+      // Immutable, so it can be shared with e.g. physics without copying.
+      using MeshData = std::shared_ptr<const std::vector<Mesh>>;
+      using Indices  = std::vector<std::size_t>;
+
+      static constexpr auto NONE = std::numeric_limits<std::size_t>::max();
+
+      // Node transforms relative to their parent, stored per component so the
+      // world matrix pass streams through them.
+      struct LocalTransforms {
+        std::vector<glm::vec3> translations = {};
+        std::vector<glm::quat> rotations    = {};
+        std::vector<glm::vec3> scales       = {};
+      };
 
       size_t root_node_index = 0;
 
-      Nodes nodes            = {};
-      Bones bones            = {};
-      BoneStringMap bone_map = {};
-      Meshes meshes          = {};
-      Animations animations  = {};
+      // Nodes are stored parent before child, so the root is always first.
+      Nodes nodes                      = {};
+      Indices node_parents             = {};
+      Indices node_bones               = {};
+      LocalTransforms local_transforms = {};
+      Bones bones                      = {};
+      BoneStringMap bone_map           = {};
+      Meshes meshes                    = {};
+      Animations animations            = {};
+      // Textures sampled by the meshes, kept alive for as long as the model is.
+      TextureIds texture_ids = {};
+      // CPU vertex and index arrays, if the model's policy is to keep them.
+      MeshData mesh_data = {};
       glm::mat4 global_inverse;
     };
   }
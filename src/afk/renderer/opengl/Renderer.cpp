@@ -1,11 +1,16 @@
 #include "afk/renderer/opengl/Renderer.hpp"
 
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <filesystem>
+#include <future>
 #include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -15,14 +20,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
-#include <stb/stb_image.h>
 // Must be loaded after GLAD.
 #include <GLFW/glfw3.h>
 
 #include "afk/Afk.hpp"
+#include "afk/asset/AssetRegistry.hpp"
 #include "afk/debug/Assert.hpp"
 #include "afk/io/Log.hpp"
 #include "afk/io/Path.hpp"
+#include "afk/renderer/FramePacket.hpp"
 #include "afk/renderer/Mesh.hpp"
 #include "afk/renderer/Model.hpp"
 #include "afk/renderer/Shader.hpp"
@@ -39,15 +45,22 @@ using std::shared_ptr;
 using std::size_t;
 using std::string;
 using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 using std::filesystem::path;
 
 using glm::ivec2;
 using glm::mat4;
+using glm::vec2;
 using glm::vec3;
 using glm::vec4;
 
 using Afk::Engine;
+using Afk::HeightMap;
+using Afk::Asset::AssetId;
+using Afk::Asset::AssetRegistry;
+using Afk::Image;
+using Afk::ResourceManager;
 using Afk::Shader;
 using Afk::ShaderProgram;
 using Afk::Texture;
@@ -56,6 +69,11 @@ using Afk::OpenGl::Renderer;
 using Afk::OpenGl::ShaderHandle;
 using Afk::OpenGl::ShaderProgramHandle;
 using Afk::OpenGl::TextureHandle;
+using DecodedModel = Afk::OpenGl::Renderer::DecodedModel;
+using LoadState    = Afk::OpenGl::Renderer::LoadState;
+using Pool         = Afk::ResourceManager::Pool;
+using PendingModel = Afk::OpenGl::Renderer::PendingModel;
+using Patches      = Afk::OpenGl::Renderer::Patches;
 namespace Io = Afk::Io;
 
 constexpr auto material_strings =
@@ -66,22 +84,198 @@ constexpr auto material_strings =
         {Texture::Type::Height, "texture_height"},
     });
 
+// S3TC isn't core, so GLAD doesn't define its formats.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+  #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+  #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+constexpr auto gl_image_formats = frozen::make_unordered_map<Image::Format, GLenum>({
+    {Image::Format::Rgba8, GL_RGBA8},
+    {Image::Format::Bc1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT},
+    {Image::Format::Bc3, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT},
+    {Image::Format::Bc5, GL_COMPRESSED_RG_RGTC2},
+});
+
 constexpr auto gl_shader_types = frozen::make_unordered_map<Shader::Type, GLenum>({
     {Shader::Type::Vertex, GL_VERTEX_SHADER},
     {Shader::Type::Fragment, GL_FRAGMENT_SHADER},
 });
 
 // FIXME: Move someone more appropriate.
+// Estimates the CPU memory held by the node hierarchy, bones, animations and any
+// mesh data kept around.
+static auto get_cpu_size(const ModelHandle &model_handle) -> size_t {
+  const auto &local = model_handle.local_transforms;
+
+  auto size = model_handle.nodes.size() * sizeof(Afk::ModelNode) +
+              model_handle.bones.size() * sizeof(Afk::Bone);
+  size += (model_handle.node_parents.size() + model_handle.node_bones.size()) * sizeof(size_t);
+  size += (local.translations.size() + local.scales.size()) * sizeof(vec3) +
+          local.rotations.size() * sizeof(glm::quat);
+
+  if (model_handle.mesh_data != nullptr) {
+    for (const auto &mesh : *model_handle.mesh_data) {
+      size += mesh.vertices.size() * sizeof(Afk::Vertex) +
+              mesh.indices.size() * sizeof(Afk::Mesh::Index);
+    }
+  }
+
+  for (const auto &node : model_handle.nodes) {
+    size += node.name.size() + (node.child_ids.size() + node.mesh_ids.size()) * sizeof(size_t);
+  }
+
+  for (const auto &[name, animation] : model_handle.animations) {
+    for (const auto &[id, animation_node] : animation.animation_nodes) {
+      using AnimationNode = Afk::Animation::AnimationNode;
+
+      size += animation_node.position_keys.size() * sizeof(AnimationNode::PositionKey) +
+              animation_node.scaling_keys.size() * sizeof(AnimationNode::ScaleKey) +
+              animation_node.rotation_keys.size() * sizeof(AnimationNode::RotationKey);
+    }
+  }
+
+  return size;
+}
+
+static auto release_mesh_arrays(Afk::Mesh &mesh) -> void {
+  // Swapping, unlike clearing, actually gives the memory back.
+  Afk::Mesh::Vertices{}.swap(mesh.vertices);
+  Afk::Mesh::Indices{}.swap(mesh.indices);
+}
+
+static auto get_texture_ids(const Afk::Model &model) -> ModelHandle::TextureIds {
+  auto &assets     = AssetRegistry::get();
+  auto texture_ids = ModelHandle::TextureIds{};
+  auto seen        = unordered_set<AssetId>{};
+
+  for (const auto &mesh : model.meshes) {
+    for (const auto &texture : mesh.textures) {
+      const auto id = assets.intern(texture.file_path);
+
+      if (seen.insert(id).second) {
+        texture_ids.push_back(id);
+      }
+    }
+  }
+
+  return texture_ids;
+}
+
+// Reorders the node hierarchy so every parent comes before its children, and
+// records each node's parent, bone and meshes by index. The world matrix pass
+// can then walk the nodes front to back without recursing.
+static auto flatten_nodes(ModelHandle &model_handle) -> void {
+  auto &nodes    = model_handle.nodes;
+  auto order     = vector<size_t>{};
+  auto parents   = ModelHandle::Indices{};
+  auto new_index = ModelHandle::Indices(nodes.size(), ModelHandle::NONE);
+  auto stack     = vector<pair<size_t, size_t>>{};
+
+  if (!nodes.empty()) {
+    afk_assert(model_handle.root_node_index < nodes.size(), "Invalid root node index");
+    stack.emplace_back(model_handle.root_node_index, ModelHandle::NONE);
+  }
+
+  order.reserve(nodes.size());
+  parents.reserve(nodes.size());
+
+  while (!stack.empty()) {
+    const auto [node_index, parent] = stack.back();
+    stack.pop_back();
+
+    afk_assert(node_index < nodes.size(), "Invalid node index");
+    afk_assert(new_index[node_index] == ModelHandle::NONE, "Node hierarchy has a cycle");
+
+    new_index[node_index] = order.size();
+    order.push_back(node_index);
+    parents.push_back(parent);
+
+    const auto &child_ids = nodes[node_index].child_ids;
+
+    // Reversed, so children keep their order once popped.
+    for (auto child = child_ids.rbegin(); child != child_ids.rend(); ++child) {
+      stack.emplace_back(*child, new_index[node_index]);
+    }
+  }
+
+  auto flat_nodes = ModelHandle::Nodes{};
+  flat_nodes.reserve(order.size());
+
+  for (const auto old_index : order) {
+    auto node = std::move(nodes[old_index]);
+
+    for (auto &child_id : node.child_ids) {
+      child_id = new_index[child_id];
+    }
+
+    flat_nodes.push_back(std::move(node));
+  }
+
+  // Meshes not reachable from the root are never drawn.
+  for (auto &mesh : model_handle.meshes) {
+    mesh.node_index = ModelHandle::NONE;
+  }
+
+  for (auto i = size_t{0}; i < flat_nodes.size(); ++i) {
+    for (const auto mesh_id : flat_nodes[i].mesh_ids) {
+      afk_assert(mesh_id < model_handle.meshes.size(), "Invalid mesh index");
+      model_handle.meshes[mesh_id].node_index = i;
+    }
+  }
+
+  for (auto &[name, animation] : model_handle.animations) {
+    auto animation_nodes = Afk::Animation::AnimationNodes{};
+
+    for (auto &[node_index, animation_node] : animation.animation_nodes) {
+      if (node_index < new_index.size() && new_index[node_index] != ModelHandle::NONE) {
+        animation_nodes.emplace(static_cast<unsigned int>(new_index[node_index]),
+                                std::move(animation_node));
+      }
+    }
+
+    animation.animation_nodes = std::move(animation_nodes);
+  }
+
+  auto node_bones = ModelHandle::Indices(flat_nodes.size(), ModelHandle::NONE);
+
+  for (auto i = size_t{0}; i < flat_nodes.size(); ++i) {
+    const auto bone = model_handle.bone_map.find(flat_nodes[i].name);
+
+    if (bone != model_handle.bone_map.end()) {
+      afk_assert(bone->second < model_handle.bones.size(), "Invalid bone index");
+      node_bones[i] = bone->second;
+    }
+  }
+
+  // Every node starts at its bind transform, which physics colliders cooked
+  // from the model are placed by too.
+  auto &local_transforms = model_handle.local_transforms;
+  local_transforms.translations.clear();
+  local_transforms.rotations.clear();
+  local_transforms.scales.clear();
+
+  for (const auto &node : flat_nodes) {
+    local_transforms.translations.push_back(node.transform.translation);
+    local_transforms.rotations.push_back(node.transform.rotation);
+    local_transforms.scales.push_back(node.transform.scale);
+  }
+
+  model_handle.root_node_index = 0;
+  model_handle.nodes           = std::move(flat_nodes);
+  model_handle.node_parents    = std::move(parents);
+  model_handle.node_bones      = std::move(node_bones);
+}
+
 static auto resize_window_callback([[maybe_unused]] GLFWwindow *window,
                                    int width, int height) -> void {
   auto &afk = Engine::get();
   afk.renderer.set_viewport(0, 0, width, height);
 }
 
-Renderer::Renderer()
-  : models(0, PathHash{}, PathEquals{}), textures(0, PathHash{}, PathEquals{}),
-    shaders(0, PathHash{}, PathEquals{}),
-    shader_programs(0, PathHash{}, PathEquals{}) {}
+Renderer::Renderer() = default;
 
 Renderer::~Renderer() {
   glfwDestroyWindow(this->window);
@@ -117,6 +311,10 @@ auto Renderer::initialize() -> void {
              "Failed to initialize GLAD");
   glfwSetFramebufferSizeCallback(this->window, resize_window_callback);
 
+  // Cooked textures are only block compressed when the driver can sample them.
+  this->texture_decoder.set_compression_enabled(
+      this->has_extension("GL_EXT_texture_compression_s3tc"));
+
   this->is_initialized = true;
 }
 
@@ -128,6 +326,22 @@ auto Renderer::set_option(GLenum option, bool state) const -> void {
   }
 }
 
+auto Renderer::has_extension(const string &name) const -> bool {
+  auto num_extensions = GLint{0};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+
+  for (auto i = GLint{0}; i < num_extensions; ++i) {
+    const auto *extension =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+
+    if (extension != nullptr && name == extension) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 auto Renderer::get_window_size() const -> ivec2 {
   auto width  = 0;
   auto height = 0;
@@ -160,44 +374,182 @@ auto Renderer::swap_buffers() -> void {
   glfwSwapBuffers(this->window);
 }
 
+auto Renderer::get_model(AssetId id) -> ModelHandle & {
+  const auto is_loaded = this->models.contains(id);
+  auto *pending        = this->pending_models.find(id);
+
+  if (!is_loaded && pending != nullptr) {
+    // The model is already streaming in, so finish it now regardless of budget.
+    if (pending->state == LoadState::Decoding) {
+      pending->future.wait();
+    }
+
+    this->upload_pending_model(*pending, std::numeric_limits<size_t>::max());
+    this->make_resident(id, std::move(pending->handle));
+    this->pending_models.erase(id);
+  } else if (!is_loaded) {
+    this->load_model(Model{AssetRegistry::get().get_path(id)});
+  }
+
+  this->resources.touch(Pool::Model, id);
+
+  return this->models.at(id);
+}
+
 auto Renderer::get_model(const path &file_path) -> ModelHandle & {
-  const auto is_loaded = this->models.count(file_path) == 1;
+  return this->get_model(AssetRegistry::get().intern(file_path));
+}
 
-  if (!is_loaded) {
-    this->models[file_path] = this->load_model(Model{file_path});
+auto Renderer::get_texture(AssetId id) -> const TextureHandle & {
+  if (!this->textures.contains(id)) {
+    this->load_texture(Texture{AssetRegistry::get().get_path(id)});
   }
 
-  return this->models.at(file_path);
+  this->resources.touch(Pool::Texture, id);
+
+  return this->textures.at(id);
 }
 
 auto Renderer::get_texture(const path &file_path) -> const TextureHandle & {
-  const auto is_loaded = this->textures.count(file_path) == 1;
+  return this->get_texture(AssetRegistry::get().intern(file_path));
+}
+
+auto Renderer::get_shader(AssetId id) -> const ShaderHandle & {
+  if (!this->shaders.contains(id)) {
+    this->compile_shader(Shader{AssetRegistry::get().get_path(id)});
+  }
+
+  return this->shaders.at(id);
+}
 
-  if (!is_loaded) {
-    this->textures[file_path] = this->load_texture(Texture{file_path});
+auto Renderer::get_shader_program(AssetId id) -> const ShaderProgramHandle & {
+  if (!this->shader_programs.contains(id)) {
+    this->link_shaders(ShaderProgram{AssetRegistry::get().get_path(id)});
   }
 
-  return this->textures.at(file_path);
+  this->resources.touch(Pool::ShaderProgram, id);
+
+  return this->shader_programs.at(id);
 }
 
-auto Renderer::get_shader(const path &file_path) -> const ShaderHandle & {
-  const auto is_loaded = this->shaders.count(file_path) == 1;
+auto Renderer::request_model(AssetId id) -> ModelHandle & {
+  auto *model = this->models.find(id);
+
+  if (model != nullptr) {
+    this->resources.touch(Pool::Model, id);
 
-  if (!is_loaded) {
-    this->shaders[file_path] = this->compile_shader(Shader{file_path});
+    return *model;
   }
 
-  return this->shaders.at(file_path);
+  if (!this->pending_models.contains(id)) {
+    auto pending             = PendingModel{};
+    pending.mesh_data_policy = this->get_mesh_data_policy(id);
+    pending.future           = this->loader_threads.enqueue(
+        [this, id]() { return this->decode_model(id); });
+    this->pending_models.insert(id, std::move(pending));
+  }
+
+  return this->placeholder_model;
+}
+
+auto Renderer::get_load_state(AssetId id) const -> LoadState {
+  if (this->models.contains(id)) {
+    return LoadState::Resident;
+  }
+
+  const auto *pending = this->pending_models.find(id);
+
+  return pending != nullptr ? pending->state : LoadState::Unloaded;
 }
 
-auto Renderer::get_shader_program(const path &file_path) -> const ShaderProgramHandle & {
-  const auto is_loaded = this->shader_programs.count(file_path) == 1;
+auto Renderer::acquire_model(AssetId id, MeshDataPolicy policy) -> ResourceManager::Reference {
+  auto reference = this->resources.acquire(Pool::Model, id);
+
+  // Once anyone's asked to keep a model's mesh data, it's always kept.
+  if (policy == MeshDataPolicy::Release) {
+    return reference;
+  }
+
+  this->set_mesh_data_policy(id, policy);
 
-  if (!is_loaded) {
-    this->shader_programs[file_path] = this->link_shaders(ShaderProgram{file_path});
+  if (auto *pending = this->pending_models.find(id); pending != nullptr) {
+    pending->mesh_data_policy = policy;
   }
 
-  return this->shader_programs.at(file_path);
+  const auto *model = this->models.find(id);
+
+  if (model == nullptr || model->mesh_data != nullptr) {
+    return reference;
+  }
+
+  // Already uploaded without it, so it's loaded again from disk, which
+  // generated models can't be.
+  const auto *entry = this->resources.get_entries(Pool::Model).find(id);
+
+  afk_assert(entry == nullptr || !entry->is_pinned,
+             "Mesh data for '"s + AssetRegistry::get().get_path(id).string() +
+                 "' was requested after it was freed"s);
+
+  this->unload_model(id);
+  this->get_model(id);
+
+  return reference;
+}
+
+auto Renderer::pin_model(AssetId id) -> void {
+  this->pinned_models.insert(id);
+  this->resources.set_pinned(Pool::Model, id, true);
+}
+
+auto Renderer::evict_resources() -> void {
+  // Models go first, since unloading them is what frees up their textures.
+  this->evict(Pool::Model, false);
+  this->evict(Pool::Texture, false);
+}
+
+auto Renderer::evict_unused() -> void {
+  this->evict(Pool::Model, true);
+  this->evict(Pool::Texture, true);
+}
+
+auto Renderer::evict(Pool pool, bool is_forced) -> void {
+  for (const auto id : this->resources.get_eviction_candidates(pool)) {
+    if (!is_forced && !this->resources.is_over_budget(pool)) {
+      break;
+    }
+
+    if (pool == Pool::Model) {
+      this->unload_model(id);
+    } else if (pool == Pool::Texture) {
+      this->unload_texture(id);
+    }
+  }
+}
+
+auto Renderer::unload_model(AssetId id) -> void {
+  auto &model = this->models.at(id);
+
+  for (auto &mesh : model.meshes) {
+    glDeleteVertexArrays(1, &mesh.vao);
+    glDeleteBuffers(1, &mesh.vbo);
+    glDeleteBuffers(1, &mesh.ibo);
+  }
+
+  for (const auto texture_id : model.texture_ids) {
+    this->resources.release(Pool::Texture, texture_id);
+  }
+
+  Io::log << "Model '" << AssetRegistry::get().get_path(id).string() << "' unloaded.\n";
+  this->models.erase(id);
+  this->resources.untrack(Pool::Model, id);
+}
+
+auto Renderer::unload_texture(AssetId id) -> void {
+  glDeleteTextures(1, &this->textures.at(id).id);
+
+  Io::log << "Texture '" << AssetRegistry::get().get_path(id).string() << "' unloaded.\n";
+  this->textures.erase(id);
+  this->resources.untrack(Pool::Texture, id);
 }
 
 auto Renderer::set_texture_unit(size_t unit) const -> void {
@@ -210,130 +562,174 @@ auto Renderer::bind_texture(const TextureHandle &texture) const -> void {
   glBindTexture(GL_TEXTURE_2D, texture.id);
 }
 
-auto Renderer::draw() -> void {
-  while (!this->draw_queue.empty()) {
-    const auto command  = this->draw_queue.front();
-    auto &model         = this->get_model(command.model_path);
-    const auto &program = this->get_shader_program(command.shader_program_path);
+auto Renderer::draw(const FramePacket &packet) -> void {
+  this->resources.next_frame();
+  this->evict_resources();
+  this->upload_pending_models();
+
+  this->view        = packet.view;
+  this->projection  = packet.projection;
+  this->drawn_frame = packet.frame;
+
+  for (const auto &command : packet.draws) {
+    // A pinned model can be unloaded after the packet was taken, and
+    // requesting it would look for it on disk.
+    if (this->pinned_models.count(command.model_id) > 0 &&
+        !this->models.contains(command.model_id)) {
+      continue;
+    }
 
-    this->draw_queue.pop();
-    this->draw_model(model, program, command.transform, command.current_animation);
+    auto &model         = this->request_model(command.model_id);
+    const auto &program = this->get_shader_program(command.shader_program_id);
+
+    this->draw_model(model, program, command.model_matrix, command.current_animation,
+                     command.patches);
   }
 }
 
-auto Renderer::queue_draw(const DrawCommand &command) -> void {
-  this->draw_queue.push(command);
+auto Renderer::get_drawn_frame() const -> size_t {
+  return this->drawn_frame;
 }
 
 auto Renderer::setup_view(const ShaderProgramHandle &shader_program) const -> void {
-  const auto &afk        = Engine::get();
-  const auto window_size = this->get_window_size();
-  const auto projection =
-      afk.camera.get_projection_matrix(window_size.x, window_size.y);
-  const auto view = afk.camera.get_view_matrix();
-
-  this->set_uniform(shader_program, "u_matrices.projection", projection);
-  this->set_uniform(shader_program, "u_matrices.view", view);
+  this->set_uniform(shader_program, "u_matrices.projection", this->projection);
+  this->set_uniform(shader_program, "u_matrices.view", this->view);
 }
 
 auto Renderer::draw_model(ModelHandle &model, const ShaderProgramHandle &shader_program,
-                          Transform transform,
-                          const AnimationFrame &animation_frame) -> void {
+                          const mat4 &model_matrix, const AnimationFrame &animation_frame,
+                          const Patches &patches) -> void {
+  // Placeholders have nothing to draw until their model is resident.
+  if (model.nodes.empty()) {
+    return;
+  }
+
   glPolygonMode(GL_FRONT_AND_BACK, this->wireframe_enabled ? GL_LINE : GL_FILL);
   this->use_shader(shader_program);
   this->setup_view(shader_program);
 
-  auto parent_transform = mat4{1.0f};
-  // Apply parent tranformation.
-  parent_transform = glm::translate(parent_transform, transform.translation);
-  parent_transform *= glm::mat4_cast(transform.rotation);
-  parent_transform = glm::scale(parent_transform, transform.scale);
+  this->compute_world_matrices(model, model_matrix);
+
+  if (this->update_bones(model, animation_frame)) {
+    this->set_uniform(shader_program, "u_bone_transforms", model.bones);
+  }
+
+  if (patches.empty()) {
+    for (const auto &mesh : model.meshes) {
+      this->draw_mesh(mesh, shader_program);
+    }
+  } else {
+    for (const auto &patch : patches) {
+      this->set_uniform(shader_program, "u_patch.origin", patch.origin);
+      this->set_uniform(shader_program, "u_patch.spacing", patch.spacing);
+      this->set_uniform(shader_program, "u_patch.skirt_depth", patch.skirt_depth);
 
-  this->draw_model_node(model, model.root_node_index, parent_transform,
-                        animation_frame, shader_program);
+      for (const auto &mesh : model.meshes) {
+        this->draw_mesh(mesh, shader_program);
+      }
+    }
+  }
 }
 
-auto Renderer::draw_model_node(ModelHandle &model, size_t node_index,
-                               const glm::mat4 &parent_transform,
-                               const AnimationFrame &animation_frame,
-                               const ShaderProgramHandle &shader_program) const -> void {
-  afk_assert(node_index < model.nodes.size(), "Invalid node index");
-  const auto &node = model.nodes[node_index];
+auto Renderer::draw_mesh(const MeshHandle &mesh, const ShaderProgramHandle &shader_program)
+    -> void {
+  if (mesh.node_index == ModelHandle::NONE) {
+    return;
+  }
 
-  // Get local transformation.
-  auto local_transform = glm::mat4(1.0f);
-//  local_transform = glm::translate(local_transform, node.transform.translation);
-//  local_transform *= glm::mat4_cast(node.transform.rotation);
-//  local_transform = glm::scale(local_transform, node.transform.scale);
+  auto material_bound = std::array<bool, static_cast<size_t>(Texture::Type::Count)>{};
+  // Bind all of the textures to shader uniforms.
+  for (auto i = size_t{0}; i < mesh.textures.size(); ++i) {
+    this->set_texture_unit(GL_TEXTURE0 + i);
 
-  // if animation exists
-  if (model.animations.count(animation_frame.name) > 0 &&
-      model.animations.at(animation_frame.name).animation_nodes.count(static_cast<unsigned int>(node_index))) {
-    const auto &animation = model.animations.at(animation_frame.name);
-    const auto &animation_node =
-        animation.animation_nodes.at(static_cast<unsigned int>(node_index));
+    auto name = material_strings.at(mesh.textures[i].type);
 
-    const auto position =
-        Renderer::get_animation_position(animation_frame.time, animation_node,
-                                         animation.ticks_per_second, animation.duration);
-    const auto rotation =
-        Renderer::get_animation_rotation(animation_frame.time, animation_node,
-                                         animation.ticks_per_second, animation.duration);
-    const auto scale =
-        Renderer::get_animation_scale(animation_frame.time, animation_node,
-                                      animation.ticks_per_second, animation.duration);
+    const auto index = static_cast<size_t>(mesh.textures[i].type);
 
-    // calc animation transform
-    auto bone_transform = glm::mat4(1.0f);
-    bone_transform      = glm::translate(bone_transform, position);
-    bone_transform *= glm::mat4_cast(rotation);
-    bone_transform = glm::scale(bone_transform, scale);
+    afk_assert_debug(!material_bound[index], "Material "s + name + " already bound"s);
+    material_bound[index] = true;
 
-    // apply transform to bone if it exists
-    if (model.bone_map.count(node.name) > 0) {
-      const auto bone_index = model.bone_map.at(node.name);
-      afk_assert(bone_index < model.bones.size(), "Invalid bone index");
-      model.bones[bone_index].final_transform = bone_transform;
+    this->set_uniform(shader_program, "u_textures."s + name, static_cast<int>(i));
+    this->bind_texture(mesh.textures[i]);
 
-      // TODO only set one bone instead of all at once
-      this->set_uniform(shader_program, "u_bone_transforms", model.bones);
+    if (mesh.textures[i].type == Texture::Type::Height) {
+      this->set_uniform(shader_program, "u_height_map.scale", mesh.textures[i].height_scale);
+      this->set_uniform(shader_program, "u_height_map.offset", mesh.textures[i].height_offset);
     }
   }
 
-  glm::mat4 global_transform = parent_transform * local_transform;
+  this->set_uniform(shader_program, "u_matrices.model", this->world_matrices[mesh.node_index]);
 
-  for (const auto &mesh_id : node.mesh_ids) {
-    const auto mesh = model.meshes[mesh_id];
+  // Draw the mesh.
+  glBindVertexArray(mesh.vao);
+  glDrawElements(GL_TRIANGLES, mesh.num_indices, MeshHandle::INDEX, nullptr);
+  glBindVertexArray(0);
 
-    auto material_bound = vector<bool>(static_cast<size_t>(Texture::Type::Count));
-    // Bind all of the textures to shader uniforms.
-    for (auto i = size_t{0}; i < mesh.textures.size(); ++i) {
-      this->set_texture_unit(GL_TEXTURE0 + i);
+  this->set_texture_unit(GL_TEXTURE0);
+}
 
-      auto name = material_strings.at(mesh.textures[i].type);
+auto Renderer::compute_world_matrices(const ModelHandle &model, const mat4 &model_matrix)
+    -> void {
+  const auto &local     = model.local_transforms;
+  const auto node_count = model.nodes.size();
 
-      const auto index = static_cast<size_t>(mesh.textures[i].type);
+  this->world_matrices.resize(node_count);
 
-      afk_assert_debug(!material_bound[index], "Material "s + name + " already bound"s);
-      material_bound[index] = true;
+  // Parents come before their children, so one pass in order is enough.
+  for (auto i = size_t{0}; i < node_count; ++i) {
+    auto local_matrix = glm::translate(mat4{1.0f}, local.translations[i]);
+    local_matrix *= glm::mat4_cast(local.rotations[i]);
+    local_matrix = glm::scale(local_matrix, local.scales[i]);
 
-      this->set_uniform(shader_program, "u_textures."s + name, static_cast<int>(i));
-      this->bind_texture(mesh.textures[i]);
-    }
+    const auto parent = model.node_parents[i];
+    const auto &parent_matrix =
+        parent == ModelHandle::NONE ? model_matrix : this->world_matrices[parent];
 
-    this->set_uniform(shader_program, "u_matrices.model", global_transform);
+    this->world_matrices[i] = parent_matrix * local_matrix;
+  }
+}
 
-    // Draw the mesh.
-    glBindVertexArray(mesh.vao);
-    glDrawElements(GL_TRIANGLES, mesh.num_indices, MeshHandle::INDEX, nullptr);
-    glBindVertexArray(0);
+auto Renderer::update_bones(ModelHandle &model, const AnimationFrame &animation_frame) const
+    -> bool {
+  const auto animation_entry = model.animations.find(animation_frame.name);
 
-    this->set_texture_unit(GL_TEXTURE0);
+  if (animation_entry == model.animations.end()) {
+    return false;
   }
 
-  for (const auto child_id : node.child_ids) {
-    this->draw_model_node(model, child_id, global_transform, animation_frame, shader_program);
+  const auto &animation = animation_entry->second;
+  auto is_updated       = false;
+
+  for (const auto &[node_index, animation_node] : animation.animation_nodes) {
+    afk_assert(node_index < model.node_bones.size(), "Invalid node index");
+    const auto bone_index = model.node_bones[node_index];
+
+    // Only nodes driving a bone affect the mesh.
+    if (bone_index == ModelHandle::NONE) {
+      continue;
+    }
+
+    const auto position =
+        Renderer::get_animation_position(animation_frame.time, animation_node,
+                                         animation.ticks_per_second, animation.duration);
+    const auto rotation =
+        Renderer::get_animation_rotation(animation_frame.time, animation_node,
+                                         animation.ticks_per_second, animation.duration);
+    const auto scale =
+        Renderer::get_animation_scale(animation_frame.time, animation_node,
+                                      animation.ticks_per_second, animation.duration);
+
+    // calc animation transform
+    auto bone_transform = glm::mat4(1.0f);
+    bone_transform      = glm::translate(bone_transform, position);
+    bone_transform *= glm::mat4_cast(rotation);
+    bone_transform = glm::scale(bone_transform, scale);
+
+    model.bones[bone_index].final_transform = bone_transform;
+    is_updated                              = true;
   }
+
+  return is_updated;
 }
 
 auto Renderer::use_shader(const ShaderProgramHandle &shader) const -> void {
@@ -349,8 +745,9 @@ auto Renderer::load_mesh(const Mesh &mesh) -> MeshHandle {
                  std::to_string(mesh.indices.size()) + " requested, max "s +
                  std::to_string(std::numeric_limits<Mesh::Index>::max()));
 
-  auto mesh_handle        = MeshHandle{};
-  mesh_handle.num_indices = mesh.indices.size();
+  auto mesh_handle         = MeshHandle{};
+  mesh_handle.num_indices  = mesh.indices.size();
+  mesh_handle.num_vertices = mesh.vertices.size();
 
   // Create new buffers.
   glGenVertexArrays(1, &mesh_handle.vao);
@@ -411,80 +808,355 @@ auto Renderer::load_mesh(const Mesh &mesh) -> MeshHandle {
   return mesh_handle;
 }
 
-auto Renderer::load_model(const Model &model) -> ModelHandle {
-  const auto is_loaded = this->models.count(model.file_path) == 1;
+auto Renderer::load_model(Model model) -> ModelHandle & {
+  const auto id        = AssetRegistry::get().intern(model.file_path);
+  const auto is_loaded = this->models.contains(id);
 
   afk_assert(!is_loaded, "Model with path '"s + model.file_path.string() + "' already loaded"s);
 
   auto model_handle = ModelHandle{};
 
   model_handle.root_node_index = model.root_node_index;
-  model_handle.nodes           = model.nodes;
-  model_handle.animations      = model.animations;
-  model_handle.bones           = model.bones;
-  model_handle.bone_map        = model.bone_map;
+  model_handle.nodes           = std::move(model.nodes);
+  model_handle.animations      = std::move(model.animations);
+  model_handle.bones           = std::move(model.bones);
+  model_handle.bone_map        = std::move(model.bone_map);
   model_handle.global_inverse  = model.global_inverse;
+  model_handle.texture_ids     = get_texture_ids(model);
 
+  this->retain_textures(model_handle);
   this->load_meshes(model, model_handle);
+  flatten_nodes(model_handle);
+  this->finish_mesh_data(model.meshes, model_handle, this->get_mesh_data_policy(id));
 
-  this->models[model.file_path] = std::move(model_handle);
-
-  return this->models[model.file_path];
+  return this->make_resident(id, std::move(model_handle));
 }
 
-auto Renderer::load_meshes(const Model &model, ModelHandle &model_handle) -> void {
-  model_handle.meshes.reserve(model.meshes.size());
-  for (unsigned int i = 0; i < model.meshes.size(); i++) {
-    auto mesh_handle = this->load_mesh(model.meshes[i]);
+auto Renderer::load_meshes(Model &model, ModelHandle &model_handle) -> void {
+  // Fan the texture decodes out across the decoder threads before uploading any.
+  auto &assets      = AssetRegistry::get();
+  auto images       = DecodedModel::Images{};
+  auto seen         = unordered_set<AssetId>{};
+  const auto policy = this->get_mesh_data_policy(assets.intern(model.file_path));
 
-    for (const auto &texture : model.meshes[i].textures) {
-      const auto &texture_handle = this->get_texture(texture.file_path);
-      auto &loaded_handle        = this->textures[texture.file_path];
+  for (const auto &mesh : model.meshes) {
+    for (const auto &texture : mesh.textures) {
+      const auto id = assets.intern(texture.file_path);
 
-      // FIXME: There's definitely a more elegant way to do this.
-      if (loaded_handle.type != texture.type) {
-        loaded_handle.type = texture.type;
+      if (!this->textures.contains(id) && seen.insert(id).second) {
+        images.emplace_back(texture, this->texture_decoder.decode(texture));
       }
-
-      mesh_handle.textures.push_back(std::move(texture_handle));
     }
+  }
+
+  for (auto &[texture, image] : images) {
+    this->upload_texture(texture, image.get());
+    // Drop the decoded pixels as soon as they're on the GPU.
+    image = {};
+  }
+
+  model_handle.meshes.reserve(model.meshes.size());
+  for (auto &mesh : model.meshes) {
+    auto mesh_handle = this->load_mesh(mesh);
+    this->attach_textures(mesh, mesh_handle);
     model_handle.meshes.push_back(std::move(mesh_handle));
+
+    if (policy == MeshDataPolicy::Release) {
+      release_mesh_arrays(mesh);
+    }
   }
 }
 
+auto Renderer::attach_textures(const Mesh &mesh, MeshHandle &mesh_handle) -> void {
+  for (const auto &texture : mesh.textures) {
+    const auto id              = AssetRegistry::get().intern(texture.file_path);
+    const auto &texture_handle = this->get_texture(id);
+    auto &loaded_handle        = this->textures.at(id);
+
+    // FIXME: There's definitely a more elegant way to do this.
+    if (loaded_handle.type != texture.type) {
+      loaded_handle.type = texture.type;
+    }
+
+    mesh_handle.textures.push_back(std::move(texture_handle));
+  }
+}
+
+auto Renderer::upload_pending_models() -> void {
+  auto uploaded = size_t{0};
+
+  auto resident = vector<AssetId>{};
+
+  for (auto [id, pending] : this->pending_models) {
+    if (uploaded < this->upload_budget) {
+      uploaded += this->upload_pending_model(pending, this->upload_budget - uploaded);
+    }
+
+    if (pending.state == LoadState::Resident) {
+      this->make_resident(id, std::move(pending.handle));
+      resident.push_back(id);
+    }
+  }
+
+  for (const auto id : resident) {
+    this->pending_models.erase(id);
+  }
+}
+
+auto Renderer::upload_pending_model(PendingModel &pending, size_t budget) -> size_t {
+  if (pending.state == LoadState::Decoding) {
+    if (pending.future.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+      return 0;
+    }
+
+    // Rethrows any assertion raised on the loader thread.
+    pending.decoded              = pending.future.get();
+    pending.handle.texture_ids   = get_texture_ids(pending.decoded.model);
+    pending.state                = LoadState::Uploading;
+
+    // Hold on to the textures before uploading them, so they can't be evicted
+    // while the rest of the model is still streaming in.
+    this->retain_textures(pending.handle);
+  }
+
+  auto uploaded = size_t{0};
+
+  // Always make some progress, even when a single upload exceeds the budget.
+  while (pending.state == LoadState::Uploading && uploaded < budget) {
+    uploaded += this->upload_next(pending);
+  }
+
+  return uploaded;
+}
+
+auto Renderer::upload_next(PendingModel &pending) -> size_t {
+  auto &decoded = pending.decoded;
+
+  if (pending.next_image < decoded.images.size()) {
+    auto &[texture, result] = decoded.images[pending.next_image];
+    ++pending.next_image;
+
+    // Another model may have already uploaded this texture.
+    if (this->textures.contains(AssetRegistry::get().intern(texture.file_path))) {
+      result = {};
+
+      return 0;
+    }
+
+    this->upload_texture(texture, result.get());
+    const auto size = result.get().get_size();
+    // Drop the decoded pixels as soon as they're on the GPU.
+    result = {};
+
+    return size;
+  }
+
+  if (pending.next_mesh < decoded.model.meshes.size()) {
+    auto &mesh = decoded.model.meshes[pending.next_mesh];
+    ++pending.next_mesh;
+
+    auto mesh_handle = this->load_mesh(mesh);
+    this->attach_textures(mesh, mesh_handle);
+    pending.handle.meshes.push_back(std::move(mesh_handle));
+
+    // The arrays are only let go once the whole model's resident, since the
+    // policy can still change to keep them until then.
+    return mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(Mesh::Index);
+  }
+
+  pending.handle.root_node_index = decoded.model.root_node_index;
+  pending.handle.nodes           = std::move(decoded.model.nodes);
+  pending.handle.animations      = std::move(decoded.model.animations);
+  pending.handle.bones           = std::move(decoded.model.bones);
+  pending.handle.bone_map        = std::move(decoded.model.bone_map);
+  pending.handle.global_inverse  = decoded.model.global_inverse;
+  pending.state                  = LoadState::Resident;
+
+  flatten_nodes(pending.handle);
+  this->finish_mesh_data(decoded.model.meshes, pending.handle, pending.mesh_data_policy);
+  decoded = DecodedModel{};
+
+  return 0;
+}
+
+auto Renderer::make_resident(AssetId id, ModelHandle model_handle) -> ModelHandle & {
+  auto usage = ResourceManager::Usage{};
+
+  for (const auto &mesh : model_handle.meshes) {
+    usage.gpu_bytes +=
+        mesh.num_vertices * sizeof(Vertex) + mesh.num_indices * sizeof(Mesh::Index);
+  }
+
+  usage.cpu_bytes = get_cpu_size(model_handle);
+
+  this->resources.track(Pool::Model, id, usage);
+
+  return this->models.insert(id, std::move(model_handle));
+}
+
+auto Renderer::finish_mesh_data(Model::Meshes &meshes, ModelHandle &model_handle,
+                                MeshDataPolicy policy) -> void {
+  // Hand the arrays over rather than copying them, they're immutable from here on.
+  if (policy == MeshDataPolicy::Keep) {
+    model_handle.mesh_data = std::make_shared<const Model::Meshes>(std::move(meshes));
+  }
+}
+
+auto Renderer::retain_textures(const ModelHandle &model_handle) -> void {
+  // Textures stay resident for as long as any model sampling them is.
+  for (const auto texture_id : model_handle.texture_ids) {
+    this->resources.retain(Pool::Texture, texture_id);
+  }
+}
+
+auto Renderer::decode_model(AssetId id) -> DecodedModel {
+  auto &assets  = AssetRegistry::get();
+  auto decoded  = DecodedModel{};
+  decoded.model = Model{assets.get_path(id)};
+
+  auto seen = unordered_set<AssetId>{};
+
+  for (const auto &mesh : decoded.model.meshes) {
+    for (const auto &texture : mesh.textures) {
+      if (seen.insert(assets.intern(texture.file_path)).second) {
+        decoded.images.emplace_back(texture, this->texture_decoder.decode(texture));
+      }
+    }
+  }
+
+  // Don't report the model as decoded until all of its textures are.
+  for (const auto &[texture, result] : decoded.images) {
+    result.wait();
+  }
+
+  return decoded;
+}
+
 auto Renderer::load_texture(const Texture &texture) -> TextureHandle {
-  const auto is_loaded = this->textures.count(texture.file_path) == 1;
-  const auto abs_path  = Afk::get_absolute_path(texture.file_path);
+  return this->upload_texture(texture, this->texture_decoder.decode(texture).get());
+}
 
-  afk_assert(!is_loaded, "Texture with path '"s + texture.file_path.string() + "' already loaded"s);
-  afk_assert(std::filesystem::exists(abs_path),
-             "Texture "s + texture.file_path.string() + " doesn't exist"s);
+auto Renderer::load_height_map(const path &file_path, const HeightMap &height_map)
+    -> const TextureHandle & {
+  const auto id        = AssetRegistry::get().intern(file_path);
+  const auto is_loaded = this->textures.contains(id);
+
+  afk_assert(!is_loaded, "Texture with path '"s + file_path.string() + "' already loaded"s);
+  afk_assert(!height_map.heights.empty(), "Height map '"s + file_path.string() + "' is empty"s);
+
+  // Samples already fit in 16 bits, and read back as sample / MAX_SAMPLE.
+  auto samples = vector<std::int16_t>(height_map.heights.size());
+
+  for (auto i = size_t{0}; i < samples.size(); ++i) {
+    samples[i] = static_cast<std::int16_t>(height_map.heights[i]);
+  }
+
+  auto texture_handle          = TextureHandle{};
+  texture_handle.type          = Texture::Type::Height;
+  texture_handle.width         = height_map.width;
+  texture_handle.height        = height_map.get_length();
+  texture_handle.channels      = 1;
+  texture_handle.height_scale  = height_map.scale * static_cast<float>(HeightMap::MAX_SAMPLE);
+  texture_handle.height_offset = height_map.offset;
+
+  glGenTextures(1, &texture_handle.id);
+  afk_assert(texture_handle.id > 0, "Texture creation failed");
+  glBindTexture(GL_TEXTURE_2D, texture_handle.id);
+
+  // Rows of shorts aren't necessarily four byte aligned.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R16_SNORM, texture_handle.width, texture_handle.height, 0,
+               GL_RED, GL_SHORT, samples.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  // Heights are fetched texel by texel, never filtered.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  Io::log << "Height map '" << file_path.string() << "' loaded with ID " << texture_handle.id
+          << ".\n";
+  this->resources.track(Pool::Texture, id, {samples.size() * sizeof(std::int16_t), 0});
+  this->resources.set_pinned(Pool::Texture, id, true);
+
+  return this->textures.insert(id, std::move(texture_handle));
+}
+
+auto Renderer::update_height_map(const path &file_path, const HeightMap &height_map,
+                                 const HeightMap::Region &region) -> void {
+  const auto id        = AssetRegistry::get().intern(file_path);
+  auto *texture_handle = this->textures.find(id);
 
-  auto width    = 0;
-  auto height   = 0;
-  auto channels = 0;
-  auto image    = shared_ptr<unsigned char>{
-      stbi_load(abs_path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha),
-      stbi_image_free};
+  afk_assert(texture_handle != nullptr, "Height map '"s + file_path.string() + "' not loaded"s);
+  afk_assert(texture_handle->width == height_map.width &&
+                 texture_handle->height == height_map.get_length(),
+             "Height map '"s + file_path.string() + "' changed size"s);
 
-  afk_assert(image != nullptr,
-             "Failed to load image: '"s + texture.file_path.string() + "'"s);
+  if (region.width <= 0 || region.length <= 0) {
+    return;
+  }
+
+  // Only the region's rows are converted, and only it is sent to the GPU.
+  auto samples = vector<std::int16_t>(static_cast<size_t>(region.width * region.length));
+
+  for (auto y = 0; y < region.length; ++y) {
+    for (auto x = 0; x < region.width; ++x) {
+      const auto from = static_cast<size_t>((region.y + y) * height_map.width + region.x + x);
+
+      samples[static_cast<size_t>(y * region.width + x)] =
+          static_cast<std::int16_t>(height_map.heights[from]);
+    }
+  }
+
+  texture_handle->height_scale  = height_map.scale * static_cast<float>(HeightMap::MAX_SAMPLE);
+  texture_handle->height_offset = height_map.offset;
+
+  glBindTexture(GL_TEXTURE_2D, texture_handle->id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.length, GL_RED,
+                  GL_SHORT, samples.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+auto Renderer::upload_texture(const Texture &texture, const Image &image) -> TextureHandle {
+  const auto id        = AssetRegistry::get().intern(texture.file_path);
+  const auto is_loaded = this->textures.contains(id);
+
+  afk_assert(!is_loaded, "Texture with path '"s + texture.file_path.string() + "' already loaded"s);
+  afk_assert(!image.levels.empty(), "Texture '"s + texture.file_path.string() + "' has no pixels"s);
 
   auto texture_handle     = TextureHandle{};
   texture_handle.type     = texture.type;
-  texture_handle.width    = width;
-  texture_handle.height   = height;
-  texture_handle.channels = channels;
+  texture_handle.width    = image.width;
+  texture_handle.height   = image.height;
+  texture_handle.channels = image.channels;
 
-  // Send the texture to the GPU.
+  // Send the texture to the GPU. Every mip level was cooked ahead of time.
   glGenTextures(1, &texture_handle.id);
   afk_assert(texture_handle.id > 0, "Texture creation failed");
   glBindTexture(GL_TEXTURE_2D, texture_handle.id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, image.get());
-  glGenerateMipmap(GL_TEXTURE_2D);
+
+  const auto format = gl_image_formats.at(image.format);
+
+  for (auto i = size_t{0}; i < image.levels.size(); ++i) {
+    const auto &level = image.levels[i];
+    const auto index  = static_cast<GLint>(i);
+
+    if (image.format == Image::Format::Rgba8) {
+      glTexImage2D(GL_TEXTURE_2D, index, static_cast<GLint>(format), level.width,
+                   level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.pixels.data());
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, index, format, level.width, level.height, 0,
+                             static_cast<GLsizei>(level.pixels.size()), level.pixels.data());
+    }
+  }
 
   // Set texture parameters.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -492,13 +1164,14 @@ auto Renderer::load_texture(const Texture &texture) -> TextureHandle {
 
   Io::log << "Texture '" << texture.file_path.string() << "' loaded with ID "
           << texture_handle.id << ".\n";
-  this->textures[texture.file_path] = std::move(texture_handle);
+  this->resources.track(Pool::Texture, id, {image.get_size(), 0});
 
-  return this->textures[texture.file_path];
+  return this->textures.insert(id, std::move(texture_handle));
 }
 
 auto Renderer::compile_shader(const Shader &shader) -> ShaderHandle {
-  const auto is_loaded = this->shaders.count(shader.file_path) == 1;
+  const auto id        = AssetRegistry::get().intern(shader.file_path);
+  const auto is_loaded = this->shaders.contains(id);
 
   afk_assert(!is_loaded, "Shader with path '"s + shader.file_path.string() + "' already loaded"s);
 
@@ -530,13 +1203,16 @@ auto Renderer::compile_shader(const Shader &shader) -> ShaderHandle {
 
   Io::log << "Shader '" << shader.file_path.string() << "' compiled with ID "
           << shader_handle.id << ".\n";
-  this->shaders[shader.file_path] = std::move(shader_handle);
+  // Shaders can't be reloaded without relinking their programs, so stay put.
+  this->resources.track(Pool::Shader, id, {0, shader.code.size()});
+  this->resources.set_pinned(Pool::Shader, id, true);
 
-  return this->shaders[shader.file_path];
+  return this->shaders.insert(id, std::move(shader_handle));
 }
 
 auto Renderer::link_shaders(const ShaderProgram &shader_program) -> ShaderProgramHandle {
-  const auto is_loaded = this->shader_programs.count(shader_program.file_path) == 1;
+  const auto id        = AssetRegistry::get().intern(shader_program.file_path);
+  const auto is_loaded = this->shader_programs.contains(id);
 
   afk_assert(!is_loaded, "Shader program with path '"s +
                              shader_program.file_path.string() + "' already loaded"s);
@@ -547,7 +1223,7 @@ auto Renderer::link_shaders(const ShaderProgram &shader_program) -> ShaderProgra
   afk_assert(shader_program_handle.id > 0, "Shader program creation failed");
 
   for (const auto &shader_path : shader_program.shader_paths) {
-    const auto &shader_handle = this->get_shader(shader_path);
+    const auto &shader_handle = this->get_shader(AssetRegistry::get().intern(shader_path));
     glAttachShader(shader_program_handle.id, shader_handle.id);
   }
 
@@ -569,11 +1245,15 @@ auto Renderer::link_shaders(const ShaderProgram &shader_program) -> ShaderProgra
                           "' linking failed: "s + error_msg.data());
   }
 
+  auto binary_length = GLint{0};
+  glGetProgramiv(shader_program_handle.id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+
   Io::log << "Shader program '" << shader_program.file_path.string()
           << "' linked with ID " << shader_program_handle.id << ".\n";
-  this->shader_programs[shader_program.file_path] = std::move(shader_program_handle);
+  this->resources.track(Pool::ShaderProgram, id, {static_cast<size_t>(binary_length), 0});
+  this->resources.set_pinned(Pool::ShaderProgram, id, true);
 
-  return this->shader_programs[shader_program.file_path];
+  return this->shader_programs.insert(id, std::move(shader_program_handle));
 }
 
 auto Renderer::set_uniform(const ShaderProgramHandle &program,
@@ -595,6 +1275,12 @@ auto Renderer::set_uniform(const ShaderProgramHandle &program,
   glUniform1f(glGetUniformLocation(program.id, name.c_str()), static_cast<GLfloat>(value));
 }
 
+auto Renderer::set_uniform(const ShaderProgramHandle &program,
+                           const string &name, vec2 value) const -> void {
+  afk_assert_debug(program.id > 0, "Invalid shader program ID");
+  glUniform2fv(glGetUniformLocation(program.id, name.c_str()), 1, glm::value_ptr(value));
+}
+
 auto Renderer::set_uniform(const ShaderProgramHandle &program,
                            const string &name, vec3 value) const -> void {
   afk_assert_debug(program.id > 0, "Invalid shader program ID");
@@ -648,6 +1334,38 @@ auto Renderer::get_shader_programs() const -> const ShaderPrograms & {
   return this->shader_programs;
 }
 
+auto Renderer::get_pending_models() const -> const PendingModels & {
+  return this->pending_models;
+}
+
+auto Renderer::get_resources() const -> const ResourceManager & {
+  return this->resources;
+}
+
+auto Renderer::get_resources() -> ResourceManager & {
+  return this->resources;
+}
+
+auto Renderer::set_mesh_data_policy(AssetId id, MeshDataPolicy policy) -> void {
+  this->mesh_data_policies.insert(id, policy);
+}
+
+auto Renderer::get_mesh_data_policy(AssetId id) const -> MeshDataPolicy {
+  const auto *policy = this->mesh_data_policies.find(id);
+
+  return policy != nullptr ? *policy : MeshDataPolicy::Release;
+}
+
+auto Renderer::set_upload_budget(size_t bytes) -> void {
+  // Nothing would ever be uploaded with no budget.
+  afk_assert(bytes > 0, "Upload budget must be positive");
+  this->upload_budget = bytes;
+}
+
+auto Renderer::get_upload_budget() const -> size_t {
+  return this->upload_budget;
+}
+
 auto Renderer::get_animation_position(double time, const Animation::AnimationNode &animation_node,
                                       double ticks_per_second, double duration)
     -> glm::vec3 {
@@ -1,28 +1,40 @@
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <functional>
+#include <future>
 #include <memory>
-#include <queue>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <glad/glad.h>
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
 // Must be included after GLAD.
 #include <GLFW/glfw3.h>
 
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/asset/AssetTable.hpp"
 #include "afk/component/AnimationFrame.hpp"
+#include "afk/physics/shape/HeightMap.hpp"
+#include "afk/renderer/Image.hpp"
+#include "afk/renderer/Model.hpp"
+#include "afk/renderer/ResourceManager.hpp"
 #include "afk/renderer/Shader.hpp"
+#include "afk/renderer/TextureDecoder.hpp"
 #include "afk/renderer/opengl/MeshHandle.hpp"
 #include "afk/renderer/opengl/ModelHandle.hpp"
 #include "afk/renderer/opengl/ShaderHandle.hpp"
 #include "afk/renderer/opengl/ShaderProgramHandle.hpp"
 #include "afk/renderer/opengl/TextureHandle.hpp"
+#include "afk/thread/ThreadPool.hpp"
 
 namespace Afk {
+  struct FramePacket;
   struct Model;
   struct Mesh;
   struct Model;
@@ -37,36 +49,60 @@ namespace Afk {
       using ShaderHandle        = OpenGl::ShaderHandle;
       using ShaderProgramHandle = OpenGl::ShaderProgramHandle;
       using TextureHandle       = OpenGl::TextureHandle;
+      using AssetId             = Asset::AssetId;
 
-      struct PathHash {
-        auto operator()(const std::filesystem::path &p) const -> std::size_t {
-          return std::filesystem::hash_value(p);
-        }
+      // A square of a terrain grid, displaced by the model's height texture.
+      struct Patch {
+        // The height texture texel under the grid's first vertex.
+        glm::vec2 origin = {};
+        // Texels between neighbouring vertices.
+        float spacing = 1.0f;
+        // How far the grid's skirt hangs below its edges.
+        float skirt_depth = 0.0f;
       };
 
-      struct PathEquals {
-        auto operator()(const std::filesystem::path &lhs,
-                        const std::filesystem::path &rhs) const -> bool {
-          return lhs.lexically_normal() == rhs.lexically_normal();
-        }
-      };
+      using Patches = std::vector<Patch>;
 
       struct DrawCommand {
-        const std::filesystem::path model_path          = {};
-        const std::filesystem::path shader_program_path = {};
-        const Transform transform                       = {};
-        const AnimationFrame current_animation          = {};
+        const AssetId model_id                 = Asset::INVALID_ASSET_ID;
+        const AssetId shader_program_id        = Asset::INVALID_ASSET_ID;
+        const glm::mat4 model_matrix           = glm::mat4{1.0f};
+        const AnimationFrame current_animation = {};
+        // The model is drawn once per patch if any are given, e.g. visible terrain chunks.
+        const Patches patches = {};
       };
 
-      using Models =
-          std::unordered_map<std::filesystem::path, ModelHandle, PathHash, PathEquals>;
-      using Textures =
-          std::unordered_map<std::filesystem::path, TextureHandle, PathHash, PathEquals>;
-      using Shaders =
-          std::unordered_map<std::filesystem::path, ShaderHandle, PathHash, PathEquals>;
-      using ShaderPrograms =
-          std::unordered_map<std::filesystem::path, ShaderProgramHandle, PathHash, PathEquals>;
-      using DrawQueue = std::queue<DrawCommand>;
+      enum class LoadState { Unloaded, Decoding, Uploading, Resident };
+
+      // Whether a model's CPU vertex and index arrays outlive its GPU upload,
+      // e.g. for picking or building physics shapes.
+      enum class MeshDataPolicy { Release, Keep };
+
+      // CPU-side model data produced by a loader thread, ready for upload.
+      struct DecodedModel {
+        using Images = std::vector<std::pair<Texture, TextureDecoder::Result>>;
+
+        Model model   = {};
+        Images images = {};
+      };
+
+      // A model streaming in over several frames.
+      struct PendingModel {
+        LoadState state                  = LoadState::Decoding;
+        std::future<DecodedModel> future = {};
+        DecodedModel decoded             = {};
+        ModelHandle handle               = {};
+        std::size_t next_image           = 0;
+        std::size_t next_mesh            = 0;
+        MeshDataPolicy mesh_data_policy = MeshDataPolicy::Release;
+      };
+
+      using Models           = Asset::AssetTable<ModelHandle>;
+      using Textures         = Asset::AssetTable<TextureHandle>;
+      using Shaders          = Asset::AssetTable<ShaderHandle>;
+      using ShaderPrograms   = Asset::AssetTable<ShaderProgramHandle>;
+      using PendingModels    = Asset::AssetTable<PendingModel>;
+      using MeshDataPolicies = Asset::AssetTable<MeshDataPolicy>;
 
       using Window = std::add_pointer<GLFWwindow>::type;
 
@@ -82,20 +118,23 @@ namespace Afk {
       auto initialize() -> void;
       auto set_option(GLenum option, bool state) const -> void;
       auto check_errors() const -> void;
+      auto has_extension(const std::string &name) const -> bool;
       auto get_window_size() const -> glm::ivec2;
 
       // Draw commands
       auto clear_screen(glm::vec4 clear_color = {255.0f, 255.0f, 255.0f, 1.0f}) const -> void;
       auto swap_buffers() -> void;
       auto set_viewport(int x, int y, int width, int height) const -> void;
-      auto draw() -> void;
-      auto queue_draw(const DrawCommand& command) -> void;
-      auto draw_model(ModelHandle &model,
-                      const ShaderProgramHandle &shader_program, Transform transform,
-                      const AnimationFrame &animation_frame) -> void;
-      auto draw_model_node(ModelHandle &model, size_t node_index,
-                           const glm::mat4 &parent_transform, const AnimationFrame &animation_frame,
-                           const ShaderProgramHandle &shader_program) const -> void;
+      /**
+       * Draws a frame packet. Everything drawn comes from the packet, so it
+       * can be drawn while the frame after it is simulated.
+       */
+      auto draw(const FramePacket &packet) -> void;
+      // The frame of the packet drawn last. Packets from before it are never drawn again.
+      auto get_drawn_frame() const -> std::size_t;
+      auto draw_model(ModelHandle &model, const ShaderProgramHandle &shader_program,
+                      const glm::mat4 &model_matrix, const AnimationFrame &animation_frame,
+                      const Patches &patches = {}) -> void;
       auto setup_view(const ShaderProgramHandle &shader_program) const -> void;
 
       // State management
@@ -104,17 +143,50 @@ namespace Afk {
       auto bind_texture(const TextureHandle &texture) const -> void;
 
       // Resource management
+      auto get_model(AssetId id) -> ModelHandle &;
       auto get_model(const std::filesystem::path &file_path) -> ModelHandle &;
+      auto get_texture(AssetId id) -> const TextureHandle &;
       auto get_texture(const std::filesystem::path &file_path) -> const TextureHandle &;
-      auto get_shader(const std::filesystem::path &file_path) -> const ShaderHandle &;
-      auto get_shader_program(const std::filesystem::path &file_path)
-          -> const ShaderProgramHandle &;
+      auto get_shader(AssetId id) -> const ShaderHandle &;
+      auto get_shader_program(AssetId id) -> const ShaderProgramHandle &;
+      auto request_model(AssetId id) -> ModelHandle &;
+      auto get_load_state(AssetId id) const -> LoadState;
+      /**
+       * Keeps a model loaded for as long as the reference exists. Asking to
+       * keep its mesh data reloads it if it's already resident without it.
+       */
+      auto acquire_model(AssetId id, MeshDataPolicy policy = MeshDataPolicy::Release)
+          -> ResourceManager::Reference;
+      /**
+       * Keeps a generated model from being evicted, since there's nothing on
+       * disk to reload it from. Draws of it are skipped once it's unloaded.
+       */
+      auto pin_model(AssetId id) -> void;
+      auto evict_resources() -> void;
+      auto evict_unused() -> void;
+      auto unload_model(AssetId id) -> void;
+      auto unload_texture(AssetId id) -> void;
 
       // Resource loading
-      auto load_model(const Model &model) -> ModelHandle;
-      auto load_meshes(const Model &model,
-                           ModelHandle &model_handle) -> void;
+      auto load_model(Model model) -> ModelHandle &;
+      auto load_meshes(Model &model, ModelHandle &model_handle) -> void;
       auto load_texture(const Texture &texture) -> TextureHandle;
+      /**
+       * Uploads a height map as a 16-bit texture, for terrain grids to be
+       * displaced by. There's nothing on disk to reload it from, so it's
+       * pinned until unloaded.
+       */
+      auto load_height_map(const std::filesystem::path &file_path, const HeightMap &height_map)
+          -> const TextureHandle &;
+      /**
+       * Uploads a region of a loaded height map again, in place, along with
+       * its current scale and offset.
+       */
+      auto update_height_map(const std::filesystem::path &file_path, const HeightMap &height_map,
+                             const HeightMap::Region &region) -> void;
+      auto upload_texture(const Texture &texture, const Image &image) -> TextureHandle;
+      auto upload_pending_models() -> void;
+      auto decode_model(AssetId id) -> DecodedModel;
       auto load_mesh(const Mesh &meshData) -> MeshHandle;
       auto compile_shader(const Shader &shader) -> ShaderHandle;
       auto link_shaders(const ShaderProgram &shader_program) -> ShaderProgramHandle;
@@ -126,6 +198,8 @@ namespace Afk {
                        const std::string &name, int value) const -> void;
       auto set_uniform(const ShaderProgramHandle &program,
                        const std::string &name, float value) const -> void;
+      auto set_uniform(const ShaderProgramHandle &program,
+                       const std::string &name, glm::vec2 value) const -> void;
       auto set_uniform(const ShaderProgramHandle &program,
                        const std::string &name, glm::vec3 value) const -> void;
       auto set_uniform(const ShaderProgramHandle &program,
@@ -140,6 +214,14 @@ namespace Afk {
       auto get_textures() const -> const Textures &;
       auto get_shaders() const -> const Shaders &;
       auto get_shader_programs() const -> const ShaderPrograms &;
+      auto get_pending_models() const -> const PendingModels &;
+      auto get_resources() const -> const ResourceManager &;
+      auto get_resources() -> ResourceManager &;
+
+      auto set_mesh_data_policy(AssetId id, MeshDataPolicy policy) -> void;
+      auto get_mesh_data_policy(AssetId id) const -> MeshDataPolicy;
+      auto set_upload_budget(std::size_t bytes) -> void;
+      auto get_upload_budget() const -> std::size_t;
 
       // animations
       static auto get_animation_position(double time, const Animation::AnimationNode &animation_node, double ticks_per_second, double duration) -> glm::vec3;
@@ -150,6 +232,20 @@ namespace Afk {
       static auto find_animation_position(double time, const Animation::AnimationNode::ScaleKeys &keys, double ticks_per_second, double duration) -> unsigned int;
 
     private:
+      auto attach_textures(const Mesh &mesh, MeshHandle &mesh_handle) -> void;
+      auto upload_pending_model(PendingModel &pending, std::size_t budget) -> std::size_t;
+      auto upload_next(PendingModel &pending) -> std::size_t;
+      auto make_resident(AssetId id, ModelHandle model_handle) -> ModelHandle &;
+      auto retain_textures(const ModelHandle &model_handle) -> void;
+      auto finish_mesh_data(Model::Meshes &meshes, ModelHandle &model_handle,
+                            MeshDataPolicy policy) -> void;
+      auto evict(ResourceManager::Pool pool, bool is_forced) -> void;
+      auto draw_mesh(const MeshHandle &mesh, const ShaderProgramHandle &shader_program)
+          -> void;
+      auto compute_world_matrices(const ModelHandle &model, const glm::mat4 &model_matrix)
+          -> void;
+      auto update_bones(ModelHandle &model, const AnimationFrame &animation_frame) const -> bool;
+
       const int opengl_major_version = 4;
       const int opengl_minor_version = 1;
       const bool enable_vsync        = true;
@@ -161,7 +257,25 @@ namespace Afk {
       Textures textures              = {};
       Shaders shaders                = {};
       ShaderPrograms shader_programs = {};
-      DrawQueue draw_queue           = {};
+      PendingModels pending_models   = {};
+      // Drawn in place of models which aren't resident yet.
+      ModelHandle placeholder_model = {};
+      // Maximum bytes of vertex, index and texture data uploaded per frame.
+      std::size_t upload_budget           = 8 * 1024 * 1024;
+      ResourceManager resources           = {};
+      MeshDataPolicies mesh_data_policies = {};
+      // Models that were ever pinned, which are kept track of after they're
+      // unloaded, unlike their resource entries.
+      std::unordered_set<AssetId> pinned_models = {};
+      // The camera of the frame packet being drawn.
+      glm::mat4 view          = glm::mat4{1.0f};
+      glm::mat4 projection    = glm::mat4{1.0f};
+      std::size_t drawn_frame = 0;
+      // Scratch space for the world matrices of the model being drawn.
+      std::vector<glm::mat4> world_matrices = {};
+      TextureDecoder texture_decoder;
+      // Declared last so the loader threads are joined before anything they touch is destroyed.
+      ThreadPool loader_threads;
     };
   }
 }
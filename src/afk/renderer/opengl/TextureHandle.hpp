@@ -14,6 +14,9 @@ namespace Afk {
       int width    = {};
       int height   = {};
       int channels = 4;
+      // How a height texture's samples map to heights.
+      float height_scale  = 1.0f;
+      float height_offset = 0.0f;
     };
   }
 }
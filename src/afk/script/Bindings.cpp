@@ -12,11 +12,14 @@ extern "C" {
 #include "afk/component/BaseComponent.hpp"
 #include "afk/component/GameObject.hpp"
 #include "afk/component/ScriptsComponent.hpp"
+#include "afk/component/WorldTransform.hpp"
 #include "afk/io/ModelSource.hpp"
 #include "afk/physics/PhysicsBody.hpp"
+#include "afk/physics/PhysicsQuery.hpp"
 #include "afk/physics/Transform.hpp"
 #include "afk/renderer/Camera.hpp"
 #include "afk/script/Script.hpp"
+#include "afk/terrain/TerrainQuery.hpp"
 #include "afk/ui/Ui.hpp"
 
 // todo move to keyboard mgmt
@@ -47,6 +50,16 @@ struct GameObjectWrapped {
   }
 };
 
+static auto set_parent(GameObjectWrapped *child, GameObjectWrapped parent) -> void {
+  auto &afk = Afk::Engine::get();
+  afk.transform_system.set_parent(&afk.registry, child->e, parent.e);
+}
+
+static auto clear_parent(GameObjectWrapped *child) -> void {
+  auto &afk = Afk::Engine::get();
+  afk.transform_system.set_parent(&afk.registry, child->e, entt::null);
+}
+
 template<typename T>
 static auto get_parent(T *bc) -> ENTT_ID_TYPE {
   return static_cast<ENTT_ID_TYPE>(bc->owning_entity);
@@ -80,6 +93,147 @@ static auto gameobject_get_entity(Afk::Asset::Asset *e) -> GameObjectWrapped {
   return GameObjectWrapped{std::get<Afk::Asset::Asset::Object>(e->data).ent};
 }
 
+static auto get_terrain_query() -> const Afk::TerrainQuery & {
+  return Afk::Engine::get().terrain_manager.query;
+}
+
+static auto terrain_height(float x, float z) -> float {
+  return get_terrain_query().get_height({x, z});
+}
+
+static auto terrain_normal(float x, float z) -> glm::vec3 {
+  return get_terrain_query().get_normal({x, z});
+}
+
+// Reads an array of vector2s, kept between calls since scripts query in bulk.
+static auto get_terrain_points(luabridge::LuaRef points) -> const Afk::TerrainQuery::Points & {
+  static auto terrain_points = Afk::TerrainQuery::Points{};
+  terrain_points.clear();
+
+  for (auto i = 1; i <= points.length(); ++i) {
+    terrain_points.push_back(points[i].cast<glm::vec2>());
+  }
+
+  return terrain_points;
+}
+
+static auto terrain_heights(luabridge::LuaRef points, lua_State *lua) -> luabridge::LuaRef {
+  static auto heights = Afk::TerrainQuery::Heights{};
+  get_terrain_query().get_heights(get_terrain_points(points), heights);
+
+  auto result = luabridge::newTable(lua);
+
+  for (auto i = std::size_t{0}; i < heights.size(); ++i) {
+    result[i + 1] = heights[i];
+  }
+
+  return result;
+}
+
+static auto terrain_normals(luabridge::LuaRef points, lua_State *lua) -> luabridge::LuaRef {
+  static auto normals = Afk::TerrainQuery::Normals{};
+  get_terrain_query().get_normals(get_terrain_points(points), normals);
+
+  auto result = luabridge::newTable(lua);
+
+  for (auto i = std::size_t{0}; i < normals.size(); ++i) {
+    result[i + 1] = normals[i];
+  }
+
+  return result;
+}
+
+static auto terrain_raycast(glm::vec3 origin, glm::vec3 direction, float max_distance)
+    -> Afk::TerrainQuery::Hit {
+  return get_terrain_query().raycast(origin, direction, max_distance);
+}
+
+// Kept between calls like the terrain's points, emptied of the last call's
+// queries.
+static auto get_physics_query() -> Afk::PhysicsQuery & {
+  static auto batch = Afk::PhysicsQuery{};
+  batch.rays.clear();
+  batch.sweeps.clear();
+  batch.overlaps.clear();
+
+  return batch;
+}
+
+static auto get_physics_hits(const std::vector<Afk::PhysicsQuery::Hit> &hits, lua_State *lua)
+    -> luabridge::LuaRef {
+  auto result = luabridge::newTable(lua);
+
+  for (auto i = std::size_t{0}; i < hits.size(); ++i) {
+    result[i + 1] = hits[i];
+  }
+
+  return result;
+}
+
+// Takes an array of {origin, direction, distance} tables.
+static auto physics_raycast(luabridge::LuaRef rays, lua_State *lua) -> luabridge::LuaRef {
+  auto &batch = get_physics_query();
+
+  for (auto i = 1; i <= rays.length(); ++i) {
+    auto ray = luabridge::LuaRef{rays[i]};
+    batch.rays.push_back({ray["origin"].cast<glm::vec3>(), ray["direction"].cast<glm::vec3>(),
+                          ray["distance"].cast<float>()});
+  }
+
+  Afk::Engine::get().physics_body_system.query(batch);
+
+  return get_physics_hits(batch.ray_hits, lua);
+}
+
+// Takes an array of {origin, direction, distance, radius} tables.
+static auto physics_sweep(luabridge::LuaRef sweeps, lua_State *lua) -> luabridge::LuaRef {
+  auto &batch = get_physics_query();
+
+  for (auto i = 1; i <= sweeps.length(); ++i) {
+    auto sweep = luabridge::LuaRef{sweeps[i]};
+    batch.sweeps.push_back({sweep["origin"].cast<glm::vec3>(),
+                            sweep["direction"].cast<glm::vec3>(), sweep["distance"].cast<float>(),
+                            sweep["radius"].cast<float>()});
+  }
+
+  Afk::Engine::get().physics_body_system.query(batch);
+
+  return get_physics_hits(batch.sweep_hits, lua);
+}
+
+// Takes an array of {center, radius} tables, and returns an array of the
+// entities each one overlaps.
+static auto physics_overlap(luabridge::LuaRef overlaps, lua_State *lua) -> luabridge::LuaRef {
+  auto &batch = get_physics_query();
+
+  for (auto i = 1; i <= overlaps.length(); ++i) {
+    auto overlap = luabridge::LuaRef{overlaps[i]};
+    batch.overlaps.push_back(
+        {overlap["center"].cast<glm::vec3>(), overlap["radius"].cast<float>()});
+  }
+
+  Afk::Engine::get().physics_body_system.query(batch);
+
+  auto result = luabridge::newTable(lua);
+
+  for (auto i = std::size_t{0}; i < batch.overlap_spans.size(); ++i) {
+    const auto &span = batch.overlap_spans[i];
+    auto entities    = luabridge::newTable(lua);
+
+    for (auto j = std::size_t{0}; j < span.count; ++j) {
+      entities[j + 1] = GameObjectWrapped{batch.overlapped[span.first + j]};
+    }
+
+    result[i + 1] = entities;
+  }
+
+  return result;
+}
+
+static auto physics_hit_get_entity(const Afk::PhysicsQuery::Hit *hit) -> GameObjectWrapped {
+  return GameObjectWrapped{hit->entity};
+}
+
 static auto toggle_wireframe() -> void {
   auto &renderer = Afk::Engine::get().renderer;
   renderer.set_wireframe(!renderer.get_wireframe());
@@ -138,9 +292,13 @@ auto Afk::add_engine_bindings(lua_State *lua) -> void {
 
       .beginClass<GameObjectWrapped>("entity")
       .addFunction("get_transform", &GameObjectWrapped::get_component<Transform>)
+      .addFunction("get_world_transform",
+                   &GameObjectWrapped::get_component<WorldTransform>)
       .addFunction("get_physics", &GameObjectWrapped::get_component<PhysicsBody>)
       .addFunction("get_model", &GameObjectWrapped::get_component<ModelSource>)
       .addFunction("get_script", &GameObjectWrapped::get_component<ScriptsComponent>)
+      .addFunction("set_parent", &set_parent)
+      .addFunction("clear_parent", &clear_parent)
       .endClass()
 
       .beginClass<Afk::PhysicsBody>("physics_component")
@@ -157,6 +315,11 @@ auto Afk::add_engine_bindings(lua_State *lua) -> void {
       .addData("scale", &Afk::Transform::scale)
       .endClass()
 
+      .beginClass<Afk::WorldTransform>("world_transform_component")
+      .addFunction("parent", &get_parent<Afk::WorldTransform>)
+      .addFunction("position", &Afk::WorldTransform::get_position)
+      .endClass()
+
       .beginClass<Afk::ScriptsComponent>("script_component")
       .addFunction("parent", &get_parent<Afk::ScriptsComponent>)
       .addFunction("add", &Afk::ScriptsComponent::add_script)
@@ -165,7 +328,7 @@ auto Afk::add_engine_bindings(lua_State *lua) -> void {
 
       .beginClass<Afk::ModelSource>("model_component")
       .addFunction("parent", &get_parent<Afk::ModelSource>)
-      .addData("name", &Afk::ModelSource::name)
+      .addData("name", &Afk::ModelSource::name, false)
       .endClass()
 
       .beginClass<Afk::BaseComponent>("component")
@@ -180,6 +343,35 @@ auto Afk::add_engine_bindings(lua_State *lua) -> void {
       .addFunction("unwrap", &gameobject_get_entity)
       .endClass()
 
+      .beginClass<Afk::TerrainQuery::Hit>("terrain_hit")
+      .addData("is_hit", &Afk::TerrainQuery::Hit::is_hit, false)
+      .addData("distance", &Afk::TerrainQuery::Hit::distance, false)
+      .addData("position", &Afk::TerrainQuery::Hit::position, false)
+      .addData("normal", &Afk::TerrainQuery::Hit::normal, false)
+      .endClass()
+
+      .beginNamespace("terrain")
+      .addFunction("height", &terrain_height)
+      .addFunction("normal", &terrain_normal)
+      .addFunction("heights", &terrain_heights)
+      .addFunction("normals", &terrain_normals)
+      .addFunction("raycast", &terrain_raycast)
+      .endNamespace()
+
+      .beginClass<Afk::PhysicsQuery::Hit>("physics_hit")
+      .addData("is_hit", &Afk::PhysicsQuery::Hit::is_hit, false)
+      .addData("distance", &Afk::PhysicsQuery::Hit::distance, false)
+      .addData("position", &Afk::PhysicsQuery::Hit::position, false)
+      .addData("normal", &Afk::PhysicsQuery::Hit::normal, false)
+      .addFunction("get_entity", &physics_hit_get_entity)
+      .endClass()
+
+      .beginNamespace("physics")
+      .addFunction("raycast", &physics_raycast)
+      .addFunction("sweep", &physics_sweep)
+      .addFunction("overlap", &physics_overlap)
+      .endNamespace()
+
       .beginNamespace("engine")
       .addFunction("delta_time", &get_delta_time)
       .addFunction("load_asset", &Afk::Asset::game_asset_factory)
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "afk/component/BaseComponent.hpp"
+#include "afk/component/GameObject.hpp"
+
+namespace Afk {
+  /**
+   * Marks an entity as part of the terrain. Its model only draws the chunks
+   * the terrain manager selects each frame, and its body follows the height map.
+   */
+  struct Terrain : public BaseComponent {
+    Terrain() = default;
+    Terrain(GameObject e) {
+      this->owning_entity = e;
+    }
+  };
+}
@@ -1,7 +1,10 @@
 #include "afk/terrain/TerrainManager.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <limits>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -10,6 +13,7 @@
 
 #include "afk/debug/Assert.hpp"
 #include "afk/renderer/Mesh.hpp"
+#include "afk/thread/JobSystem.hpp"
 
 using std::size_t;
 using std::vector;
@@ -17,83 +21,356 @@ using std::vector;
 using glm::vec2;
 using glm::vec3;
 
+using Afk::Frustum;
+using Afk::JobSystem;
 using Afk::HeightMap;
 using Afk::Mesh;
 using Afk::Model;
 using Afk::TerrainManager;
 using Afk::Texture;
-using Index = Mesh::Index;
+using Chunk    = Afk::TerrainManager::Chunk;
+using ChunkIds = Afk::TerrainManager::ChunkIds;
+using Chunks   = Afk::TerrainManager::Chunks;
+using Range    = std::pair<float, float>;
+using Region   = Afk::TerrainManager::Region;
+using Regions  = Afk::TerrainManager::Regions;
+using Stats    = Afk::TerrainManager::Stats;
+using Update   = Afk::TerrainManager::Update;
+using Index    = Mesh::Index;
+
+// The first vertex and stride along the top, bottom, left and right edges of
+// every chunk, which the skirts hang off.
+static constexpr auto CHUNK_EDGES = std::array<std::pair<size_t, size_t>, 4>{
+    {{0, 1},
+     {TerrainManager::CHUNK_SIZE * (TerrainManager::CHUNK_SIZE + 1), 1},
+     {0, TerrainManager::CHUNK_SIZE + 1},
+     {TerrainManager::CHUNK_SIZE, TerrainManager::CHUNK_SIZE + 1}}};
+
+static constexpr auto EMPTY_RANGE =
+    Range{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+
+// The grid's triangles, and its skirt's.
+static constexpr auto CHUNK_TRIANGLES =
+    size_t{TerrainManager::CHUNK_SIZE * TerrainManager::CHUNK_SIZE * 2 +
+           4 * TerrainManager::CHUNK_SIZE * 2};
+
+// Splits count items into bands for the job system, a few per thread so the
+// ones that finish early can steal the rest, and never more than count.
+static auto get_band_count(size_t count) -> size_t {
+  const auto &jobs = JobSystem::get();
+
+  return std::min(count, (jobs.get_worker_count() + 1) * JobSystem::CHUNKS_PER_THREAD);
+}
 
 auto TerrainManager::generate_height_map(int width, int length, float roughness,
                                          float scaling) -> void {
+  // Freed once it's quantized, leaving the height map the only copy.
+  auto heights     = Heights{};
+  const auto range = this->generate_heights(width, length, roughness, scaling, heights);
+
+  this->height_map.width = width;
+  this->height_map.heights.resize(heights.size());
+  this->height_map.set_range(range.first, range.second);
+
+  JobSystem::get().parallel_for(heights.size(), [this, &heights](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      this->height_map.heights[i] = this->height_map.quantize(heights[i]);
+    }
+  });
+}
+
+auto TerrainManager::generate_heights(int width, int length, float roughness, float scaling,
+                                      Heights &heights) -> Range {
   afk_assert(width >= 1, "Invalid width");
   afk_assert(length >= 1, "Invalid length");
 
   const auto w = width;
   const auto l = length;
 
-  const auto num_vertices = static_cast<size_t>(w * l);
+  // Heights can only be quantized once their range is known, so they're
+  // generated at full precision first.
+  heights.resize(static_cast<size_t>(w) * static_cast<size_t>(l));
 
-  auto *noise = FastNoiseSIMD::NewFastNoiseSIMD();
-  noise->SetFrequency(roughness);
-  auto *noise_set = noise->GetSimplexFractalSet(0, 0, 0, w, 1, l);
-  auto index      = size_t{0};
+  // Each band fills its own rows, straight from its own noise set, and keeps
+  // its own range.
+  const auto num_bands = static_cast<int>(get_band_count(static_cast<size_t>(l)));
+  auto ranges          = vector<Range>(static_cast<size_t>(num_bands), EMPTY_RANGE);
 
-  this->height_map.width = width;
-  this->height_map.heights.resize(num_vertices);
+  const auto fill_band = [&heights, &ranges, w, l, num_bands, roughness, scaling](int band) {
+    const auto first = l * band / num_bands;
+    const auto last  = l * (band + 1) / num_bands;
+
+    auto noise = std::unique_ptr<FastNoiseSIMD>{FastNoiseSIMD::NewFastNoiseSIMD()};
+    noise->SetFrequency(roughness);
+
+    auto *noise_set    = noise->GetSimplexFractalSet(first, 0, 0, last - first, 1, w);
+    auto *band_heights = heights.data() + static_cast<size_t>(first * w);
+    const auto size    = static_cast<size_t>((last - first) * w);
+    auto &range        = ranges[static_cast<size_t>(band)];
 
-  for (auto y = 0; y < l; ++y) {
-    for (auto x = 0; x < w; ++x) {
-      this->height_map[{x, y}] = noise_set[index] * scaling;
-      ++index;
+    for (auto i = size_t{0}; i < size; ++i) {
+      band_heights[i] = noise_set[i] * scaling;
+      range.first     = std::min(range.first, band_heights[i]);
+      range.second    = std::max(range.second, band_heights[i]);
     }
+
+    FastNoiseSIMD::FreeNoiseSet(noise_set);
+  };
+
+  // Rethrows anything thrown in a band.
+  JobSystem::get().parallel_for(
+      static_cast<size_t>(num_bands),
+      [&fill_band](size_t begin, size_t end) {
+        for (auto band = begin; band < end; ++band) {
+          fill_band(static_cast<int>(band));
+        }
+      },
+      1);
+
+  auto range = EMPTY_RANGE;
+
+  for (const auto &[min_height, max_height] : ranges) {
+    range.first  = std::min(range.first, min_height);
+    range.second = std::max(range.second, max_height);
   }
 
-  FastNoiseSIMD::FreeNoiseSet(noise_set);
+  return range;
 }
 
-auto TerrainManager::generate_flat_plane(int width, int length) -> void {
-  afk_assert(width >= 1, "Invalid width");
-  afk_assert(length >= 1, "Invalid length");
+auto TerrainManager::diff_heights(const Heights &heights) -> void {
+  const auto w    = this->grid_width;
+  const auto rows = static_cast<size_t>((this->grid_length + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  // Every row of tiles keeps its own regions, so they come out in order.
+  auto row_regions = vector<Regions>(rows);
 
-  const auto w = width;
-  const auto l = length;
+  // Each row of tiles is compared on its own, and writes back the samples
+  // that changed.
+  const auto diff_row = [this, &heights, &row_regions, w](size_t row) {
+    auto &regions     = row_regions[row];
+    const auto tile_y = static_cast<int>(row) * CHUNK_SIZE;
+    const auto end_y  = std::min(tile_y + CHUNK_SIZE, this->grid_length);
+
+    for (auto tile_x = 0; tile_x < w; tile_x += CHUNK_SIZE) {
+      const auto end_x = std::min(tile_x + CHUNK_SIZE, w);
+
+      // The corners of the changed samples, so the region is no bigger than it has to be.
+      auto min = glm::ivec2{end_x, end_y};
+      auto max = glm::ivec2{tile_x - 1, tile_y - 1};
+
+      for (auto y = tile_y; y < end_y; ++y) {
+        for (auto x = tile_x; x < end_x; ++x) {
+          const auto i      = static_cast<size_t>(y * w + x);
+          const auto sample = this->height_map.quantize(heights[i]);
+
+          if (sample != this->height_map.heights[i]) {
+            this->height_map.heights[i] = sample;
+            min                         = glm::min(min, glm::ivec2{x, y});
+            max                         = glm::max(max, glm::ivec2{x, y});
+          }
+        }
+      }
+
+      if (max.x >= min.x) {
+        regions.push_back(Region{min.x, min.y, max.x - min.x + 1, max.y - min.y + 1});
+      }
+    }
+  };
+
+  JobSystem::get().parallel_for(
+      rows,
+      [&diff_row](size_t begin, size_t end) {
+        for (auto row = begin; row < end; ++row) {
+          diff_row(row);
+        }
+      },
+      1);
+
+  for (const auto &regions : row_regions) {
+    this->last_update.regions.insert(this->last_update.regions.end(), regions.begin(),
+                                     regions.end());
+  }
+}
+
+auto TerrainManager::rescale_heights(float min_height, float max_height) -> void {
+  auto old_map   = HeightMap{};
+  old_map.scale  = this->height_map.scale;
+  old_map.offset = this->height_map.offset;
+
+  this->height_map.set_range(std::min(min_height, this->height_map.get_min_height()),
+                             std::max(max_height, this->height_map.get_max_height()));
+
+  for (auto &sample : this->height_map.heights) {
+    sample = this->height_map.quantize(old_map.dequantize(sample));
+  }
+
+  this->last_update.is_rescaled = true;
+  this->last_update.regions.assign(1, this->height_map.get_region());
+}
+
+auto TerrainManager::refresh_regions() -> void {
+  if (this->last_update.is_rescaled) {
+    this->query.build(this->height_map);
+    this->generate_bounds();
+
+    return;
+  }
+
+  for (const auto &region : this->last_update.regions) {
+    this->query.update(region);
+  }
+
+  // A chunk's bounds cover every sample from its first vertex to its last.
+  for (auto &chunk : this->chunks) {
+    const auto span = CHUNK_SIZE << chunk.level;
+
+    const auto is_touched =
+        std::any_of(this->last_update.regions.begin(), this->last_update.regions.end(),
+                    [&chunk, span](const Region &region) {
+                      return region.x <= chunk.x + span && chunk.x < region.x + region.width &&
+                             region.y <= chunk.y + span && chunk.y < region.y + region.length;
+                    });
+
+    if (is_touched) {
+      this->generate_chunk_bounds(chunk);
+    }
+  }
+}
+
+auto TerrainManager::generate_chunks() -> void {
+  this->chunks.clear();
+
+  // Find the smallest quadtree covering the whole height map.
+  const auto quads = std::max(this->grid_width - 1, this->grid_length - 1);
+  auto span        = CHUNK_SIZE;
+  auto level       = size_t{0};
+
+  while (span < quads) {
+    span *= 2;
+    ++level;
+  }
+
+  this->generate_chunk(0, 0, level);
+  this->stats.total_chunks = this->chunks.size();
+}
+
+auto TerrainManager::generate_chunk(int x, int y, size_t level) -> size_t {
+  const auto step  = 1 << level;
+  const auto index = this->chunks.size();
+
+  auto chunk  = Chunk{};
+  chunk.x     = x;
+  chunk.y     = y;
+  chunk.level = level;
+  this->chunks.push_back(chunk);
+
+  if (level == 0) {
+    return index;
+  }
+
+  const auto half = CHUNK_SIZE * step / 2;
+
+  for (auto i = size_t{0}; i < 4; ++i) {
+    const auto child_x = x + static_cast<int>(i % 2) * half;
+    const auto child_y = y + static_cast<int>(i / 2) * half;
+
+    // Quadrants entirely off the edge of the map have nothing to draw.
+    if (child_x < this->grid_width - 1 && child_y < this->grid_length - 1) {
+      const auto child = this->generate_chunk(child_x, child_y, level - 1);
+      // Generating the child may have moved the parent.
+      this->chunks[index].children[i] = child;
+    }
+  }
+
+  return index;
+}
+
+auto TerrainManager::generate_bounds() -> void {
+  // Every chunk's bounds are its own, so runs of chunks are jobs of their own.
+  JobSystem::get().parallel_for(
+      this->chunks.size(),
+      [this](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+          this->generate_chunk_bounds(this->chunks[i]);
+        }
+      },
+      1);
+}
+
+auto TerrainManager::generate_chunk_bounds(Chunk &chunk) const -> void {
+  constexpr auto n = CHUNK_SIZE + 1;
+
+  const auto step        = 1 << chunk.level;
+  const auto half_width  = static_cast<float>(this->grid_width) / 2.0f;
+  const auto half_length = static_cast<float>(this->grid_length) / 2.0f;
+
+  // Chunks hanging off the edge of the map repeat its last row or column.
+  const auto last_x = std::min(chunk.x + (n - 1) * step, this->grid_width - 1);
+  const auto last_y = std::min(chunk.y + (n - 1) * step, this->grid_length - 1);
+
+  auto min_height = std::numeric_limits<float>::max();
+  auto max_height = std::numeric_limits<float>::lowest();
+
+  for (auto grid_y = chunk.y; grid_y <= last_y; grid_y += step) {
+    for (auto grid_x = chunk.x; grid_x <= last_x; grid_x += step) {
+      const auto height = this->height_map.at({grid_x, grid_y});
+
+      min_height = std::min(min_height, height);
+      max_height = std::max(max_height, height);
+    }
+  }
+
+  // Hang a skirt off each edge, deep enough to cover any gap to a neighbour
+  // at a different level of detail.
+  chunk.skirt_depth = std::max(max_height - min_height, static_cast<float>(step));
+  chunk.triangles   = CHUNK_TRIANGLES;
 
-  const auto num_vertices = static_cast<size_t>(w * l);
-  const auto num_indices  = static_cast<size_t>((w - 1) * (l - 1) * 6);
+  chunk.min = vec3{static_cast<float>(chunk.x) - half_width, min_height - chunk.skirt_depth,
+                   static_cast<float>(chunk.y) - half_length};
+  chunk.max = vec3{static_cast<float>(last_x) - half_width, max_height,
+                   static_cast<float>(last_y) - half_length};
+}
 
-  this->mesh.vertices.resize(num_vertices);
-  this->mesh.indices.resize(num_indices);
+auto TerrainManager::generate_chunk_indices() -> Mesh::Indices {
+  constexpr auto n = size_t{CHUNK_SIZE + 1};
 
-  auto vertexIndex = size_t{0};
-  for (auto y = 0; y < l; ++y) {
-    for (auto x = 0; x < w; ++x) {
-      this->mesh.vertices[vertexIndex].position =
-          vec3{static_cast<float>(x) - static_cast<float>(width) / 2.0f, 0.0f,
-               static_cast<float>(y) - static_cast<float>(length) / 2.0f};
+  auto indices = Mesh::Indices((n - 1) * (n - 1) * 6 + 4 * (n - 1) * 6);
+  auto *index  = indices.data();
 
-      // FIXME
-      this->mesh.vertices[vertexIndex].uvs =
-          vec2{static_cast<float>(x) / 2.0f, static_cast<float>(y) / 2.0f};
+  for (auto j = size_t{0}; j < n - 1; ++j) {
+    for (auto i = size_t{0}; i < n - 1; ++i) {
+      const auto start = static_cast<Index>(j * n + i);
 
-      ++vertexIndex;
+      *index++ = start;
+      *index++ = start + 1;
+      *index++ = static_cast<Index>(start + n);
+
+      *index++ = start + 1;
+      *index++ = static_cast<Index>(start + 1 + n);
+      *index++ = static_cast<Index>(start + n);
     }
   }
 
-  auto indicesIndex = size_t{0};
-  for (auto y = 0; y < (l - 1); ++y) {
-    for (auto x = 0; x < (w - 1); ++x) {
-      auto start = y * w + x;
+  auto skirt = static_cast<Index>(n * n);
+
+  for (const auto &[first, stride] : CHUNK_EDGES) {
+    for (auto k = size_t{0}; k < n - 1; ++k) {
+      const auto top    = static_cast<Index>(first + k * stride);
+      const auto next   = static_cast<Index>(first + (k + 1) * stride);
+      const auto bottom = static_cast<Index>(skirt + k);
 
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start);
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start + 1);
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start + w);
+      *index++ = top;
+      *index++ = next;
+      *index++ = bottom;
 
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start + 1);
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start + 1 + w);
-      this->mesh.indices[indicesIndex++] = static_cast<Mesh::Index>(start + w);
+      *index++ = next;
+      *index++ = bottom + 1;
+      *index++ = bottom;
     }
+
+    skirt += static_cast<Index>(n);
   }
+
+  return indices;
 }
 
 auto TerrainManager::generate_terrain(int width, int length, float roughness,
@@ -101,24 +378,211 @@ auto TerrainManager::generate_terrain(int width, int length, float roughness,
   afk_assert(width >= 1, "Invalid width");
   afk_assert(length >= 1, "Invalid length");
 
-  this->generate_flat_plane(width, length);
+  this->grid_width  = width;
+  this->grid_length = length;
+
   this->generate_height_map(width, length, roughness, scaling);
+  this->query.build(this->height_map);
+  this->generate_chunks();
+  this->generate_bounds();
+}
+
+auto TerrainManager::update_terrain(float roughness, float scaling) -> const Update & {
+  afk_assert(!this->chunks.empty(), "Terrain not generated");
+
+  this->last_update.regions.clear();
+  this->last_update.is_rescaled = false;
+
+  auto heights = Heights{};
+
+  const auto [min_height, max_height] =
+      this->generate_heights(this->grid_width, this->grid_length, roughness, scaling, heights);
+
+  // Heights that still fit keep the map's scale, so only the samples that
+  // actually moved change.
+  if (min_height < this->height_map.get_min_height() ||
+      max_height > this->height_map.get_max_height()) {
+    this->height_map.set_range(min_height, max_height);
+
+    for (auto i = size_t{0}; i < heights.size(); ++i) {
+      this->height_map.heights[i] = this->height_map.quantize(heights[i]);
+    }
+
+    this->last_update.is_rescaled = true;
+    this->last_update.regions.assign(1, this->height_map.get_region());
+  } else {
+    this->diff_heights(heights);
+  }
+
+  this->refresh_regions();
+
+  return this->last_update;
+}
+
+auto TerrainManager::apply_brush(vec2 center, float radius, float strength) -> const Update & {
+  afk_assert(!this->chunks.empty(), "Terrain not generated");
+  afk_assert(radius > 0.0f, "Invalid brush radius");
+
+  this->last_update.regions.clear();
+  this->last_update.is_rescaled = false;
+
+  const auto first_x = std::max(static_cast<int>(std::floor(center.x - radius)), 0);
+  const auto first_y = std::max(static_cast<int>(std::floor(center.y - radius)), 0);
+  const auto last_x =
+      std::min(static_cast<int>(std::ceil(center.x + radius)), this->grid_width - 1);
+  const auto last_y =
+      std::min(static_cast<int>(std::ceil(center.y + radius)), this->grid_length - 1);
+
+  if (first_x > last_x || first_y > last_y) {
+    return this->last_update;
+  }
+
+  const auto region = Region{first_x, first_y, last_x - first_x + 1, last_y - first_y + 1};
+  auto range        = EMPTY_RANGE;
+  // Only the samples under the brush, since the whole map may be quantized
+  // again before they're written back.
+  auto heights = Heights(static_cast<size_t>(region.width * region.length));
+
+  // Raise the heights under the brush, fading out smoothly towards its edge.
+  for (auto y = first_y; y <= last_y; ++y) {
+    for (auto x = first_x; x <= last_x; ++x) {
+      const auto offset  = vec2{static_cast<float>(x), static_cast<float>(y)} - center;
+      const auto falloff = std::max(1.0f - glm::dot(offset, offset) / (radius * radius), 0.0f);
+      const auto height  = this->height_map.at({x, y}) + strength * falloff * falloff;
+
+      heights[static_cast<size_t>((y - first_y) * region.width + x - first_x)] = height;
+      range.first  = std::min(range.first, height);
+      range.second = std::max(range.second, height);
+    }
+  }
+
+  if (range.first < this->height_map.get_min_height() ||
+      range.second > this->height_map.get_max_height()) {
+    this->rescale_heights(range.first, range.second);
+  } else {
+    this->last_update.regions.push_back(region);
+  }
+
+  for (auto y = first_y; y <= last_y; ++y) {
+    for (auto x = first_x; x <= last_x; ++x) {
+      const auto i = static_cast<size_t>(y * this->grid_width + x);
+
+      this->height_map.heights[i] = this->height_map.quantize(
+          heights[static_cast<size_t>((y - first_y) * region.width + x - first_x)]);
+    }
+  }
+
+  this->refresh_regions();
 
-  for (auto i = std::size_t{0}; i < this->height_map.heights.size(); ++i) {
-    this->mesh.vertices[i].position.y += this->height_map.heights[i];
+  return this->last_update;
+}
+
+auto TerrainManager::select_chunks(const Frustum &frustum, vec3 camera_position)
+    -> const ChunkIds & {
+  this->selected.clear();
+  this->stats.visible_chunks    = 0;
+  this->stats.visible_triangles = 0;
+
+  if (this->chunks.empty()) {
+    return this->selected;
   }
+
+  this->pending.assign(1, 0);
+
+  while (!this->pending.empty()) {
+    const auto id = this->pending.back();
+    this->pending.pop_back();
+
+    const auto &chunk = this->chunks[id];
+
+    if (!frustum.intersects(chunk.min, chunk.max)) {
+      continue;
+    }
+
+    const auto closest  = glm::clamp(camera_position, chunk.min, chunk.max);
+    const auto distance = glm::distance(camera_position, closest);
+    const auto is_leaf  = chunk.level == 0;
+
+    // A chunk is detailed enough once it's further than its children's range.
+    const auto range = std::ldexp(this->lod_distance, static_cast<int>(chunk.level) - 1);
+
+    if (is_leaf || distance >= range) {
+      this->selected.push_back(id);
+      ++this->stats.visible_chunks;
+      this->stats.visible_triangles += chunk.triangles;
+
+      continue;
+    }
+
+    for (const auto child : chunk.children) {
+      if (child != NO_CHUNK) {
+        this->pending.push_back(child);
+      }
+    }
+  }
+
+  return this->selected;
+}
+
+auto TerrainManager::get_chunks() const -> const Chunks & {
+  return this->chunks;
 }
 
-auto TerrainManager::get_model() -> Model {
-  auto model = Model{};
-  model.meshes.push_back(this->mesh);
-  model.file_path = "gen/terrain/terrain";
+auto TerrainManager::get_stats() const -> Stats {
+  return this->stats;
+}
+
+auto TerrainManager::get_width() const -> int {
+  return this->grid_width;
+}
+
+auto TerrainManager::get_length() const -> int {
+  return this->grid_length;
+}
+
+auto TerrainManager::get_model() const -> Model {
+  constexpr auto n = size_t{CHUNK_SIZE + 1};
+
+  // A unit grid, with the skirt's vertices flagged by a y of -1. The vertex
+  // shader scales it to each chunk and looks its heights up.
+  auto mesh = Mesh{};
+  mesh.vertices.resize(n * n + 4 * n);
+
+  for (auto j = size_t{0}; j < n; ++j) {
+    for (auto i = size_t{0}; i < n; ++i) {
+      mesh.vertices[j * n + i].position =
+          vec3{static_cast<float>(i), 0.0f, static_cast<float>(j)};
+    }
+  }
+
+  auto skirt = n * n;
+
+  for (const auto &[first, stride] : CHUNK_EDGES) {
+    for (auto k = size_t{0}; k < n; ++k) {
+      auto &vertex      = mesh.vertices[skirt + k];
+      vertex            = mesh.vertices[first + k * stride];
+      vertex.position.y = -1.0f;
+    }
+
+    skirt += n;
+  }
+
+  auto height_map_texture = Texture{HEIGHT_MAP_PATH};
+  height_map_texture.type = Texture::Type::Height;
+  mesh.indices            = TerrainManager::generate_chunk_indices();
+  mesh.textures.push_back(std::move(height_map_texture));
+
+  auto model      = Model{};
+  model.file_path = MODEL_PATH;
   model.file_dir  = "gen/terrain";
+  model.meshes.push_back(std::move(mesh));
+
+  // Every chunk draws the one mesh, the renderer is told which chunks to draw.
   ModelNode node;
-  const auto mesh_index = model.meshes.size() - 1;
-  node.mesh_ids.push_back(mesh_index);
+  node.mesh_ids.push_back(0);
+
   model.nodes.push_back(std::move(node));
-  model.root_node_index = mesh_index;
+  model.root_node_index = 0;
 
   return model;
 }
@@ -1,15 +1,92 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <utility>
 #include <vector>
 
+#include <glm/glm.hpp>
+
 #include "afk/physics/shape/HeightMap.hpp"
+#include "afk/renderer/Frustum.hpp"
 #include "afk/renderer/Model.hpp"
+#include "afk/terrain/TerrainQuery.hpp"
 
 namespace Afk {
+  /**
+   * Generates the terrain, and decides which parts of it to draw.
+   *
+   * The terrain is split into a quadtree of square chunks. Leaves cover
+   * CHUNK_SIZE quads at full detail, and each level up covers four times the
+   * area with the same number of vertices. Every frame, chunks outside the view
+   * are culled and chunks far enough from the camera are drawn in place of
+   * their children. Each chunk has a skirt hanging off its edges to hide cracks
+   * between neighbours of different detail.
+   *
+   * Chunks have no meshes of their own. Every chunk draws the same flat grid,
+   * spaced out to its level and displaced by the height map's texture, so the
+   * quantized height map is the only copy of the heights.
+   *
+   * Generation is spread across the job system's workers: the height map in
+   * bands of rows, and the chunk bounds in runs of chunks.
+   *
+   * Once generated, the terrain is edited in place. Every edit reports the
+   * regions of samples it changed, so the height texture can be patched
+   * rather than uploaded again, and only the chunks and query bounds over
+   * those regions are refreshed. Physics reads the samples in place, so it
+   * sees edits straight away.
+   */
   class TerrainManager {
   public:
+    // Quads along each side of every chunk, at every level of detail.
+    static constexpr auto CHUNK_SIZE = 64;
+    static constexpr auto NO_CHUNK   = std::numeric_limits<std::size_t>::max();
+
+    static constexpr const char *MODEL_PATH      = "gen/terrain/terrain";
+    static constexpr const char *HEIGHT_MAP_PATH = "gen/terrain/height_map";
+
+    struct Chunk {
+      using Children = std::array<std::size_t, 4>;
+
+      // The chunk's first vertex on the height map.
+      int x = 0;
+      int y = 0;
+
+      glm::vec3 min = {};
+      glm::vec3 max = {};
+      // Zero is full detail, each level above halves it.
+      std::size_t level     = 0;
+      std::size_t triangles = 0;
+      // How far the skirt hangs below the chunk's edges.
+      float skirt_depth = 0.0f;
+      Children children = {NO_CHUNK, NO_CHUNK, NO_CHUNK, NO_CHUNK};
+    };
+
+    struct Stats {
+      std::size_t total_chunks      = 0;
+      std::size_t visible_chunks    = 0;
+      std::size_t visible_triangles = 0;
+    };
+
+    using Chunks   = std::vector<Chunk>;
+    using ChunkIds = std::vector<std::size_t>;
+    using Region   = HeightMap::Region;
+    using Regions  = std::vector<Region>;
+
+    struct Update {
+      Regions regions = {};
+      // The map's range had to grow, so every sample was quantized again and
+      // anything holding onto its scale or offset has to be told.
+      bool is_rescaled = false;
+    };
+
     HeightMap height_map = {};
-    Mesh mesh           = {};
+    // Rebuilt along with the height map.
+    TerrainQuery query = {};
+    // Chunks stay within full detail for this distance, and each level above
+    // for twice the distance of the last.
+    float lod_distance = 96.0f;
 
     TerrainManager()                       = default;
     TerrainManager(TerrainManager &&)      = delete;
@@ -18,13 +95,61 @@ namespace Afk {
     auto operator=(TerrainManager &&) -> TerrainManager & = delete;
 
     auto initialize() -> void;
-    auto get_model() -> Afk::Model;
+    /**
+     * Returns the terrain model: the one grid every chunk draws, sampling the
+     * height map's texture, which has to be loaded from height_map under
+     * HEIGHT_MAP_PATH first.
+     */
+    auto get_model() const -> Afk::Model;
     auto generate_terrain(int width, int length, float roughness, float scaling) -> void;
+    /**
+     * Regenerates the heights with new parameters, keeping the size, and
+     * returns the regions that changed.
+     */
+    auto update_terrain(float roughness, float scaling) -> const Update &;
+    /**
+     * Raises the heights within radius of center by up to strength, or lowers
+     * them for a negative strength, and returns the regions that changed.
+     * Both center and radius are in samples.
+     */
+    auto apply_brush(glm::vec2 center, float radius, float strength) -> const Update &;
+
+    /**
+     * Returns the chunks to draw this frame. Both arguments are in the
+     * terrain's model space, i.e. the frustum should be built from
+     * projection * view * model.
+     */
+    auto select_chunks(const Frustum &frustum, glm::vec3 camera_position) -> const ChunkIds &;
+    auto get_chunks() const -> const Chunks &;
+    auto get_stats() const -> Stats;
+    auto get_width() const -> int;
+    auto get_length() const -> int;
 
   private:
+    using Range = std::pair<float, float>;
+    // Heights at full precision, only kept until they're quantized.
+    using Heights = std::vector<float>;
+
     bool is_initialized = false;
+    int grid_width      = 0;
+    int grid_length     = 0;
+    Chunks chunks       = {};
+    ChunkIds selected   = {};
+    ChunkIds pending    = {};
+    Stats stats         = {};
+    Update last_update  = {};
 
-    auto generate_flat_plane(int width, int length) -> void;
     auto generate_height_map(int width, int length, float roughness, float scaling) -> void;
+    auto generate_heights(int width, int length, float roughness, float scaling,
+                          Heights &heights) -> Range;
+    auto diff_heights(const Heights &heights) -> void;
+    auto rescale_heights(float min_height, float max_height) -> void;
+    auto refresh_regions() -> void;
+    auto generate_chunks() -> void;
+    auto generate_chunk(int x, int y, std::size_t level) -> std::size_t;
+    auto generate_bounds() -> void;
+    auto generate_chunk_bounds(Chunk &chunk) const -> void;
+
+    static auto generate_chunk_indices() -> Mesh::Indices;
   };
 }
@@ -0,0 +1,425 @@
+#include "afk/terrain/TerrainQuery.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/debug/Assert.hpp"
+
+using std::size_t;
+
+using glm::vec2;
+using glm::vec3;
+
+using Afk::HeightMap;
+using Afk::TerrainQuery;
+using Hit = Afk::TerrainQuery::Hit;
+
+// The most cells waiting to be visited during a raycast: each level visited
+// can leave three siblings behind, and there are at most 32 levels.
+static constexpr auto MAX_PENDING_CELLS = size_t{4 + 3 * 32};
+
+auto TerrainQuery::build(const HeightMap &_height_map) -> void {
+  const auto map_length = _height_map.get_length();
+
+  afk_assert(_height_map.width >= 2 && map_length >= 2, "Height map too small to query");
+
+  this->height_map = &_height_map;
+  this->width      = _height_map.width;
+  this->length     = map_length;
+  this->levels.clear();
+
+  // Each cell of the first level covers one quad, and each level above halves
+  // the last, until one cell covers the whole map.
+  auto level_width  = this->width - 1;
+  auto level_length = this->length - 1;
+
+  while (true) {
+    auto level   = Level{};
+    level.width  = level_width;
+    level.length = level_length;
+    level.min.resize(static_cast<size_t>(level.width * level.length));
+    level.max.resize(level.min.size());
+    this->levels.push_back(std::move(level));
+
+    if (level_width == 1 && level_length == 1) {
+      break;
+    }
+
+    level_width  = (level_width + 1) / 2;
+    level_length = (level_length + 1) / 2;
+  }
+
+  this->update(_height_map.get_region());
+}
+
+auto TerrainQuery::update(const HeightMap::Region &region) -> void {
+  afk_assert(this->is_built(), "Terrain query not built");
+
+  if (region.width <= 0 || region.length <= 0) {
+    return;
+  }
+
+  const auto &heights = this->height_map->heights;
+  const auto w        = static_cast<size_t>(this->width);
+  auto &first_level   = this->levels.front();
+
+  // A sample is a corner of the cells either side of it.
+  auto first_x = std::max(region.x - 1, 0);
+  auto first_y = std::max(region.y - 1, 0);
+  auto last_x  = std::min(region.x + region.width - 1, first_level.width - 1);
+  auto last_y  = std::min(region.y + region.length - 1, first_level.length - 1);
+
+  for (auto y = first_y; y <= last_y; ++y) {
+    for (auto x = first_x; x <= last_x; ++x) {
+      const auto corner = static_cast<size_t>(y) * w + static_cast<size_t>(x);
+
+      const auto corners = std::array<HeightMap::Sample, 4>{
+          heights[corner], heights[corner + 1], heights[corner + w], heights[corner + w + 1]};
+      const auto [min, max] = std::minmax_element(corners.begin(), corners.end());
+      const auto cell       = static_cast<size_t>(y * first_level.width + x);
+
+      first_level.min[cell] = static_cast<Bound>(*min);
+      first_level.max[cell] = static_cast<Bound>(*max);
+    }
+  }
+
+  // Only the cells above the ones that changed need their bounds merged again.
+  for (auto i = size_t{1}; i < this->levels.size(); ++i) {
+    const auto &below = this->levels[i - 1];
+    auto &above       = this->levels[i];
+
+    first_x /= 2;
+    first_y /= 2;
+    last_x /= 2;
+    last_y /= 2;
+
+    for (auto y = first_y; y <= last_y; ++y) {
+      for (auto x = first_x; x <= last_x; ++x) {
+        auto min = std::numeric_limits<Bound>::max();
+        auto max = std::numeric_limits<Bound>::lowest();
+
+        for (auto child_y = y * 2; child_y < std::min(y * 2 + 2, below.length); ++child_y) {
+          for (auto child_x = x * 2; child_x < std::min(x * 2 + 2, below.width); ++child_x) {
+            const auto from = static_cast<size_t>(child_y * below.width + child_x);
+
+            min = std::min(min, below.min[from]);
+            max = std::max(max, below.max[from]);
+          }
+        }
+
+        const auto to = static_cast<size_t>(y * above.width + x);
+        above.min[to] = min;
+        above.max[to] = max;
+      }
+    }
+  }
+}
+
+auto TerrainQuery::set_origin(vec3 _origin) -> void {
+  this->origin = _origin;
+}
+
+auto TerrainQuery::get_origin() const -> vec3 {
+  return this->origin;
+}
+
+auto TerrainQuery::is_built() const -> bool {
+  return this->height_map != nullptr;
+}
+
+auto TerrainQuery::gather(const vec2 *points, size_t count, Block &block) const -> void {
+  afk_assert_debug(count <= LANES, "Too many points for one block");
+
+  const auto max_x    = static_cast<float>(this->width - 1);
+  const auto max_y    = static_cast<float>(this->length - 1);
+  const auto *heights = this->height_map->heights.data();
+  const auto w        = static_cast<size_t>(this->width);
+
+  auto corners = std::array<size_t, LANES>{};
+
+  // Split into passes, so the arithmetic ones vectorize around the gather.
+  for (auto i = size_t{0}; i < count; ++i) {
+    const auto x  = std::clamp(points[i].x - this->origin.x, 0.0f, max_x);
+    const auto y  = std::clamp(points[i].y - this->origin.z, 0.0f, max_y);
+    const auto cx = std::min(std::floor(x), max_x - 1.0f);
+    const auto cy = std::min(std::floor(y), max_y - 1.0f);
+
+    block.fx[i] = x - cx;
+    block.fy[i] = y - cy;
+    corners[i]  = static_cast<size_t>(cy) * w + static_cast<size_t>(cx);
+  }
+
+  for (auto i = size_t{0}; i < count; ++i) {
+    const auto corner = corners[i];
+
+    block.x0y0[i] = static_cast<float>(heights[corner]);
+    block.x1y0[i] = static_cast<float>(heights[corner + 1]);
+    block.x0y1[i] = static_cast<float>(heights[corner + w]);
+    block.x1y1[i] = static_cast<float>(heights[corner + w + 1]);
+  }
+}
+
+auto TerrainQuery::get_height(vec2 point) const -> float {
+  auto height = 0.0f;
+  this->interpolate_heights(&point, 1, &height);
+
+  return height;
+}
+
+auto TerrainQuery::get_normal(vec2 point) const -> vec3 {
+  auto normal = vec3{};
+  this->interpolate_normals(&point, 1, &normal);
+
+  return normal;
+}
+
+auto TerrainQuery::get_heights(const Points &points, Heights &heights) const -> void {
+  heights.resize(points.size());
+  this->interpolate_heights(points.data(), points.size(), heights.data());
+}
+
+auto TerrainQuery::get_normals(const Points &points, Normals &normals) const -> void {
+  normals.resize(points.size());
+  this->interpolate_normals(points.data(), points.size(), normals.data());
+}
+
+auto TerrainQuery::interpolate_heights(const vec2 *points, size_t count, float *heights) const
+    -> void {
+  afk_assert(this->is_built(), "Terrain query not built");
+
+  const auto scale  = this->height_map->scale;
+  const auto offset = this->height_map->offset + this->origin.y;
+  auto block        = Block{};
+
+  for (auto first = size_t{0}; first < count; first += LANES) {
+    const auto lanes = std::min(LANES, count - first);
+    auto *out        = heights + first;
+
+    this->gather(points + first, lanes, block);
+
+    // Interpolating the samples first means only one of them is dequantized.
+    for (auto i = size_t{0}; i < lanes; ++i) {
+      const auto y0 = block.x0y0[i] + (block.x1y0[i] - block.x0y0[i]) * block.fx[i];
+      const auto y1 = block.x0y1[i] + (block.x1y1[i] - block.x0y1[i]) * block.fx[i];
+
+      out[i] = (y0 + (y1 - y0) * block.fy[i]) * scale + offset;
+    }
+  }
+}
+
+auto TerrainQuery::interpolate_normals(const vec2 *points, size_t count, vec3 *normals) const
+    -> void {
+  afk_assert(this->is_built(), "Terrain query not built");
+
+  const auto scale = this->height_map->scale;
+  auto block       = Block{};
+  auto dx          = std::array<float, LANES>{};
+  auto dy          = std::array<float, LANES>{};
+
+  for (auto first = size_t{0}; first < count; first += LANES) {
+    const auto lanes = std::min(LANES, count - first);
+    auto *out        = normals + first;
+
+    this->gather(points + first, lanes, block);
+
+    // The slopes of the bilinear surface along each axis.
+    for (auto i = size_t{0}; i < lanes; ++i) {
+      const auto dx0 = block.x1y0[i] - block.x0y0[i];
+      const auto dx1 = block.x1y1[i] - block.x0y1[i];
+      const auto dy0 = block.x0y1[i] - block.x0y0[i];
+      const auto dy1 = block.x1y1[i] - block.x1y0[i];
+
+      dx[i] = (dx0 + (dx1 - dx0) * block.fy[i]) * scale;
+      dy[i] = (dy0 + (dy1 - dy0) * block.fx[i]) * scale;
+    }
+
+    for (auto i = size_t{0}; i < lanes; ++i) {
+      out[i] = glm::normalize(vec3{-dx[i], 1.0f, -dy[i]});
+    }
+  }
+}
+
+auto TerrainQuery::get_sample(int x, int y) const -> float {
+  return this->height_map->at({x, y});
+}
+
+auto TerrainQuery::intersect_cell(vec3 ray_origin, vec3 direction, int x, int y,
+                                  float &distance, vec3 &normal) const -> bool {
+  const auto fx = static_cast<float>(x);
+  const auto fy = static_cast<float>(y);
+
+  // Split the same way as the terrain's meshes.
+  const auto x0y0 = vec3{fx, this->get_sample(x, y), fy};
+  const auto x1y0 = vec3{fx + 1.0f, this->get_sample(x + 1, y), fy};
+  const auto x0y1 = vec3{fx, this->get_sample(x, y + 1), fy + 1.0f};
+  const auto x1y1 = vec3{fx + 1.0f, this->get_sample(x + 1, y + 1), fy + 1.0f};
+
+  const auto triangles = std::array<std::array<vec3, 3>, 2>{{{x0y0, x1y0, x0y1},
+                                                              {x1y0, x1y1, x0y1}}};
+  auto is_hit = false;
+
+  // Möller-Trumbore, keeping the nearest hit.
+  for (const auto &[a, b, c] : triangles) {
+    const auto ab = b - a;
+    const auto ac = c - a;
+    const auto p  = glm::cross(direction, ac);
+    const auto d  = glm::dot(ab, p);
+
+    if (std::abs(d) < std::numeric_limits<float>::epsilon()) {
+      continue;
+    }
+
+    const auto inverse = 1.0f / d;
+    const auto s       = ray_origin - a;
+    const auto u       = glm::dot(s, p) * inverse;
+
+    if (u < 0.0f || u > 1.0f) {
+      continue;
+    }
+
+    const auto q = glm::cross(s, ab);
+    const auto v = glm::dot(direction, q) * inverse;
+
+    if (v < 0.0f || u + v > 1.0f) {
+      continue;
+    }
+
+    const auto t = glm::dot(ac, q) * inverse;
+
+    if (t >= 0.0f && t < distance) {
+      distance = t;
+      normal   = glm::normalize(glm::cross(ab, ac));
+      is_hit   = true;
+    }
+  }
+
+  // Facing up, whichever way the triangle winds.
+  if (is_hit && normal.y < 0.0f) {
+    normal = -normal;
+  }
+
+  return is_hit;
+}
+
+auto TerrainQuery::raycast(vec3 ray_origin, vec3 direction, float max_distance) const -> Hit {
+  afk_assert(this->is_built(), "Terrain query not built");
+
+  auto hit = Hit{};
+
+  if (glm::dot(direction, direction) == 0.0f || max_distance <= 0.0f) {
+    return hit;
+  }
+
+  // Trace in the map's space, in samples with dequantized heights.
+  const auto local    = ray_origin - this->origin;
+  const auto unit     = glm::normalize(direction);
+  const auto inverse  = 1.0f / unit;
+  const auto &heights = *this->height_map;
+  auto nearest        = max_distance;
+  auto nearest_normal = vec3{};
+
+  struct Cell {
+    int level = 0;
+    int x     = 0;
+    int y     = 0;
+  };
+
+  // Returns where the ray enters the cell, or infinity if it misses it.
+  const auto enter = [&](const Cell &cell) {
+    const auto &level = this->levels[static_cast<size_t>(cell.level)];
+    const auto index  = static_cast<size_t>(cell.y * level.width + cell.x);
+    const auto size   = 1 << cell.level;
+
+    const auto min = vec3{static_cast<float>(cell.x * size),
+                          heights.dequantize(level.min[index]),
+                          static_cast<float>(cell.y * size)};
+    const auto max = vec3{static_cast<float>(std::min((cell.x + 1) * size, this->width - 1)),
+                          heights.dequantize(level.max[index]),
+                          static_cast<float>(std::min((cell.y + 1) * size, this->length - 1))};
+
+    // Slabs, clipped to the part of the ray that could still beat the nearest hit.
+    auto entry = 0.0f;
+    auto exit  = nearest;
+
+    for (auto axis = 0; axis < 3; ++axis) {
+      // A ray parallel to a slab is either always inside it or never, and
+      // an origin on its edge would give 0 * inf, which is NaN.
+      if (unit[axis] == 0.0f) {
+        if (local[axis] < min[axis] || local[axis] > max[axis]) {
+          return std::numeric_limits<float>::infinity();
+        }
+
+        continue;
+      }
+
+      const auto t0 = (min[axis] - local[axis]) * inverse[axis];
+      const auto t1 = (max[axis] - local[axis]) * inverse[axis];
+
+      entry = std::max(entry, std::min(t0, t1));
+      exit  = std::min(exit, std::max(t0, t1));
+    }
+
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+  };
+
+  auto pending = std::array<Cell, MAX_PENDING_CELLS>{};
+  auto count   = size_t{0};
+
+  pending[count++] = {static_cast<int>(this->levels.size()) - 1, 0, 0};
+
+  while (count > 0) {
+    const auto cell = pending[--count];
+
+    if (enter(cell) == std::numeric_limits<float>::infinity()) {
+      continue;
+    }
+
+    if (cell.level == 0) {
+      if (this->intersect_cell(local, unit, cell.x, cell.y, nearest, nearest_normal)) {
+        hit.is_hit = true;
+      }
+
+      continue;
+    }
+
+    // Visit the children nearest first, so later ones are culled by the hits
+    // of earlier ones.
+    const auto &below = this->levels[static_cast<size_t>(cell.level - 1)];
+    auto children     = std::array<std::pair<float, Cell>, 4>{};
+    auto num_children = size_t{0};
+
+    for (auto i = 0; i < 4; ++i) {
+      const auto child = Cell{cell.level - 1, cell.x * 2 + i % 2, cell.y * 2 + i / 2};
+
+      if (child.x < below.width && child.y < below.length) {
+        const auto entry = enter(child);
+
+        if (entry != std::numeric_limits<float>::infinity()) {
+          children[num_children++] = {entry, child};
+        }
+      }
+    }
+
+    std::sort(children.begin(), children.begin() + static_cast<std::ptrdiff_t>(num_children),
+              [](const auto &lhs, const auto &rhs) { return lhs.first > rhs.first; });
+
+    for (auto i = size_t{0}; i < num_children; ++i) {
+      pending[count++] = children[i].second;
+    }
+  }
+
+  if (hit.is_hit) {
+    hit.distance = nearest;
+    hit.position = ray_origin + unit * nearest;
+    hit.normal   = nearest_normal;
+  }
+
+  return hit;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/physics/shape/HeightMap.hpp"
+
+namespace Afk {
+  /**
+   * Answers ground height questions straight from a height map, without going
+   * through physics.
+   *
+   * Heights and normals are bilinearly interpolated between samples, and can
+   * be sampled in batches, LANES points at a time in flat arrays the compiler
+   * can vectorize. Rays are traced down a min/max pyramid over the map's
+   * cells, so whole regions a ray passes over are skipped at once.
+   *
+   * Everything is in world space, the map's first sample sitting at the
+   * origin.
+   */
+  class TerrainQuery {
+  public:
+    static constexpr auto LANES = std::size_t{8};
+
+    struct Hit {
+      bool is_hit        = false;
+      float distance     = 0.0f;
+      glm::vec3 position = {};
+      glm::vec3 normal   = {};
+    };
+
+    // Points are on the ground plane, i.e. x and z.
+    using Points  = std::vector<glm::vec2>;
+    using Heights = std::vector<float>;
+    using Normals = std::vector<glm::vec3>;
+
+    /**
+     * Builds the min/max pyramid. The height map is read in place, so it has
+     * to outlive the query, and the query has to be rebuilt if it changes.
+     */
+    auto build(const HeightMap &height_map) -> void;
+    // Merges the bounds over a region of samples that changed since the build.
+    auto update(const HeightMap::Region &region) -> void;
+    auto set_origin(glm::vec3 origin) -> void;
+    auto get_origin() const -> glm::vec3;
+    auto is_built() const -> bool;
+
+    // Points off the map are clamped to its edges.
+    auto get_height(glm::vec2 point) const -> float;
+    auto get_normal(glm::vec2 point) const -> glm::vec3;
+    // Fills heights or normals in the same order as the points, reusing their storage.
+    auto get_heights(const Points &points, Heights &heights) const -> void;
+    auto get_normals(const Points &points, Normals &normals) const -> void;
+    auto raycast(glm::vec3 origin, glm::vec3 direction, float max_distance) const -> Hit;
+
+  private:
+    // Samples fit in 16 bits, so their bounds do too.
+    using Bound  = std::int16_t;
+    using Bounds = std::vector<Bound>;
+
+    // The bounds of each cell at one level, a cell covering 2^level quads a side.
+    struct Level {
+      int width  = 0;
+      int length = 0;
+      Bounds min = {};
+      Bounds max = {};
+    };
+
+    // The four samples around each of a block of points, and where in
+    // between them each point is.
+    struct Block {
+      using Lanes = float[LANES];
+
+      Lanes x0y0 = {};
+      Lanes x1y0 = {};
+      Lanes x0y1 = {};
+      Lanes x1y1 = {};
+      Lanes fx   = {};
+      Lanes fy   = {};
+    };
+
+    using Levels = std::vector<Level>;
+
+    const HeightMap *height_map = nullptr;
+    glm::vec3 origin            = {};
+    int width                   = 0;
+    int length                  = 0;
+    Levels levels               = {};
+
+    auto gather(const glm::vec2 *points, std::size_t count, Block &block) const -> void;
+    auto interpolate_heights(const glm::vec2 *points, std::size_t count, float *heights) const
+        -> void;
+    auto interpolate_normals(const glm::vec2 *points, std::size_t count,
+                             glm::vec3 *normals) const -> void;
+    auto get_sample(int x, int y) const -> float;
+    auto intersect_cell(glm::vec3 origin, glm::vec3 direction, int x, int y, float &distance,
+                        glm::vec3 &normal) const -> bool;
+  };
+}
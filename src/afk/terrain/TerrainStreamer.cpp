@@ -0,0 +1,486 @@
+#include "afk/terrain/TerrainStreamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <FastNoiseSIMD/FastNoiseSIMD.h>
+#include <glm/glm.hpp>
+
+#include "afk/Afk.hpp"
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/debug/Assert.hpp"
+#include "afk/io/ModelSource.hpp"
+#include "afk/physics/PhysicsBody.hpp"
+#include "afk/physics/RigidBodyType.hpp"
+#include "afk/renderer/Model.hpp"
+#include "afk/thread/JobSystem.hpp"
+
+using namespace std::string_literals;
+using std::size_t;
+
+using glm::ivec2;
+using glm::vec2;
+using glm::vec3;
+
+using Afk::HeightMap;
+using Afk::JobSystem;
+using Afk::Mesh;
+using Afk::TerrainStreamer;
+using Index = Mesh::Index;
+using Stats = Afk::TerrainStreamer::Stats;
+
+// Vertices along each side of a tile, and samples along each side of its
+// bordered heights.
+static constexpr auto TILE_VERTICES = size_t{TerrainStreamer::TILE_SIZE + 1};
+static constexpr auto TILE_SAMPLES  = TILE_VERTICES + 2;
+
+TerrainStreamer::~TerrainStreamer() {
+  // Tiles still being generated use the indices.
+  for (auto &[key, future] : this->pending) {
+    future.wait();
+  }
+}
+
+auto TerrainStreamer::initialize(vec3 _origin, float _roughness, float _scaling) -> void {
+  afk_assert(!this->is_initialized, "Terrain streamer already initialized");
+
+  this->origin    = _origin;
+  this->roughness = _roughness;
+  this->scaling   = _scaling;
+  // Every tile has the same topology, so they can all share one index layout.
+  this->indices        = TerrainStreamer::generate_indices();
+  this->is_initialized = true;
+}
+
+auto TerrainStreamer::update(vec3 camera_position) -> void {
+  // Released even when disabled, since disabling unloads every tile.
+  this->release_retired();
+
+  if (!this->is_enabled) {
+    return;
+  }
+
+  const auto offset = vec2{camera_position.x - this->origin.x, camera_position.z - this->origin.z};
+  this->center      = ivec2{glm::floor(offset / static_cast<float>(TILE_SIZE))};
+
+  // Tiles are only dropped a tile past the view radius, so hovering over a
+  // tile edge doesn't load and unload the same row every frame.
+  this->keys.clear();
+
+  for (const auto &[key, tile] : this->resident) {
+    if (!this->is_wanted(key)) {
+      this->keys.push_back(key);
+    }
+  }
+
+  for (const auto key : this->keys) {
+    this->unload(key);
+  }
+
+  this->collect_finished();
+  this->upload_finished();
+  this->request_missing();
+}
+
+auto TerrainStreamer::collect_finished() -> void {
+  using namespace std::chrono_literals;
+
+  this->keys.clear();
+
+  for (auto &[key, future] : this->pending) {
+    if (future.wait_for(0s) == std::future_status::ready) {
+      this->keys.push_back(key);
+    }
+  }
+
+  for (const auto key : this->keys) {
+    auto node = this->pending.extract(key);
+    // Rethrows anything thrown on a worker.
+    auto tile = node.mapped().get();
+
+    // The camera may have moved on while the tile was being generated.
+    if (this->is_wanted(key)) {
+      this->finished.emplace(key, std::move(tile));
+    } else {
+      this->cache_heights(key, std::move(tile.heights));
+    }
+  }
+}
+
+auto TerrainStreamer::upload_finished() -> void {
+  this->keys.clear();
+
+  for (const auto &[key, tile] : this->finished) {
+    this->keys.push_back(key);
+  }
+
+  // Closest first, so the ground under the camera is never waiting on the horizon.
+  std::sort(this->keys.begin(), this->keys.end(), [this](Key lhs, Key rhs) {
+    return this->get_distance(lhs) < this->get_distance(rhs);
+  });
+
+  const auto count = std::min(this->keys.size(), this->upload_budget);
+
+  for (auto i = size_t{0}; i < count; ++i) {
+    auto node = this->finished.extract(this->keys[i]);
+    this->upload(node.key(), std::move(node.mapped()));
+  }
+}
+
+auto TerrainStreamer::request_missing() -> void {
+  // Keep a couple of tiles queued per worker, so the queue never has to be
+  // drained of tiles the camera has since left behind.
+  const auto max_pending = JobSystem::get().get_worker_count() * 2;
+
+  if (this->pending.size() >= max_pending) {
+    return;
+  }
+
+  this->keys.clear();
+
+  for (auto y = -this->view_radius; y <= this->view_radius; ++y) {
+    for (auto x = -this->view_radius; x <= this->view_radius; ++x) {
+      const auto key = get_key(this->center + ivec2{x, y});
+
+      if (this->resident.count(key) == 0 && this->pending.count(key) == 0 &&
+          this->finished.count(key) == 0) {
+        this->keys.push_back(key);
+      }
+    }
+  }
+
+  std::sort(this->keys.begin(), this->keys.end(), [this](Key lhs, Key rhs) {
+    return this->get_distance(lhs) < this->get_distance(rhs);
+  });
+
+  for (const auto key : this->keys) {
+    if (this->pending.size() >= max_pending) {
+      break;
+    }
+
+    this->request(key);
+  }
+}
+
+auto TerrainStreamer::request(Key key) -> void {
+  const auto tile = get_tile(key);
+  auto heights    = this->take_cached(key);
+
+  // Polled each frame rather than waited on, so it's handed back through a
+  // future, which also keeps anything it throws from escaping the job.
+  auto task = std::make_shared<std::packaged_task<GeneratedTile()>>(
+      [this, tile, heights = std::move(heights), _roughness = this->roughness,
+       _scaling = this->scaling]() {
+        auto generated = GeneratedTile{};
+
+        // Cached tiles only need their mesh rebuilt.
+        generated.heights = heights != nullptr
+                                ? heights
+                                : std::make_shared<const Heights>(
+                                      generate_heights(tile, _roughness, _scaling));
+        generated.mesh = generate_mesh(*generated.heights, tile, this->indices);
+
+        return generated;
+      });
+
+  this->pending.emplace(key, task->get_future());
+  JobSystem::get().run([task]() { (*task)(); });
+}
+
+auto TerrainStreamer::upload(Key key, GeneratedTile tile) -> void {
+  auto &afk      = Engine::get();
+  auto &registry = afk.registry;
+
+  auto resident_tile    = ResidentTile{};
+  resident_tile.heights = std::move(tile.heights);
+
+  if (this->free_slots.empty()) {
+    resident_tile.slot = this->slots++;
+  } else {
+    resident_tile.slot = this->free_slots.back();
+    this->free_slots.pop_back();
+  }
+
+  auto model      = Model{};
+  model.file_path = get_model_path(resident_tile.slot);
+  model.file_dir  = "gen/terrain/tile";
+  model.meshes.push_back(std::move(tile.mesh));
+
+  ModelNode node;
+  node.mesh_ids.push_back(0);
+  model.nodes.push_back(std::move(node));
+  model.root_node_index = 0;
+
+  const auto model_path = model.file_path;
+  afk.renderer.load_model(std::move(model));
+  // Generated tiles have nothing on disk to be reloaded from.
+  afk.renderer.pin_model(Asset::AssetRegistry::get().intern(model_path));
+
+  const auto tile_origin = this->get_tile_origin(get_tile(key));
+
+  resident_tile.model_entity = registry.create();
+  auto model_transform        = Transform{resident_tile.model_entity};
+  model_transform.translation = tile_origin;
+  registry.assign<Transform>(resident_tile.model_entity, model_transform);
+  registry.assign<ModelSource>(resident_tile.model_entity, resident_tile.model_entity,
+                               model_path, "shader/terrain_tile.prog");
+
+  // Physics wants the heights without the border.
+  resident_tile.height_map        = std::make_unique<HeightMap>();
+  resident_tile.height_map->width = static_cast<int>(TILE_VERTICES);
+  resident_tile.height_map->heights.resize(TILE_VERTICES * TILE_VERTICES);
+
+  const auto sample = [&resident_tile](size_t i, size_t j) {
+    return resident_tile.heights->samples[(j + 1) * TILE_SAMPLES + i + 1];
+  };
+
+  auto min_height = std::numeric_limits<float>::max();
+  auto max_height = std::numeric_limits<float>::lowest();
+
+  for (auto j = size_t{0}; j < TILE_VERTICES; ++j) {
+    for (auto i = size_t{0}; i < TILE_VERTICES; ++i) {
+      min_height = std::min(min_height, sample(i, j));
+      max_height = std::max(max_height, sample(i, j));
+    }
+  }
+
+  auto &height_map = *resident_tile.height_map;
+  height_map.set_range(min_height, max_height);
+
+  for (auto j = size_t{0}; j < TILE_VERTICES; ++j) {
+    for (auto i = size_t{0}; i < TILE_VERTICES; ++i) {
+      height_map.heights[j * TILE_VERTICES + i] = height_map.quantize(sample(i, j));
+    }
+  }
+
+  // Height fields are centred on their body, so shift it to line up with the mesh.
+  const auto half_size = static_cast<float>(TILE_SIZE) / 2.0f;
+
+  resident_tile.body_entity  = registry.create();
+  auto body_transform        = Transform{resident_tile.body_entity};
+  body_transform.translation = tile_origin + vec3{half_size, height_map.offset, half_size};
+  registry.assign<Transform>(resident_tile.body_entity, body_transform);
+  registry.assign<PhysicsBody>(resident_tile.body_entity, resident_tile.body_entity,
+                               &afk.physics_body_system, body_transform, 0.3f, 0.0f, 0.0f,
+                               0.0f, true, RigidBodyType::STATIC, height_map);
+
+  this->resident.emplace(key, std::move(resident_tile));
+}
+
+auto TerrainStreamer::unload(Key key) -> void {
+  auto &afk      = Engine::get();
+  auto &registry = afk.registry;
+  auto node      = this->resident.extract(key);
+  auto &tile     = node.mapped();
+
+  // The model can't be unloaded while the entity still references it.
+  registry.destroy(tile.model_entity);
+  afk.physics_body_system.destroy(registry.get<PhysicsBody>(tile.body_entity));
+  registry.destroy(tile.body_entity);
+
+  // Packets taken up to this frame may still draw the model, so it and its
+  // slot are kept until they've been.
+  this->retired.push_back({afk.get_frame_count(), tile.slot});
+  this->cache_heights(key, std::move(tile.heights));
+}
+
+auto TerrainStreamer::unload_all() -> void {
+  this->keys.clear();
+
+  for (const auto &[key, tile] : this->resident) {
+    this->keys.push_back(key);
+  }
+
+  for (const auto key : this->keys) {
+    this->unload(key);
+  }
+
+  for (auto &[key, tile] : this->finished) {
+    this->cache_heights(key, std::move(tile.heights));
+  }
+
+  this->finished.clear();
+}
+
+auto TerrainStreamer::release_retired() -> void {
+  auto &renderer   = Engine::get().renderer;
+  const auto drawn = renderer.get_drawn_frame();
+
+  // Retired in order, so the oldest are first.
+  while (!this->retired.empty() && this->retired.front().frame < drawn) {
+    const auto slot = this->retired.front().slot;
+
+    renderer.unload_model(Asset::AssetRegistry::get().intern(get_model_path(slot)));
+    this->free_slots.push_back(slot);
+    this->retired.pop_front();
+  }
+}
+
+auto TerrainStreamer::cache_heights(Key key, std::shared_ptr<const Heights> heights) -> void {
+  if (this->cache_capacity == 0) {
+    return;
+  }
+
+  if (const auto entry = this->cache_map.find(key); entry != this->cache_map.end()) {
+    this->cache.erase(entry->second);
+    this->cache_map.erase(entry);
+  }
+
+  this->cache.push_front({key, std::move(heights)});
+  this->cache_map[key] = this->cache.begin();
+
+  while (this->cache.size() > this->cache_capacity) {
+    this->cache_map.erase(this->cache.back().key);
+    this->cache.pop_back();
+  }
+}
+
+auto TerrainStreamer::take_cached(Key key) -> std::shared_ptr<const Heights> {
+  const auto entry = this->cache_map.find(key);
+
+  if (entry == this->cache_map.end()) {
+    return nullptr;
+  }
+
+  auto heights = std::move(entry->second->heights);
+  this->cache.erase(entry->second);
+  this->cache_map.erase(entry);
+
+  return heights;
+}
+
+auto TerrainStreamer::is_wanted(Key key) const -> bool {
+  return this->get_distance(key) <= this->view_radius + 1;
+}
+
+auto TerrainStreamer::get_distance(Key key) const -> int {
+  const auto offset = glm::abs(get_tile(key) - this->center);
+
+  return std::max(offset.x, offset.y);
+}
+
+auto TerrainStreamer::get_tile_origin(ivec2 tile) const -> vec3 {
+  return this->origin + vec3{static_cast<float>(tile.x * TILE_SIZE), 0.0f,
+                             static_cast<float>(tile.y * TILE_SIZE)};
+}
+
+auto TerrainStreamer::set_enabled(bool enabled) -> void {
+  afk_assert(this->is_initialized, "Terrain streamer not initialized");
+
+  if (!enabled) {
+    this->unload_all();
+  }
+
+  this->is_enabled = enabled;
+}
+
+auto TerrainStreamer::get_enabled() const -> bool {
+  return this->is_enabled;
+}
+
+auto TerrainStreamer::get_stats() const -> Stats {
+  return {this->resident.size(), this->pending.size() + this->finished.size(), this->cache.size()};
+}
+
+auto TerrainStreamer::generate_heights(ivec2 tile, float roughness, float scaling) -> Heights {
+  // Laid out like TerrainManager's height map: rows run along the noise's x
+  // axis and the world's z axis.
+  auto noise = std::unique_ptr<FastNoiseSIMD>{FastNoiseSIMD::NewFastNoiseSIMD()};
+  noise->SetFrequency(roughness);
+
+  const auto samples = static_cast<int>(TILE_SAMPLES);
+  auto *noise_set    = noise->GetSimplexFractalSet(tile.y * TILE_SIZE - 1, 0,
+                                                tile.x * TILE_SIZE - 1, samples, 1, samples);
+
+  auto heights = Heights{};
+  heights.samples.resize(TILE_SAMPLES * TILE_SAMPLES);
+
+  for (auto i = size_t{0}; i < heights.samples.size(); ++i) {
+    heights.samples[i] = noise_set[i] * scaling;
+  }
+
+  FastNoiseSIMD::FreeNoiseSet(noise_set);
+
+  return heights;
+}
+
+auto TerrainStreamer::generate_mesh(const Heights &heights, ivec2 tile,
+                                    const Mesh::Indices &indices) -> Mesh {
+  const auto at = [&heights](size_t x, size_t y) {
+    return heights.samples[y * TILE_SAMPLES + x];
+  };
+
+  auto mesh = Mesh{};
+  mesh.vertices.resize(TILE_VERTICES * TILE_VERTICES);
+  mesh.indices = indices;
+
+  for (auto j = size_t{0}; j < TILE_VERTICES; ++j) {
+    auto *row = mesh.vertices.data() + j * TILE_VERTICES;
+
+    for (auto i = size_t{0}; i < TILE_VERTICES; ++i) {
+      // Offset by the border.
+      const auto x = i + 1;
+      const auto y = j + 1;
+
+      const auto grid = tile * TILE_SIZE + ivec2{static_cast<int>(i), static_cast<int>(j)};
+
+      row[i].position = vec3{static_cast<float>(i), at(x, y), static_cast<float>(j)};
+      row[i].uvs      = vec2{grid} / 2.0f;
+
+      // The border means every vertex gets central differences, so normals
+      // match on both sides of a tile edge.
+      const auto dx = (at(x + 1, y) - at(x - 1, y)) / 2.0f;
+      const auto dy = (at(x, y + 1) - at(x, y - 1)) / 2.0f;
+
+      row[i].normal    = glm::normalize(vec3{-dx, 1.0f, -dy});
+      row[i].tangent   = glm::normalize(vec3{row[i].normal.y, -row[i].normal.x, 0.0f});
+      row[i].bitangent = glm::cross(row[i].tangent, row[i].normal);
+    }
+  }
+
+  return mesh;
+}
+
+auto TerrainStreamer::generate_indices() -> Mesh::Indices {
+  constexpr auto n = TILE_VERTICES;
+
+  auto indices = Mesh::Indices((n - 1) * (n - 1) * 6);
+  auto *index  = indices.data();
+
+  for (auto j = size_t{0}; j < n - 1; ++j) {
+    for (auto i = size_t{0}; i < n - 1; ++i) {
+      const auto start = static_cast<Index>(j * n + i);
+
+      *index++ = start;
+      *index++ = start + 1;
+      *index++ = static_cast<Index>(start + n);
+
+      *index++ = start + 1;
+      *index++ = static_cast<Index>(start + 1 + n);
+      *index++ = static_cast<Index>(start + n);
+    }
+  }
+
+  return indices;
+}
+
+auto TerrainStreamer::get_key(ivec2 tile) -> Key {
+  return (static_cast<Key>(static_cast<std::uint32_t>(tile.x)) << 32) |
+         static_cast<Key>(static_cast<std::uint32_t>(tile.y));
+}
+
+auto TerrainStreamer::get_tile(Key key) -> ivec2 {
+  return {static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 32)),
+          static_cast<std::int32_t>(static_cast<std::uint32_t>(key))};
+}
+
+auto TerrainStreamer::get_model_path(size_t slot) -> std::string {
+  return "gen/terrain/tile/"s + std::to_string(slot);
+}
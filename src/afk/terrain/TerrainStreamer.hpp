@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "afk/component/GameObject.hpp"
+#include "afk/physics/shape/HeightMap.hpp"
+#include "afk/renderer/Mesh.hpp"
+
+namespace Afk {
+  /**
+   * Streams an endless terrain in square tiles around the camera.
+   *
+   * Missing tiles near the camera are generated as jobs, sampling
+   * the same noise as the terrain manager at each tile's world offset, so the
+   * streamed terrain lines up with the generated patch. Finished tiles are
+   * uploaded a few per frame, each with its own model and height field body.
+   * Tiles left behind are unloaded, and their heights kept in a fixed size LRU
+   * cache so coming back doesn't mean generating them again. Their models
+   * outlive them until every frame packet that could draw them has been.
+   *
+   * Everything a tile holds is released or recycled when it's unloaded, so
+   * memory use doesn't grow with the distance travelled.
+   */
+  class TerrainStreamer {
+  public:
+    // Quads along each side of a tile.
+    static constexpr auto TILE_SIZE = 128;
+
+    struct Stats {
+      std::size_t resident = 0;
+      std::size_t pending  = 0;
+      std::size_t cached   = 0;
+    };
+
+    // Tiles within this many tiles of the camera's are streamed in.
+    int view_radius = 3;
+    // Tiles uploaded per frame at most.
+    std::size_t upload_budget = 2;
+    // Unloaded tiles whose heights are kept around.
+    std::size_t cache_capacity = 64;
+
+    TerrainStreamer()                        = default;
+    ~TerrainStreamer();
+    TerrainStreamer(TerrainStreamer &&)      = delete;
+    TerrainStreamer(const TerrainStreamer &) = delete;
+    auto operator=(const TerrainStreamer &) -> TerrainStreamer & = delete;
+    auto operator=(TerrainStreamer &&) -> TerrainStreamer & = delete;
+
+    /**
+     * Sets up the noise, matching TerrainManager::generate_terrain. The
+     * origin is where the terrain manager's first height sample ends up in
+     * the world.
+     */
+    auto initialize(glm::vec3 origin, float roughness, float scaling) -> void;
+    auto update(glm::vec3 camera_position) -> void;
+    auto set_enabled(bool enabled) -> void;
+    auto get_enabled() const -> bool;
+    auto get_stats() const -> Stats;
+
+  private:
+    using Key = std::uint64_t;
+
+    // Heights with a one sample border, so normals match across tile edges.
+    struct Heights {
+      std::vector<float> samples = {};
+    };
+
+    struct GeneratedTile {
+      std::shared_ptr<const Heights> heights = {};
+      Mesh mesh                              = {};
+    };
+
+    struct ResidentTile {
+      std::shared_ptr<const Heights> heights = {};
+      // Referenced by the physics body, so it mustn't move while resident.
+      std::unique_ptr<HeightMap> height_map = {};
+      GameObject model_entity               = {};
+      GameObject body_entity                = {};
+      std::size_t slot                      = 0;
+    };
+
+    // A tile's model and slot, released once frames after it are drawn.
+    struct RetiredTile {
+      std::size_t frame = 0;
+      std::size_t slot  = 0;
+    };
+
+    struct CachedTile {
+      Key key                                = 0;
+      std::shared_ptr<const Heights> heights = {};
+    };
+
+    using Pending  = std::unordered_map<Key, std::future<GeneratedTile>>;
+    using Finished = std::unordered_map<Key, GeneratedTile>;
+    using Resident = std::unordered_map<Key, ResidentTile>;
+    using Retired  = std::deque<RetiredTile>;
+    using Cache    = std::list<CachedTile>;
+    using CacheMap = std::unordered_map<Key, Cache::iterator>;
+    using Keys     = std::vector<Key>;
+    using Slots    = std::vector<std::size_t>;
+
+    bool is_initialized   = false;
+    bool is_enabled       = false;
+    glm::vec3 origin      = {};
+    float roughness       = 0.0f;
+    float scaling         = 0.0f;
+    glm::ivec2 center     = {};
+    Pending pending       = {};
+    Finished finished     = {};
+    Resident resident     = {};
+    Retired retired       = {};
+    Cache cache           = {};
+    CacheMap cache_map    = {};
+    Keys keys             = {};
+    // Tiles reuse the model paths of unloaded ones, so asset IDs don't pile up.
+    Slots free_slots      = {};
+    std::size_t slots     = 0;
+    Mesh::Indices indices = {};
+
+    auto collect_finished() -> void;
+    auto upload_finished() -> void;
+    auto request_missing() -> void;
+    auto request(Key key) -> void;
+    auto upload(Key key, GeneratedTile tile) -> void;
+    auto unload(Key key) -> void;
+    auto unload_all() -> void;
+    auto release_retired() -> void;
+    auto cache_heights(Key key, std::shared_ptr<const Heights> heights) -> void;
+    auto take_cached(Key key) -> std::shared_ptr<const Heights>;
+    auto is_wanted(Key key) const -> bool;
+    auto get_distance(Key key) const -> int;
+    auto get_tile_origin(glm::ivec2 tile) const -> glm::vec3;
+
+    static auto generate_heights(glm::ivec2 tile, float roughness, float scaling) -> Heights;
+    static auto generate_mesh(const Heights &heights, glm::ivec2 tile,
+                              const Mesh::Indices &indices) -> Mesh;
+    static auto generate_indices() -> Mesh::Indices;
+    static auto get_key(glm::ivec2 tile) -> Key;
+    static auto get_tile(Key key) -> glm::ivec2;
+    static auto get_model_path(std::size_t slot) -> std::string;
+  };
+}
@@ -0,0 +1,340 @@
+#include "afk/thread/JobSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "afk/debug/Assert.hpp"
+#include "afk/thread/ThreadPool.hpp"
+
+using std::size_t;
+
+using Afk::JobSystem;
+
+// The job system the calling thread works for, if any, and which worker it
+// is there, counting from 1.
+static thread_local const JobSystem *current_system = nullptr;
+static thread_local auto current_index              = size_t{0};
+
+// Threads that can't help sleep here until the counter they wait on is
+// done. A counter can be gone as soon as it's seen done, so they're woken
+// through something that outlives it.
+static auto finished_mutex    = std::mutex{};
+static auto finished          = std::condition_variable{};
+static auto finished_sleepers = std::atomic<size_t>{0};
+
+auto JobSystem::Counter::add(size_t count) -> void {
+  this->count.fetch_add(count, std::memory_order_relaxed);
+}
+
+auto JobSystem::Counter::done() -> void {
+  // Counted down before checking for sleepers, so either a sleeper's seen
+  // here, or it sees the counter done.
+  if (this->count.fetch_sub(1) == 1 && finished_sleepers.load() > 0) {
+    { const auto lock = std::scoped_lock{finished_mutex}; }
+
+    finished.notify_all();
+  }
+}
+
+auto JobSystem::Counter::fail(std::exception_ptr error) -> void {
+  const auto lock = std::scoped_lock{this->error_mutex};
+
+  if (this->error == nullptr) {
+    this->error = std::move(error);
+  }
+}
+
+auto JobSystem::Counter::is_done() const -> bool {
+  return this->count.load(std::memory_order_acquire) == 0;
+}
+
+auto JobSystem::get() -> JobSystem & {
+  static auto instance = JobSystem{};
+
+  return instance;
+}
+
+auto JobSystem::default_worker_count() -> size_t {
+  // The main thread works too, while it waits.
+  return ThreadPool::default_thread_count();
+}
+
+JobSystem::JobSystem(size_t worker_count) {
+  worker_count      = std::max(size_t{1}, worker_count);
+  this->main_thread = std::this_thread::get_id();
+
+  for (auto i = size_t{0}; i < worker_count; ++i) {
+    this->workers.push_back(std::make_unique<Worker>());
+  }
+
+  // Only started once every queue exists, since they steal from each other.
+  for (auto i = size_t{0}; i < worker_count; ++i) {
+    this->threads.emplace_back([this, i]() { this->work(i); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    const auto lock = std::scoped_lock{this->sleep_mutex};
+    this->is_stopping.store(true);
+  }
+
+  this->wake.notify_all();
+
+  for (auto &thread : this->threads) {
+    thread.join();
+  }
+}
+
+auto JobSystem::run(Job job, Counter *counter) -> void {
+  if (counter != nullptr) {
+    counter->add();
+    job = [this, job = std::move(job), counter]() { this->finish(job, *counter); };
+  }
+
+  // Workers keep their own jobs, everyone else deals them out.
+  const auto worker =
+      current_system == this
+          ? current_index - 1
+          : this->next_worker.fetch_add(1, std::memory_order_relaxed) % this->workers.size();
+
+  this->push(worker, std::move(job));
+}
+
+auto JobSystem::run_on_main(Job job, Counter *counter) -> void {
+  if (counter != nullptr) {
+    counter->add();
+    job = [this, job = std::move(job), counter]() { this->finish(job, *counter); };
+  }
+
+  const auto lock = std::scoped_lock{this->main_mutex};
+  this->main_jobs.push_back(std::move(job));
+}
+
+auto JobSystem::wait(Counter &counter) -> void {
+  const auto index   = current_system == this ? current_index : size_t{0};
+  const auto is_main = this->is_main_thread();
+  auto job           = Job{};
+
+  // Other threads, like the physics thread, could be holding locks the
+  // jobs they'd pick up want, so they sleep until the counter's done.
+  if (!is_main && index == 0) {
+    auto lock = std::unique_lock{finished_mutex};
+
+    finished_sleepers.fetch_add(1);
+    finished.wait(lock, [&counter]() { return counter.count.load() == 0; });
+    finished_sleepers.fetch_sub(1);
+  }
+
+  while (!counter.is_done()) {
+    if ((is_main && this->pop_main(job)) || (index > 0 && this->pop(index - 1, job)) ||
+        this->steal(index, job)) {
+      job();
+      job = nullptr;
+    } else {
+      // Whatever's left is already running somewhere.
+      std::this_thread::yield();
+    }
+  }
+
+  const auto lock = std::scoped_lock{counter.error_mutex};
+
+  if (counter.error != nullptr) {
+    std::rethrow_exception(std::exchange(counter.error, nullptr));
+  }
+}
+
+auto JobSystem::run_main_jobs() -> void {
+  afk_assert(this->is_main_thread(), "Main thread jobs run on the main thread");
+
+  auto job = Job{};
+
+  while (this->pop_main(job)) {
+    job();
+    job = nullptr;
+  }
+}
+
+auto JobSystem::get_worker_count() const -> size_t {
+  return this->workers.size();
+}
+
+auto JobSystem::get_thread_index() const -> size_t {
+  return current_system == this ? current_index : size_t{0};
+}
+
+auto JobSystem::is_main_thread() const -> bool {
+  return std::this_thread::get_id() == this->main_thread;
+}
+
+auto JobSystem::work(size_t index) -> void {
+  current_system = this;
+  current_index  = index + 1;
+
+  auto job = Job{};
+
+  while (true) {
+    if (this->pop(index, job) || this->steal(index + 1, job)) {
+      job();
+      job = nullptr;
+      continue;
+    }
+
+    auto lock = std::unique_lock{this->sleep_mutex};
+
+    // Counted before checking, so a push either sees a sleeper to wake, or
+    // is seen here.
+    this->sleepers.fetch_add(1);
+    this->wake.wait(
+        lock, [this]() { return this->is_stopping.load() || this->queued.load() > 0; });
+    this->sleepers.fetch_sub(1);
+
+    // Drain what's left before stopping, so no counter's left waiting.
+    if (this->is_stopping.load() && this->queued.load() == 0) {
+      return;
+    }
+  }
+}
+
+auto JobSystem::push(size_t worker, Job job) -> void {
+  {
+    auto &queue     = *this->workers[worker];
+    const auto lock = std::scoped_lock{queue.mutex};
+    queue.jobs.push_back(std::move(job));
+  }
+
+  this->queued.fetch_add(1);
+
+  // Only worth taking the lock when someone might be asleep.
+  if (this->sleepers.load() > 0) {
+    { const auto lock = std::scoped_lock{this->sleep_mutex}; }
+
+    this->wake.notify_one();
+  }
+}
+
+auto JobSystem::pop(size_t worker, Job &job) -> bool {
+  auto &queue     = *this->workers[worker];
+  const auto lock = std::scoped_lock{queue.mutex};
+
+  if (queue.jobs.empty()) {
+    return false;
+  }
+
+  job = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  this->queued.fetch_sub(1);
+
+  return true;
+}
+
+auto JobSystem::steal(size_t thief, Job &job) -> bool {
+  const auto count = this->workers.size();
+
+  // Starting from the next worker along, so thieves spread out.
+  for (auto i = size_t{0}; i < count; ++i) {
+    auto &queue = *this->workers[(thief + i) % count];
+    auto lock   = std::unique_lock{queue.mutex, std::try_to_lock};
+
+    if (!lock.owns_lock() || queue.jobs.empty()) {
+      continue;
+    }
+
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    this->queued.fetch_sub(1);
+
+    return true;
+  }
+
+  return false;
+}
+
+auto JobSystem::pop_main(Job &job) -> bool {
+  const auto lock = std::scoped_lock{this->main_mutex};
+
+  if (this->main_jobs.empty()) {
+    return false;
+  }
+
+  job = std::move(this->main_jobs.front());
+  this->main_jobs.pop_front();
+
+  return true;
+}
+
+auto JobSystem::finish(const Job &job, Counter &counter) -> void {
+  try {
+    job();
+  } catch (...) {
+    counter.fail(std::current_exception());
+  }
+
+  counter.done();
+}
+
+auto JobSystem::get_chunk_size(size_t count, size_t grain) const -> size_t {
+  afk_assert(grain > 0, "Grain must be positive");
+
+  const auto chunks = (this->workers.size() + 1) * CHUNKS_PER_THREAD;
+  const auto chunk  = std::max((count + chunks - 1) / chunks, grain);
+
+  return (chunk + grain - 1) / grain * grain;
+}
+
+auto JobSystem::measure_overhead(size_t count) -> double {
+  auto jobs    = JobSystem{};
+  auto counter = Counter{};
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (auto i = size_t{0}; i < count; ++i) {
+    jobs.run([]() {}, &counter);
+  }
+
+  jobs.wait(counter);
+
+  const auto elapsed =
+      std::chrono::duration<double, std::nano>{std::chrono::steady_clock::now() - start};
+
+  return count > 0 ? elapsed.count() / static_cast<double>(count) : 0.0;
+}
+
+auto JobSystem::measure_scaling(size_t count, size_t worker_count) -> double {
+  auto values = std::vector<float>(count);
+
+  const auto loop = [&values](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      auto value = static_cast<float>(i);
+
+      for (auto step = 0; step < 64; ++step) {
+        value = std::sqrt(value * value + 1.0f) * 0.5f + std::sin(value);
+      }
+
+      values[i] = value;
+    }
+  };
+
+  // Without workers, it's just the loop, as a baseline.
+  if (worker_count == 0) {
+    const auto start = std::chrono::steady_clock::now();
+
+    loop(0, count);
+
+    return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+  }
+
+  auto jobs        = JobSystem{worker_count};
+  const auto start = std::chrono::steady_clock::now();
+
+  jobs.parallel_for(count, loop);
+
+  return std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "afk/component/GameObject.hpp"
+
+namespace Afk {
+  /**
+   * Runs short jobs on a worker per core, for anything in the engine that
+   * can be split up.
+   *
+   * Every worker has a queue of its own. Jobs queued from a worker go on its
+   * own queue, and it takes the newest first, while they're still in cache.
+   * Workers that run out steal the oldest from the others, which are the
+   * biggest pieces of work left. Jobs queued from other threads are dealt
+   * out to the workers in turn.
+   *
+   * Jobs are waited on through counters, which count the jobs queued with
+   * them that haven't finished. Workers and the main thread run other jobs
+   * while they wait on a counter, so jobs can queue and wait on jobs of
+   * their own. Any other thread sleeps until the counter's done.
+   * Anything a job throws is rethrown from the wait, once the rest of its
+   * counter's jobs have finished. Jobs queued without a counter mustn't
+   * throw.
+   *
+   * GL and GLFW can only be used from the main thread, which is whichever
+   * thread first gets the job system, so jobs that use them are queued for
+   * the main thread. It runs them while it waits on a counter, or when it
+   * runs them itself.
+   */
+  class JobSystem {
+  public:
+    using Job = std::function<void()>;
+
+    // Items in a parallel loop's chunk, unless they're big enough on their
+    // own to be worth queueing.
+    static constexpr auto MIN_CHUNK = std::size_t{64};
+    // Loops are split into about this many chunks per thread, so threads
+    // that finish early can steal what's left of the others'.
+    static constexpr auto CHUNKS_PER_THREAD = std::size_t{4};
+
+    class Counter {
+    public:
+      auto add(std::size_t count = 1) -> void;
+      // Marks one of the counted jobs finished.
+      auto done() -> void;
+      // Keeps the first thing any of the counted jobs threw, for the wait.
+      auto fail(std::exception_ptr error) -> void;
+      auto is_done() const -> bool;
+
+    private:
+      std::atomic<std::size_t> count = {0};
+      std::mutex error_mutex         = {};
+      std::exception_ptr error       = {};
+
+      friend class JobSystem;
+    };
+
+    static auto get() -> JobSystem &;
+
+    explicit JobSystem(std::size_t worker_count = JobSystem::default_worker_count());
+    ~JobSystem();
+    JobSystem(JobSystem &&)      = delete;
+    JobSystem(const JobSystem &) = delete;
+    auto operator=(const JobSystem &) -> JobSystem & = delete;
+    auto operator=(JobSystem &&) -> JobSystem & = delete;
+
+    /**
+     * Queues a job for any worker, counted by counter if it isn't null.
+     */
+    auto run(Job job, Counter *counter = nullptr) -> void;
+
+    /**
+     * Queues a job for the main thread, counted by counter if it isn't null.
+     */
+    auto run_on_main(Job job, Counter *counter = nullptr) -> void;
+
+    /**
+     * Runs jobs until every job counted by counter has finished, or sleeps
+     * on a thread that isn't a worker or the main thread, then rethrows the
+     * first thing any of them threw.
+     */
+    auto wait(Counter &counter) -> void;
+
+    // Runs every job queued for the main thread. Must be called from it.
+    auto run_main_jobs() -> void;
+
+    /**
+     * Calls f(begin, end) for chunks of [0, count) in parallel, returning
+     * once they've all finished. Chunks are multiples of grain, so they can
+     * be lined up with cache lines or vector lanes. Pass 1 for items that
+     * are big pieces of work on their own.
+     */
+    template<typename F>
+    auto parallel_for(std::size_t count, F &&f, std::size_t grain = MIN_CHUNK) -> void {
+      if (count == 0) {
+        return;
+      }
+
+      const auto chunk = this->get_chunk_size(count, grain);
+
+      // Small loops aren't worth the trip through the queues.
+      if (chunk >= count) {
+        f(std::size_t{0}, count);
+        return;
+      }
+
+      auto counter = Counter{};
+
+      for (auto begin = chunk; begin < count; begin += chunk) {
+        const auto end = std::min(begin + chunk, count);
+
+        this->run([&f, begin, end]() { f(begin, end); }, &counter);
+      }
+
+      // The first chunk's done here, rather than waiting on someone else to.
+      counter.add();
+      this->finish([&f, chunk]() { f(std::size_t{0}, chunk); }, counter);
+      this->wait(counter);
+    }
+
+    /**
+     * Calls f(entity) for every entity in an entt view, in parallel. The
+     * entities are gathered first, so the view's components must only be
+     * read or written, never added or removed, until it returns.
+     */
+    template<typename View, typename F>
+    auto parallel_for_each(View &view, F &&f) -> void {
+      auto entities = std::vector<GameObject>(view.begin(), view.end());
+
+      this->parallel_for(entities.size(), [&entities, &f](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+          f(entities[i]);
+        }
+      });
+    }
+
+    auto get_worker_count() const -> std::size_t;
+    // 0 for the main thread, or any other thread that isn't a worker.
+    auto get_thread_index() const -> std::size_t;
+    auto is_main_thread() const -> bool;
+
+    static auto default_worker_count() -> std::size_t;
+
+    /**
+     * Returns how many nanoseconds queueing, running and waiting on each of
+     * count empty jobs takes, across every worker.
+     */
+    static auto measure_overhead(std::size_t count) -> double;
+    /**
+     * Returns how many seconds a parallel loop over count items of busy work
+     * takes with worker_count workers, besides the calling thread. With no
+     * workers, the loop's run as is.
+     */
+    static auto measure_scaling(std::size_t count, std::size_t worker_count) -> double;
+
+  private:
+    struct Worker {
+      std::deque<Job> jobs = {};
+      std::mutex mutex     = {};
+    };
+
+    auto work(std::size_t index) -> void;
+    auto push(std::size_t worker, Job job) -> void;
+    auto pop(std::size_t worker, Job &job) -> bool;
+    auto steal(std::size_t thief, Job &job) -> bool;
+    auto pop_main(Job &job) -> bool;
+    auto finish(const Job &job, Counter &counter) -> void;
+    auto get_chunk_size(std::size_t count, std::size_t grain) const -> std::size_t;
+
+    std::vector<std::unique_ptr<Worker>> workers = {};
+    std::vector<std::thread> threads             = {};
+    std::thread::id main_thread                  = {};
+    std::atomic<std::size_t> next_worker         = {0};
+
+    std::deque<Job> main_jobs = {};
+    std::mutex main_mutex     = {};
+
+    // Jobs queued and not yet taken, and workers asleep waiting on them.
+    std::atomic<std::size_t> queued   = {0};
+    std::atomic<std::size_t> sleepers = {0};
+    std::mutex sleep_mutex            = {};
+    std::condition_variable wake      = {};
+    std::atomic<bool> is_stopping     = {false};
+  };
+}
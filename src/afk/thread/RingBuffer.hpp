@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Afk {
+  /**
+   * A fixed size queue passing values from one thread to another without
+   * locking. Only one thread may push, and only one may pop, at a time.
+   */
+  template<typename T, std::size_t N>
+  class RingBuffer {
+  public:
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring buffer size must be a power of two");
+
+    // Returns false, leaving the buffer as it was, if it's full.
+    auto push(const T &value) -> bool {
+      const auto last = this->tail.load(std::memory_order_relaxed);
+
+      if (last - this->head.load(std::memory_order_acquire) == N) {
+        return false;
+      }
+
+      this->values[last & (N - 1)] = value;
+      this->tail.store(last + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Returns false, leaving value as it was, if the buffer's empty.
+    auto pop(T &value) -> bool {
+      const auto first = this->head.load(std::memory_order_relaxed);
+
+      if (first == this->tail.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      value = this->values[first & (N - 1)];
+      this->head.store(first + 1, std::memory_order_release);
+
+      return true;
+    }
+
+  private:
+    std::array<T, N> values = {};
+    // Kept on separate cache lines, so each side only writes its own.
+    alignas(64) std::atomic<std::size_t> head = {0};
+    alignas(64) std::atomic<std::size_t> tail = {0};
+  };
+}
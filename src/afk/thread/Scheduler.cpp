@@ -0,0 +1,194 @@
+#include "afk/thread/Scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+#include "afk/debug/Assert.hpp"
+
+using std::size_t;
+
+using Afk::Scheduler;
+
+static auto overlaps(const std::vector<std::type_index> &lhs,
+                     const std::vector<std::type_index> &rhs) -> bool {
+  return std::any_of(lhs.begin(), lhs.end(), [&rhs](const auto &type) {
+    return std::find(rhs.begin(), rhs.end(), type) != rhs.end();
+  });
+}
+
+auto Scheduler::Access::on_main_thread() -> Access & {
+  this->is_main_thread = true;
+
+  return *this;
+}
+
+auto Scheduler::Access::is_exclusive() const -> bool {
+  const auto registry = std::type_index{typeid(entt::registry)};
+
+  return std::find(this->write_types.begin(), this->write_types.end(), registry) !=
+         this->write_types.end();
+}
+
+auto Scheduler::Access::is_conflicting(const Access &other) const -> bool {
+  // Main thread systems run one at a time anyway, so keeping them in order
+  // costs nothing.
+  if (this->is_main_thread && other.is_main_thread) {
+    return true;
+  }
+
+  if (this->is_exclusive() || other.is_exclusive()) {
+    return true;
+  }
+
+  return overlaps(this->write_types, other.write_types) ||
+         overlaps(this->write_types, other.read_types) ||
+         overlaps(this->read_types, other.write_types);
+}
+
+auto Scheduler::add(std::string name, Access access, System system) -> void {
+  auto node   = Node{};
+  node.name   = std::move(name);
+  node.access = std::move(access);
+  node.system = std::move(system);
+
+  this->nodes.push_back(std::move(node));
+  this->is_built = false;
+}
+
+auto Scheduler::build() -> void {
+  for (auto &node : this->nodes) {
+    node.out.clear();
+    node.dependencies = 0;
+  }
+
+  // Every conflicting pair gets an edge. Most are implied by others, but
+  // there's only a handful of systems.
+  for (auto i = size_t{0}; i < this->nodes.size(); ++i) {
+    for (auto j = size_t{0}; j < i; ++j) {
+      if (this->nodes[i].access.is_conflicting(this->nodes[j].access)) {
+        this->nodes[j].out.push_back(i);
+        ++this->nodes[i].dependencies;
+      }
+    }
+  }
+
+  this->waiting  = std::make_unique<std::atomic<size_t>[]>(this->nodes.size());
+  this->is_built = true;
+}
+
+auto Scheduler::run(entt::registry *registry) -> void {
+  this->start(registry);
+  this->finish();
+}
+
+auto Scheduler::start(entt::registry *registry) -> void {
+  afk_assert(!this->is_running, "Systems are already running");
+
+  if (!this->is_built) {
+    this->build();
+
+    for (const auto &node : this->nodes) {
+      for (const auto &prepare : node.access.prepares) {
+        prepare(*registry);
+      }
+    }
+  }
+
+  if (this->nodes.empty()) {
+    return;
+  }
+
+  auto &jobs = JobSystem::get();
+
+  afk_assert(jobs.is_main_thread(), "Systems are run from the main thread");
+
+  this->started    = Clock::now();
+  this->is_running = true;
+  this->timeline.spans.resize(this->nodes.size());
+  this->timeline.lanes = jobs.get_worker_count() + 1;
+
+  for (auto i = size_t{0}; i < this->nodes.size(); ++i) {
+    this->waiting[i].store(this->nodes[i].dependencies, std::memory_order_relaxed);
+  }
+
+  // Every system's counted up front, since most are only queued once the
+  // ones they wait on finish.
+  this->frame.add(this->nodes.size());
+
+  for (auto i = size_t{0}; i < this->nodes.size(); ++i) {
+    if (this->nodes[i].dependencies == 0) {
+      this->dispatch(i);
+    }
+  }
+}
+
+auto Scheduler::finish() -> void {
+  if (!this->is_running) {
+    return;
+  }
+
+  this->is_running = false;
+
+  // Runs main thread systems as they become ready, and anything else there
+  // is in the meantime. Anything a system threw is rethrown here, once the
+  // rest have finished.
+  JobSystem::get().wait(this->frame);
+
+  this->timeline.duration =
+      std::chrono::duration<double, std::milli>{Clock::now() - this->started}.count();
+}
+
+auto Scheduler::dispatch(size_t node) -> void {
+  auto &jobs = JobSystem::get();
+  auto job   = [this, node]() { this->execute(node); };
+
+  // Not counted by the frame's counter, which already counts every system.
+  if (this->nodes[node].access.is_main_thread) {
+    jobs.run_on_main(job);
+  } else {
+    jobs.run(job);
+  }
+}
+
+auto Scheduler::execute(size_t node) -> void {
+  auto &span  = this->timeline.spans[node];
+  span.system = node;
+  span.lane   = JobSystem::get().get_thread_index();
+  span.start  = std::chrono::duration<double, std::milli>{Clock::now() - this->started}.count();
+
+  // A system that throws still finishes, so the frame isn't left waiting on
+  // the systems after it.
+  try {
+    this->nodes[node].system();
+  } catch (...) {
+    this->frame.fail(std::current_exception());
+  }
+
+  span.end = std::chrono::duration<double, std::milli>{Clock::now() - this->started}.count();
+
+  for (const auto next : this->nodes[node].out) {
+    if (this->waiting[next].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      this->dispatch(next);
+    }
+  }
+
+  this->frame.done();
+}
+
+auto Scheduler::get_name(size_t system) const -> const std::string & {
+  afk_assert(system < this->nodes.size(), "Invalid system");
+
+  return this->nodes[system].name;
+}
+
+auto Scheduler::get_timeline() const -> const Timeline & {
+  return this->timeline;
+}
+
+auto Scheduler::get_thread_count() const -> size_t {
+  return JobSystem::get().get_worker_count() + 1;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "afk/thread/JobSystem.hpp"
+
+namespace Afk {
+  /**
+   * Runs the engine's systems once a frame, alongside each other wherever
+   * they can be.
+   *
+   * Every system declares what it reads and writes: components by type, and
+   * anything else they share, like the event manager or the renderer, by its
+   * type too. A system waits on every system added before it that writes
+   * something it touches, or touches something it writes, and on nothing
+   * else. Systems writing the registry itself create and destroy entities
+   * and components, so they wait on, and are waited on by, every other.
+   *
+   * Systems touching GL, GLFW or the Lua state run on the main thread, as
+   * soon as they're ready. The rest are jobs for any of the job system's
+   * workers. The order is only worked out again when systems are added, not
+   * every frame.
+   *
+   * Each frame's start and end times for every system, and the thread they
+   * ran on, are kept as a timeline for the UI.
+   */
+  class Scheduler {
+  public:
+    using System = std::function<void()>;
+    using Clock  = std::chrono::steady_clock;
+
+    // What a system touches.
+    class Access {
+    public:
+      template<typename... Components>
+      auto reads() -> Access & {
+        (this->reads_type<Components>(true), ...);
+
+        return *this;
+      }
+
+      template<typename... Components>
+      auto writes() -> Access & {
+        (this->writes_type<Components>(true), ...);
+
+        return *this;
+      }
+
+      // Shared things that aren't components.
+      template<typename... Resources>
+      auto reads_resource() -> Access & {
+        (this->reads_type<Resources>(false), ...);
+
+        return *this;
+      }
+
+      template<typename... Resources>
+      auto writes_resource() -> Access & {
+        (this->writes_type<Resources>(false), ...);
+
+        return *this;
+      }
+
+      auto on_main_thread() -> Access &;
+
+    private:
+      using Types   = std::vector<std::type_index>;
+      using Prepare = std::function<void(entt::registry &)>;
+
+      Types read_types              = {};
+      Types write_types             = {};
+      bool is_main_thread           = false;
+      std::vector<Prepare> prepares = {};
+
+      template<typename T>
+      auto reads_type(bool is_component) -> void {
+        this->read_types.emplace_back(typeid(T));
+        this->prepare<T>(is_component);
+      }
+
+      template<typename T>
+      auto writes_type(bool is_component) -> void {
+        this->write_types.emplace_back(typeid(T));
+        this->prepare<T>(is_component);
+      }
+
+      // A component's pool is made the first time it's viewed, which changes
+      // the registry, so they're all made before systems run alongside each
+      // other.
+      template<typename T>
+      auto prepare(bool is_component) -> void {
+        if (is_component) {
+          this->prepares.emplace_back([](entt::registry &registry) { registry.view<T>(); });
+        }
+      }
+
+      auto is_exclusive() const -> bool;
+      auto is_conflicting(const Access &other) const -> bool;
+
+      friend class Scheduler;
+    };
+
+    // When a system ran last frame, in milliseconds since the frame started.
+    struct Span {
+      std::size_t system = 0;
+      // 0 is the main thread.
+      std::size_t lane = 0;
+      double start     = 0.0;
+      double end       = 0.0;
+    };
+
+    struct Timeline {
+      std::vector<Span> spans = {};
+      double duration         = 0.0;
+      std::size_t lanes       = 1;
+    };
+
+    Scheduler()                  = default;
+    ~Scheduler()                 = default;
+    Scheduler(Scheduler &&)      = delete;
+    Scheduler(const Scheduler &) = delete;
+    auto operator=(const Scheduler &) -> Scheduler & = delete;
+    auto operator=(Scheduler &&) -> Scheduler & = delete;
+
+    /**
+     * Adds a system to be run every frame. Systems are ordered by their
+     * declared access, ties going to whichever was added first.
+     */
+    auto add(std::string name, Access access, System system) -> void;
+
+    /**
+     * Runs every system once, returning when they've all finished. Must be
+     * called from the main thread. Anything a system throws is rethrown
+     * here, once the rest have finished.
+     */
+    auto run(entt::registry *registry) -> void;
+
+    /**
+     * Starts running every system once, leaving the main thread free until
+     * finish is called. Main thread systems only run when it runs the job
+     * system's main thread jobs, or waits in finish.
+     */
+    auto start(entt::registry *registry) -> void;
+
+    /**
+     * Waits for the systems started to finish, running main thread systems
+     * and helping with the rest meanwhile. Anything a system threw is
+     * rethrown here.
+     */
+    auto finish() -> void;
+
+    auto get_name(std::size_t system) const -> const std::string &;
+    auto get_timeline() const -> const Timeline &;
+    auto get_thread_count() const -> std::size_t;
+
+  private:
+    struct Node {
+      std::string name             = {};
+      Access access                = {};
+      System system                = {};
+      std::vector<std::size_t> out = {};
+      std::size_t dependencies     = 0;
+    };
+
+    auto build() -> void;
+    auto dispatch(std::size_t node) -> void;
+    auto execute(std::size_t node) -> void;
+
+    std::vector<Node> nodes   = {};
+    bool is_built             = false;
+    Timeline timeline         = {};
+    Clock::time_point started = {};
+    bool is_running           = false;
+
+    // Dependencies each node's still waiting on this frame, and the systems
+    // that haven't finished.
+    std::unique_ptr<std::atomic<std::size_t>[]> waiting = {};
+    JobSystem::Counter frame                            = {};
+  };
+}
@@ -0,0 +1,64 @@
+#include "afk/thread/ThreadPool.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using std::size_t;
+
+using Afk::ThreadPool;
+
+auto ThreadPool::default_thread_count() -> size_t {
+  // Leave a core free for the main thread.
+  const auto hardware_threads = static_cast<size_t>(std::thread::hardware_concurrency());
+
+  return std::max(size_t{1}, hardware_threads > 1 ? hardware_threads - 1 : size_t{1});
+}
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  num_threads = std::max(size_t{1}, num_threads);
+  this->threads.reserve(num_threads);
+
+  for (auto i = size_t{0}; i < num_threads; ++i) {
+    this->threads.emplace_back([this]() { this->work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock         = std::scoped_lock{this->mutex};
+    this->is_stopping = true;
+  }
+
+  this->condition.notify_all();
+
+  for (auto &thread : this->threads) {
+    thread.join();
+  }
+}
+
+auto ThreadPool::get_thread_count() const -> size_t {
+  return this->threads.size();
+}
+
+auto ThreadPool::work() -> void {
+  while (true) {
+    auto task = Task{};
+
+    {
+      auto lock = std::unique_lock{this->mutex};
+      this->condition.wait(lock, [this]() { return this->is_stopping || !this->tasks.empty(); });
+
+      // Drain the remaining tasks before stopping so no future is left unsatisfied.
+      if (this->is_stopping && this->tasks.empty()) {
+        return;
+      }
+
+      task = std::move(this->tasks.front());
+      this->tasks.pop();
+    }
+
+    task();
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Afk {
+  class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    static auto default_thread_count() -> std::size_t;
+
+    explicit ThreadPool(std::size_t num_threads = ThreadPool::default_thread_count());
+    ~ThreadPool();
+    ThreadPool(ThreadPool &&)      = delete;
+    ThreadPool(const ThreadPool &) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+    auto operator=(ThreadPool &&) -> ThreadPool & = delete;
+
+    /**
+     * Queues a callable to run on one of the worker threads. Exceptions thrown
+     * by the callable are rethrown from the returned future.
+     */
+    template<typename F>
+    auto enqueue(F &&f) -> std::future<std::invoke_result_t<F>> {
+      using Result = std::invoke_result_t<F>;
+
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+      auto result = task->get_future();
+
+      {
+        auto lock = std::scoped_lock{this->mutex};
+        this->tasks.push([task]() { (*task)(); });
+      }
+
+      this->condition.notify_one();
+
+      return result;
+    }
+
+    auto get_thread_count() const -> std::size_t;
+
+  private:
+    auto work() -> void;
+
+    std::vector<std::thread> threads  = {};
+    std::queue<Task> tasks            = {};
+    std::mutex mutex                  = {};
+    std::condition_variable condition = {};
+    bool is_stopping                  = false;
+  };
+}
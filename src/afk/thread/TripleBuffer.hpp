@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Afk {
+  /**
+   * Hands values from one thread to another without either waiting. The
+   * writer fills the back buffer and publishes it, and the reader takes
+   * whichever was published last, skipping any it was too slow to see.
+   *
+   * Only one thread may write, and only one may read, at a time.
+   */
+  template<typename T>
+  class TripleBuffer {
+  public:
+    // The buffer being written, as it was left the last time it was.
+    auto get_back() -> T & {
+      return this->buffers[this->back];
+    }
+
+    // Publishes the back buffer, and takes the one it replaces to write next.
+    auto publish() -> void {
+      this->back = this->middle.exchange(this->back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Takes the last published buffer, if it hasn't been already. Returns
+    // false, leaving the front buffer as it was, if it has.
+    auto acquire() -> bool {
+      if ((this->middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+        return false;
+      }
+
+      this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & INDEX;
+
+      return true;
+    }
+
+    // The buffer being read.
+    auto get_front() const -> const T & {
+      return this->buffers[this->front];
+    }
+
+  private:
+    static constexpr auto INDEX = std::uint8_t{3};
+    static constexpr auto FRESH = std::uint8_t{4};
+
+    std::array<T, 3> buffers = {};
+    std::uint8_t back        = 0;
+    std::uint8_t front       = 2;
+    // The buffer between the two, flagged fresh once published until read.
+    std::atomic<std::uint8_t> middle = {1};
+  };
+}
@@ -1,6 +1,12 @@
 #include "afk/ui/Ui.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <imgui/examples/imgui_impl_glfw.h>
@@ -8,18 +14,55 @@
 #include <imgui/imgui.h>
 
 #include "afk/Afk.hpp"
+#include "afk/asset/AssetRegistry.hpp"
+#include "afk/component/TransformBatch.hpp"
 #include "afk/debug/Assert.hpp"
 #include "afk/io/Log.hpp"
 #include "afk/io/Path.hpp"
+#include "afk/physics/PhysicsBody.hpp"
 #include "afk/renderer/Renderer.hpp"
+#include "afk/renderer/ResourceManager.hpp"
+#include "afk/renderer/TextureDecoder.hpp"
+#include "afk/terrain/Terrain.hpp"
+#include "afk/terrain/TerrainManager.hpp"
+#include "afk/thread/JobSystem.hpp"
+#include "afk/thread/ThreadPool.hpp"
 #include "afk/ui/Unicode.hpp"
 #include "cmake/Git.hpp"
 #include "cmake/Version.hpp"
 
+using namespace std::string_literals;
 using Afk::Engine;
 using Afk::Ui;
+using std::size_t;
 using std::vector;
 using std::filesystem::path;
+using LoadState = Afk::Renderer::LoadState;
+
+static auto load_state_name(LoadState state) -> const char * {
+  switch (state) {
+    case LoadState::Unloaded: return "unloaded";
+    case LoadState::Decoding: return "decoding";
+    case LoadState::Uploading: return "uploading";
+    case LoadState::Resident: return "resident";
+  }
+
+  return "unknown";
+}
+
+// Powers of two up to max_count, and max_count itself, for benchmarks to
+// sweep thread counts with.
+static auto get_thread_counts(size_t max_count) -> vector<size_t> {
+  auto counts = vector<size_t>{};
+
+  for (auto count = size_t{1}; count < max_count; count *= 2) {
+    counts.push_back(count);
+  }
+
+  counts.push_back(std::max(size_t{1}, max_count));
+
+  return counts;
+}
 
 Ui::~Ui() {
   ImGui_ImplOpenGL3_Shutdown();
@@ -72,6 +115,7 @@ auto Ui::draw() -> void {
 
   this->draw_about();
   this->draw_log();
+  this->draw_timeline();
   this->draw_model_viewer();
   this->draw_terrain_controller();
   this->draw_exit_screen();
@@ -101,18 +145,38 @@ auto Ui::draw_about() -> void {
 
 auto Ui::draw_menu_bar() -> void {
 //  auto &afk = Engine::get();
+  auto &physics       = Engine::get().physics_body_system;
+  auto is_threaded    = physics.get_threaded();
+  auto is_partitioned = physics.get_region_size() > 0.0f;
 
   if (ImGui::BeginMainMenuBar()) {
     if (ImGui::BeginMenu("Tools")) {
       if (ImGui::MenuItem("Log")) {
         this->show_log = true;
       }
+      if (ImGui::MenuItem("Frame timeline")) {
+        this->show_timeline = true;
+      }
       if (ImGui::MenuItem("Model viewer")) {
         this->show_model_viewer = true;
       }
       if (ImGui::MenuItem("Terrain controller")) {
         this->show_terrain_controller = true;
       }
+      ImGui::Separator();
+      if (ImGui::MenuItem("Benchmark transforms")) {
+        this->benchmark_transforms();
+      }
+      if (ImGui::MenuItem("Benchmark jobs")) {
+        this->benchmark_jobs();
+      }
+      ImGui::Separator();
+      if (ImGui::MenuItem("Threaded physics", nullptr, &is_threaded)) {
+        physics.set_threaded(is_threaded);
+      }
+      if (ImGui::MenuItem("Partition physics", nullptr, &is_partitioned)) {
+        physics.set_region_size(is_partitioned ? 64.0f : 0.0f);
+      }
       ImGui::EndMenu();
     }
 
@@ -159,9 +223,10 @@ auto Ui::draw_stats() -> void {
                        ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
                        ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav)) {
 
-    const auto &afk   = Engine::get();
-    const auto pos    = afk.camera.get_position();
-    const auto angles = afk.camera.get_angles();
+    const auto &afk    = Engine::get();
+    const auto pos     = afk.camera.get_position();
+    const auto angles  = afk.camera.get_angles();
+    const auto physics = afk.physics_body_system.get_stats();
 
     ImGui::Text("%.1f fps (%.4f ms)", static_cast<double>(io.Framerate),
                 static_cast<double>(io.Framerate) / 1000.0);
@@ -170,6 +235,11 @@ auto Ui::draw_stats() -> void {
                 static_cast<double>(pos.y), static_cast<double>(pos.z));
     ImGui::Text("Angles   {%.1f, %.1f}", static_cast<double>(angles.x),
                 static_cast<double>(angles.y));
+    ImGui::Separator();
+    ImGui::Text("Physics  %zu steps (%.2f ms)", physics.steps, physics.step_time);
+    ImGui::Text("Synced   %zu transforms", physics.synced);
+    ImGui::Text("Dropped  %.3f s", static_cast<double>(physics.total_dropped_time));
+    ImGui::Text("Regions  %zu (%zu ghosts)", physics.regions, physics.ghosts);
 
     if (ImGui::BeginPopupContextWindow()) {
       if (ImGui::MenuItem("Custom", nullptr, corner == -1)) {
@@ -206,25 +276,100 @@ auto Ui::draw_log() -> void {
   this->log.draw("Log", &this->show_log);
 }
 
+auto Ui::draw_timeline() -> void {
+  if (!this->show_timeline) {
+    return;
+  }
+
+  constexpr auto lane_height = 24.0f;
+  constexpr auto label_width = 60.0f;
+
+  const auto &scheduler = Engine::get().scheduler;
+  const auto &timeline  = scheduler.get_timeline();
+
+  ImGui::SetNextWindowSize({600, 200}, ImGuiCond_FirstUseEver);
+  ImGui::Begin("Frame timeline", &this->show_timeline);
+  ImGui::Text("Update %.3f ms on %zu threads", timeline.duration, scheduler.get_thread_count());
+  ImGui::Separator();
+
+  // One row per thread, the main thread first, with a bar for every system
+  // that ran on it, scaled to the length of the frame.
+  auto *draw_list   = ImGui::GetWindowDrawList();
+  const auto origin = ImGui::GetCursorScreenPos();
+  const auto width  = std::max(ImGui::GetContentRegionAvail().x - label_width, 1.0f);
+  const auto scale =
+      timeline.duration > 0.0 ? width / static_cast<float>(timeline.duration) : 0.0f;
+  const auto text  = ImGui::GetColorU32(ImGuiCol_Text);
+  const auto mouse = ImGui::GetIO().MousePos;
+
+  const Afk::Scheduler::Span *hovered = nullptr;
+
+  for (auto lane = size_t{0}; lane < timeline.lanes; ++lane) {
+    const auto y = origin.y + static_cast<float>(lane) * lane_height;
+
+    draw_list->AddText({origin.x, y + 4.0f}, text,
+                       lane == 0 ? "Main" : ("Pool " + std::to_string(lane)).c_str());
+  }
+
+  for (const auto &span : timeline.spans) {
+    const auto min = ImVec2{origin.x + label_width + static_cast<float>(span.start) * scale,
+                            origin.y + static_cast<float>(span.lane) * lane_height};
+    const auto max = ImVec2{std::max(origin.x + label_width + static_cast<float>(span.end) * scale,
+                                     min.x + 1.0f),
+                            min.y + lane_height - 2.0f};
+    const auto hue = static_cast<float>(span.system) * 0.15f;
+
+    draw_list->AddRectFilled(min, max, ImColor::HSV(hue - std::floor(hue), 0.6f, 0.8f));
+    draw_list->PushClipRect(min, max, true);
+    draw_list->AddText({min.x + 2.0f, min.y + 4.0f}, IM_COL32_BLACK,
+                       scheduler.get_name(span.system).c_str());
+    draw_list->PopClipRect();
+
+    if (mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+      hovered = &span;
+    }
+  }
+
+  ImGui::Dummy({label_width + width, static_cast<float>(timeline.lanes) * lane_height});
+
+  if (hovered != nullptr && ImGui::IsWindowHovered()) {
+    ImGui::SetTooltip("%s\n%.3f ms, from %.3f ms", scheduler.get_name(hovered->system).c_str(),
+                      hovered->end - hovered->start, hovered->start);
+  }
+
+  ImGui::End();
+}
+
 auto Ui::draw_model_viewer() -> void {
   if (!this->show_model_viewer) {
     return;
   }
 
-  auto &afk          = Engine::get();
-  const auto &models = afk.renderer.get_models();
+  auto &afk           = Engine::get();
+  const auto &assets  = Afk::Asset::AssetRegistry::get();
+  const auto &models  = afk.renderer.get_models();
+  const auto &pending = afk.renderer.get_pending_models();
 
   ImGui::SetNextWindowSize({700, 500});
 
   if (ImGui::Begin("Models", &this->show_model_viewer)) {
-    static auto selected = models.begin()->first;
+    static auto selected = Afk::Asset::INVALID_ASSET_ID;
 
     ImGui::BeginChild("left pane", ImVec2(250, 0), true);
-    for (const auto &[key, value] : models) {
-      if (ImGui::Selectable(key.string().c_str(), selected.lexically_normal() ==
-                                                      key.lexically_normal())) {
-        selected = key;
+    for (const auto &[id, value] : models) {
+      if (selected == Afk::Asset::INVALID_ASSET_ID) {
+        selected = id;
       }
+
+      if (ImGui::Selectable(assets.get_path(id).string().c_str(), selected == id)) {
+        selected = id;
+      }
+    }
+
+    // Models which are still streaming in can't be inspected yet.
+    for (const auto &[id, value] : pending) {
+      ImGui::TextDisabled("%s (%s)", assets.get_path(id).string().c_str(),
+                          load_state_name(value.state));
     }
 
     ImGui::EndChild();
@@ -235,7 +380,8 @@ auto Ui::draw_model_viewer() -> void {
     ImGui::BeginChild("item view", {0, -ImGui::GetFrameHeightWithSpacing()});
 
     if (ImGui::BeginTabBar("##Tabs", ImGuiTabBarFlags_None)) {
-      if (ImGui::BeginTabItem("Details")) {
+      // The selected model may have been evicted since it was picked.
+      if (models.contains(selected) && ImGui::BeginTabItem("Details")) {
         const auto &model = models.at(selected);
         ImGui::TextWrapped("Total meshes: %zu\n", model.meshes.size());
         ImGui::Separator();
@@ -253,6 +399,29 @@ auto Ui::draw_model_viewer() -> void {
 
         ImGui::EndTabItem();
       }
+      if (ImGui::BeginTabItem("Streaming")) {
+        constexpr auto mebibyte = size_t{1024 * 1024};
+        auto budget             = static_cast<int>(afk.renderer.get_upload_budget() / mebibyte);
+
+        if (ImGui::SliderInt("Upload budget (MiB/frame)", &budget, 1, 256)) {
+          afk.renderer.set_upload_budget(static_cast<size_t>(budget) * mebibyte);
+        }
+
+        ImGui::Separator();
+        ImGui::TextWrapped("Resident models: %zu\n", models.size());
+        ImGui::TextWrapped("Pending models: %zu\n", pending.size());
+        ImGui::Separator();
+
+        if (ImGui::Button("Benchmark texture decoding")) {
+          this->benchmark_texture_decoding();
+        }
+
+        ImGui::EndTabItem();
+      }
+      if (ImGui::BeginTabItem("Memory")) {
+        this->draw_resource_usage();
+        ImGui::EndTabItem();
+      }
       ImGui::EndTabBar();
     }
     ImGui::EndChild();
@@ -261,19 +430,214 @@ auto Ui::draw_model_viewer() -> void {
   ImGui::End();
 }
 
+auto Ui::draw_resource_usage() -> void {
+  using Pool = Afk::ResourceManager::Pool;
+
+  constexpr auto mebibyte = size_t{1024 * 1024};
+  constexpr auto pools = std::array{Pool::Model, Pool::Texture, Pool::Shader, Pool::ShaderProgram};
+
+  auto &afk        = Engine::get();
+  auto &resources  = afk.renderer.get_resources();
+  const auto to_mb = [](size_t bytes) { return static_cast<double>(bytes) / mebibyte; };
+
+  for (const auto pool : pools) {
+    const auto usage  = resources.get_usage(pool);
+    const auto budget = resources.get_budget(pool);
+
+    ImGui::TextWrapped("%s: %zu tracked\n", Afk::ResourceManager::get_pool_name(pool),
+                       resources.get_entries(pool).size());
+    ImGui::TextWrapped("  GPU: %.2f MiB, CPU: %.2f MiB\n", to_mb(usage.gpu_bytes),
+                       to_mb(usage.cpu_bytes));
+
+    // Only models and textures can be evicted, so only they get a budget.
+    if (pool == Pool::Model || pool == Pool::Texture) {
+      auto gpu_budget = static_cast<int>(budget.gpu_bytes / mebibyte);
+      const auto label =
+          "GPU budget (MiB)##"s + Afk::ResourceManager::get_pool_name(pool);
+
+      if (ImGui::SliderInt(label.c_str(), &gpu_budget, 16, 4096)) {
+        resources.set_budget(pool, {static_cast<size_t>(gpu_budget) * mebibyte, budget.cpu_bytes});
+      }
+    }
+
+    ImGui::Separator();
+  }
+
+  if (ImGui::Button("Evict unreferenced resources")) {
+    afk.renderer.evict_unused();
+  }
+}
+
+auto Ui::benchmark_texture_decoding() -> void {
+  const auto &afk = Engine::get();
+  auto file_paths = vector<path>{};
+
+  for (const auto &[id, value] : afk.renderer.get_textures()) {
+    file_paths.push_back(Afk::Asset::AssetRegistry::get().get_path(id));
+  }
+
+  for (const auto num_threads : get_thread_counts(Afk::ThreadPool::default_thread_count())) {
+    const auto throughput = Afk::TextureDecoder::measure_throughput(file_paths, num_threads);
+
+    Afk::Io::log << "Decoded " << file_paths.size() << " textures with " << num_threads
+                 << " thread(s) at " << throughput << " MB/s.\n";
+  }
+}
+
+auto Ui::benchmark_transforms() -> void {
+  for (auto count = size_t{1000}; count <= 1000000; count *= 10) {
+    const auto batched = Afk::TransformBatch::measure_throughput(count, true);
+    const auto scalar  = Afk::TransformBatch::measure_throughput(count, false);
+
+    Afk::Io::log << "Built " << count << " matrices at " << batched / 1e6
+                 << " M/s batched, " << scalar / 1e6 << " M/s one at a time.\n";
+  }
+}
+
+auto Ui::benchmark_jobs() -> void {
+  constexpr auto count = size_t{1000000};
+
+  for (const auto jobs : {size_t{10000}, size_t{100000}}) {
+    const auto nanoseconds = Afk::JobSystem::measure_overhead(jobs);
+
+    Afk::Io::log << "Ran " << jobs << " empty jobs at " << nanoseconds << " ns each.\n";
+  }
+
+  // Efficiency is the speedup over one thread, divided by the threads used.
+  const auto serial = Afk::JobSystem::measure_scaling(count, 0);
+
+  for (const auto workers : get_thread_counts(Afk::JobSystem::default_worker_count())) {
+    const auto seconds    = Afk::JobSystem::measure_scaling(count, workers);
+    const auto speedup    = seconds > 0.0 ? serial / seconds : 0.0;
+    const auto efficiency = speedup / static_cast<double>(workers + 1);
+
+    Afk::Io::log << "Looped over " << count << " items with " << workers + 1 << " threads in "
+                 << seconds * 1000.0 << " ms, " << speedup << "x, " << efficiency * 100.0
+                 << "% efficient.\n";
+  }
+}
+
 auto Ui::draw_terrain_controller() -> void {
   if (!this->show_terrain_controller) {
     return;
   }
 
-  ImGui::SetNextWindowSize({300, 150});
+  static auto roughness      = 0.05f;
+  static auto scaling        = 7.5f;
+  static auto is_live        = false;
+  static auto brush_radius   = 16.0f;
+  static auto brush_strength = 8.0f;
+
+  auto &afk               = Engine::get();
+  auto &terrain_manager   = afk.terrain_manager;
+  auto &terrain_streamer  = afk.terrain_streamer;
+  const auto stats        = terrain_manager.get_stats();
+  const auto stream_stats = terrain_streamer.get_stats();
+  auto is_streaming       = terrain_streamer.get_enabled();
+
+  ImGui::SetNextWindowSize({300, 410});
 
   if (ImGui::Begin("Terrain controller", &this->show_terrain_controller)) {
-    // ImGui::SliderFloat("slider float", &f1, 0.0f, 1.0f, "ratio = %.3f");
+    ImGui::SliderFloat("LOD distance", &terrain_manager.lod_distance, 16.0f, 512.0f, "%.0f");
+    ImGui::Separator();
+    ImGui::Text("Visible chunks: %zu / %zu", stats.visible_chunks, stats.total_chunks);
+    ImGui::Text("Visible triangles: %zu", stats.visible_triangles);
+    ImGui::Separator();
+    auto is_changed = ImGui::SliderFloat("Roughness", &roughness, 0.001f, 0.2f, "%.3f");
+    is_changed |= ImGui::SliderFloat("Scaling", &scaling, 0.0f, 50.0f, "%.1f");
+
+    if (ImGui::Button("Regenerate") || (is_live && is_changed)) {
+      this->regenerate_terrain(roughness, scaling);
+    }
+
+    ImGui::SameLine();
+    ImGui::Checkbox("Live", &is_live);
+    ImGui::SliderFloat("Brush radius", &brush_radius, 1.0f, 128.0f, "%.0f");
+    ImGui::SliderFloat("Brush strength", &brush_strength, 1.0f, 64.0f, "%.0f");
+
+    // Brushes paint for as long as they're held, wherever the camera's looking.
+    ImGui::Button("Raise");
+
+    if (ImGui::IsItemActive()) {
+      this->paint_terrain(brush_radius, brush_strength * afk.get_delta_time());
+    }
+
+    ImGui::SameLine();
+    ImGui::Button("Lower");
+
+    if (ImGui::IsItemActive()) {
+      this->paint_terrain(brush_radius, -brush_strength * afk.get_delta_time());
+    }
+
+    ImGui::Separator();
+
+    if (ImGui::Checkbox("Stream endless terrain", &is_streaming)) {
+      terrain_streamer.set_enabled(is_streaming);
+    }
+
+    ImGui::SliderInt("Stream radius", &terrain_streamer.view_radius, 1, 8);
+    ImGui::Text("Tiles: %zu resident, %zu pending, %zu cached", stream_stats.resident,
+                stream_stats.pending, stream_stats.cached);
   }
   ImGui::End();
 }
 
+auto Ui::regenerate_terrain(float roughness, float scaling) -> void {
+  auto &afk        = Engine::get();
+  const auto start = std::chrono::steady_clock::now();
+
+  // Physics reads the height map in place, so it's held still while it changes.
+  const auto lock = afk.physics_body_system.lock();
+
+  // Keep the size, so everything holding onto the height map can be patched in place.
+  const auto &update = afk.terrain_manager.update_terrain(roughness, scaling);
+  this->apply_terrain_update(update);
+
+  const auto elapsed =
+      std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() - start};
+
+  Afk::Io::log << "Regenerated terrain in " << elapsed.count() << " ms, "
+               << update.regions.size() << " regions changed.\n";
+}
+
+auto Ui::paint_terrain(float radius, float strength) -> void {
+  auto &afk    = Engine::get();
+  auto &camera = afk.camera;
+
+  const auto hit =
+      afk.terrain_manager.query.raycast(camera.get_position(), camera.get_front(), 4096.0f);
+
+  if (!hit.is_hit) {
+    return;
+  }
+
+  // Brushes work in samples, counted from the map's first.
+  const auto grid = hit.position - afk.terrain_manager.query.get_origin();
+  const auto lock = afk.physics_body_system.lock();
+
+  this->apply_terrain_update(
+      afk.terrain_manager.apply_brush(glm::vec2{grid.x, grid.z}, radius, strength));
+}
+
+auto Ui::apply_terrain_update(const Afk::TerrainManager::Update &update) -> void {
+  auto &afk              = Engine::get();
+  const auto &height_map = afk.terrain_manager.height_map;
+
+  for (const auto &region : update.regions) {
+    afk.renderer.update_height_map(Afk::TerrainManager::HEIGHT_MAP_PATH, height_map, region);
+  }
+
+  // Physics reads the samples in place, but holds onto the scale and offset
+  // they're read with.
+  if (update.is_rescaled) {
+    auto view = afk.registry.view<Afk::Terrain, Afk::PhysicsBody>();
+
+    for (auto entity : view) {
+      afk.physics_body_system.set_height_map(view.get<Afk::PhysicsBody>(entity), height_map);
+    }
+  }
+}
+
 auto Ui::draw_exit_screen() -> void {
   if (!this->show_exit_screen) {
     return;
@@ -6,6 +6,7 @@
 #include <imgui/imgui.h>
 
 #include "afk/renderer/Renderer.hpp"
+#include "afk/terrain/TerrainManager.hpp"
 #include "afk/ui/Log.hpp"
 
 // FIXME: Add log, texture/mesh viewer
@@ -38,6 +39,7 @@ namespace Afk {
     bool show_imgui              = false;
     bool show_about              = false;
     bool show_log                = false;
+    bool show_timeline           = false;
     bool show_model_viewer       = false;
     bool show_terrain_controller = false;
     bool show_exit_screen        = false;
@@ -50,8 +52,16 @@ namespace Afk {
     auto draw_stats() -> void;
     auto draw_about() -> void;
     auto draw_log() -> void;
+    auto draw_timeline() -> void;
     auto draw_model_viewer() -> void;
+    auto draw_resource_usage() -> void;
+    auto benchmark_texture_decoding() -> void;
+    auto benchmark_transforms() -> void;
+    auto benchmark_jobs() -> void;
     auto draw_terrain_controller() -> void;
+    auto regenerate_terrain(float roughness, float scaling) -> void;
+    auto paint_terrain(float radius, float strength) -> void;
+    auto apply_terrain_update(const TerrainManager::Update &update) -> void;
     auto draw_exit_screen() -> void;
   };
 }